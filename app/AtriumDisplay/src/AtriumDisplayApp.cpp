@@ -11,17 +11,42 @@
 #include "cinder/Perlin.h"
 #include "cinder/ConcurrentCircularBuffer.h"
 #include "cinder/gl/TextureFont.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Batch.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/Pbo.h"
 #include "cinder/qtime/QuickTimeGl.h"
 #include "cinder/Json.h"
+#include "cinder/ip/Resize.h"
 #include "Resources.h"
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/replace.hpp>
 #include <boost/format.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <time.h>
 #include <string>
+#include <atomic>
+#include <condition_variable>
 #include <regex>
 #include <fstream>
+#include <chrono>
+#include <cstring>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <execinfo.h>
+#include <mach/mach.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "dispatch/dispatch.h"
 #include <cstdio> // for std::remove
 
@@ -35,6 +60,14 @@ namespace std { using ::remove; }
 #include "yaml.h"
 #include "icalendar.h"
 
+#if defined( __SSE2__ )
+    #include <emmintrin.h>
+    #define BATCH_PERLIN_SIMD
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+    #include <arm_neon.h>
+    #define BATCH_PERLIN_SIMD
+#endif
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -67,267 +100,5391 @@ std::string expand_user(std::string path) {
     return path;
 }
 
-#pragma mark FadingTexture
+// The clock and timeline the show runs on. They follow the app's elapsed
+// time, except in the benchmark where every frame advances a virtual clock,
+// and on a follower where the elapsed time is offset to the leader's.
+static double sVirtualTime = -1;
+static std::atomic<double> sClockOffset( 0 );
 
-class FadingTexture {
+// A timeline that can tell when the next of its pending items for some
+// targets starts, however many are queued on each target.
+class ShowTimeline : public Timeline {
 public:
-    FadingTexture();
-    void draw();
-    void fadeToSurface(SurfaceRef newSurface, float duration=1.5f);
-    void fadeToSurface(float duration=1.5f);
+    double getNextStart(const vector<void*> &targets, double time) const {
+        double next = numeric_limits<double>::max();
+        for(void *target : targets){
+            auto range = mItems.equal_range( target );
+            for(auto it = range.first; it != range.second; ++it){
+                if( it->second->getStartTime() > time ) next = min( next, (double)it->second->getStartTime() );
+            }
+        }
+        return next;
+    }
+};
+
+ShowTimeline& showTimeline() {
+    static std::shared_ptr<ShowTimeline> timeline( new ShowTimeline );
+    return *timeline;
+}
+
+double showTime() {
+    return sVirtualTime >= 0 ? sVirtualTime : getElapsedSeconds() + sClockOffset;
+}
+
+void setVirtualTime(double time) {
+    sVirtualTime = time;
+}
+
+void setClockOffset(double offset) {
+    sClockOffset = offset;
+}
+
+// where the logs, stats and traces are written
+fs::path getLogsPath() {
+    fs::path path( expand_user( "~/Library/Logs/AtriumDisplay" ) );
+    fs::create_directories( path );
+    return path;
+}
+
+// where what can be built again, like font atlases, is kept between launches
+fs::path getCachePath() {
+    fs::path path( expand_user( "~/Library/Caches/AtriumDisplay" ) );
+    fs::create_directories( path );
+    return path;
+}
+
+// Appends text to a log in the logs directory on a serial queue, so the
+// main thread doesn't wait for the disk. A log past LOG_ROTATE_BYTES moves
+// to name.1.ext, replacing the one before, and starts over.
+static const uintmax_t LOG_ROTATE_BYTES = 4 * 1024 * 1024;
+
+void appendLog(const string &name, const string &text) {
+    static dispatch_queue_t queue = dispatch_queue_create( "AtriumDisplay.logs", DISPATCH_QUEUE_SERIAL );
+    string line = text;
+    dispatch_async( queue, ^{
+        fs::path path = getLogsPath() / name;
+        boost::system::error_code error;
+        uintmax_t size = fs::file_size( path, error );
+        if( ! error && size > LOG_ROTATE_BYTES ){
+            fs::rename( path, path.parent_path() / ( path.stem().string() + ".1" + path.extension().string() ), error );
+        }
+        std::ofstream( path.string(), std::ios::app ) << line;
+    });
+}
+
+#pragma mark MemoryLedger
+
+// Live bytes, live objects, allocations and the high-water mark of each
+// kind of memory the show holds on to. Sizes are what the objects hold, not
+// what the allocator spent on them: pixels for surfaces and textures, the
+// file size for YAML documents, an estimate for projects and events.
+
+class MemoryLedger {
+public:
+    enum Tag { SURFACES, TEXTURES, TEXT_CACHES, YAML_DOCUMENTS, PROJECTS, CALENDAR, TAGS };
     
-    Anim<float>     mCrossFade;
-    Anim<float>     mFade;
-    Area            mBounds;
-    Color           mColor;
-    gl::TextureRef  mTexture, mLastTexture;
+    struct Stats {
+        int64_t     mLive, mPeak, mCount;
+        uint64_t    mAllocations;
+    };
+    
+    static const char *getName(Tag tag);
+    
+    void add(Tag tag, int64_t bytes, int64_t count=1);
+    void remove(Tag tag, int64_t bytes, int64_t count=1) { add( tag, -bytes, -count ); }
     
+    // accounts for the object until the last reference to it goes
+    template<typename T>
+    std::shared_ptr<T> track(Tag tag, const std::shared_ptr<T> &object, int64_t bytes);
+    
+    Stats getStats(Tag tag) const;
+    
+    // one line per tag, in megabytes
+    vector<string> report() const;
+    
+private:
+    struct Account {
+        Account() : mLive( 0 ), mPeak( 0 ), mCount( 0 ), mAllocations( 0 ) {}
+        std::atomic<int64_t>    mLive, mPeak, mCount;
+        std::atomic<uint64_t>   mAllocations;
+    };
+    
+    Account mAccounts[TAGS];
 };
 
-class Snowflake {
+MemoryLedger gMemory;
+
+// The bytes one object holds, accounted for as long as the entry lives.
+class MemoryEntry {
 public:
-    vec2 position;
-    vec2 speed;
-    float radius;
+    MemoryEntry(MemoryLedger::Tag tag, int64_t bytes=0) : mTag( tag ), mBytes( bytes ) { gMemory.add( mTag, mBytes ); }
+    ~MemoryEntry() { gMemory.remove( mTag, mBytes ); }
+    
+    // for objects that grow or shrink
+    void set(int64_t bytes) { gMemory.add( mTag, bytes - mBytes, 0 ); mBytes = bytes; }
+    
+private:
+    MemoryEntry(const MemoryEntry&);
+    MemoryEntry& operator=(const MemoryEntry&);
+    
+    MemoryLedger::Tag   mTag;
+    int64_t             mBytes;
 };
 
-// Functor which empties the FadingTexture pointed to by ftPtr
-struct ResetFadingTextureFunctor {
-    ResetFadingTextureFunctor( FadingTexture *ftPtr )
-    : mFadingTexturePtr( ftPtr )
-    {}
+const char *MemoryLedger::getName(Tag tag){
+    static const char *names[TAGS] = { "surfaces", "textures", "text caches", "yaml documents", "projects", "calendar" };
+    return names[tag];
+}
+
+void MemoryLedger::add(Tag tag, int64_t bytes, int64_t count){
+    Account &account = mAccounts[tag];
+    int64_t live = account.mLive += bytes;
+    account.mCount += count;
+    if( count > 0 ) account.mAllocations += count;
     
-    void operator()() {
-        mFadingTexturePtr->mLastTexture.reset();
-        mFadingTexturePtr->mTexture.reset();
+    int64_t peak = account.mPeak;
+    while( live > peak && ! account.mPeak.compare_exchange_weak( peak, live ) ){}
+}
+
+template<typename T>
+std::shared_ptr<T> MemoryLedger::track(Tag tag, const std::shared_ptr<T> &object, int64_t bytes){
+    if( ! object ) return object;
+    add( tag, bytes );
+    // the returned pointer shares ownership of a holder that settles the account
+    std::shared_ptr<std::shared_ptr<T>> holder( new std::shared_ptr<T>( object ), [this, tag, bytes]( std::shared_ptr<T> *held ){
+        remove( tag, bytes );
+        delete held;
+    } );
+    return std::shared_ptr<T>( holder, object.get() );
+}
+
+MemoryLedger::Stats MemoryLedger::getStats(Tag tag) const {
+    const Account &account = mAccounts[tag];
+    Stats stats = { account.mLive, account.mPeak, account.mCount, account.mAllocations };
+    return stats;
+}
+
+vector<string> MemoryLedger::report() const {
+    vector<string> lines;
+    lines.push_back( "memory               live MB  peak MB   objects  allocations" );
+    for(int tag = 0; tag < TAGS; tag++){
+        Stats stats = getStats( Tag( tag ) );
+        lines.push_back( ( boost::format( "%-20s %8.1f %8.1f %9d %12d" ) % getName( Tag( tag ) ) % ( stats.mLive / 1048576. ) % ( stats.mPeak / 1048576. ) % stats.mCount % stats.mAllocations ).str() );
     }
+    return lines;
+}
+
+// Wraps up a surface or texture with its pixels in the ledger.
+SurfaceRef trackSurface(const SurfaceRef &surface){
+    return surface ? gMemory.track( MemoryLedger::SURFACES, surface, (int64_t)surface->getRowBytes() * surface->getHeight() ) : surface;
+}
+
+gl::TextureRef createTexture(const Surface8u &surface, MemoryLedger::Tag tag=MemoryLedger::TEXTURES){
+    return gMemory.track( tag, gl::Texture::create( surface ), (int64_t)surface.getWidth() * surface.getHeight() * 4 );
+}
+
+// the size of a file, for documents parsed from it
+int64_t fileBytes(const fs::path &path){
+    boost::system::error_code error;
+    uintmax_t size = fs::file_size( path, error );
+    return error ? 0 : size;
+}
+
+#pragma mark MediaIO
+
+// Reads the portfolio's files, which live on a synced network share, with
+// large sequential reads into one buffer, and has the OS read ahead the
+// files the playlist needs next. Every read is timed, so the logs can tell
+// a slow share from a slow decoder.
+
+class MediaIO {
+public:
+    static const size_t CHUNK = 1 << 20;
+    static const size_t RECENT = 200;
     
-    FadingTexture	*mFadingTexturePtr;
+    struct Read {
+        string      mName;
+        int64_t     mBytes;
+        double      mSeconds;
+    };
+    
+    MediaIO();
+    
+    // the whole file, read before returning
+    DataSourceRef open(const fs::path &path);
+    // starts reading the file, or its first bytes, in the background
+    void prefetch(const fs::path &path, int64_t bytes=numeric_limits<int64_t>::max());
+    // the same for the first of the files that exists
+    void prefetch(const vector<fs::path> &paths, int64_t bytes=numeric_limits<int64_t>::max());
+    
+    int64_t getFiles() const { return mFiles; }
+    int64_t getBytes() const { return mBytes; }
+    double getSeconds() const { return mSeconds; }
+    uint64_t getPrefetches() const { return mPrefetches; }
+    vector<Read> getRecent() const;
+    vector<string> report() const;
+    
+private:
+    mutable std::mutex      mMutex;
+    deque<Read>             mRecent;
+    std::atomic<int64_t>    mFiles, mBytes;
+    std::atomic<double>     mSeconds;
+    std::atomic<uint64_t>   mPrefetches;
 };
 
-FadingTexture::FadingTexture(){
-    mFade = 0.0;
-    mCrossFade = 0.0;
-    mColor = Color::white();
+MediaIO gMediaIO;
+
+MediaIO::MediaIO()
+: mFiles( 0 ), mBytes( 0 ), mSeconds( 0 ), mPrefetches( 0 )
+{
 }
 
-void FadingTexture::draw(){
-    
-    Rectf drawBounds;
+DataSourceRef MediaIO::open(const fs::path &path){
+    auto start = std::chrono::steady_clock::now();
     
-    if( mLastTexture ) {
-        gl::color( mColor.r, mColor.g, mColor.b, (1.0f - mCrossFade)*mFade );
-        Rectf textureBounds = mLastTexture->getBounds();
-        drawBounds = textureBounds.getCenteredFit( mBounds, true );
-        gl::draw( mLastTexture, drawBounds );
+    int fd = ::open( path.c_str(), O_RDONLY );
+    if( fd < 0 ) throw std::runtime_error( "unable to open " + path.string() );
+    struct stat info;
+    if( fstat( fd, &info ) < 0 ){
+        ::close( fd );
+        throw std::runtime_error( "unable to stat " + path.string() );
     }
-    if( mTexture ) {
-        gl::color( mColor.r, mColor.g, mColor.b, mCrossFade*mFade );
-        Rectf textureBounds = mTexture->getBounds();
-        drawBounds = textureBounds.getCenteredFit( mBounds, true );
-        gl::draw( mTexture, drawBounds );
+#ifdef F_RDAHEAD
+    fcntl( fd, F_RDAHEAD, 1 );
+#else
+    posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+    
+    size_t size = info.st_size, done = 0;
+    BufferRef buffer = Buffer::create( size );
+    while( done < size ){
+        ssize_t bytes = ::read( fd, static_cast<char*>( buffer->getData() ) + done, min( CHUNK, size - done ) );
+        if( bytes < 0 && errno == EINTR ) continue;
+        if( bytes <= 0 ) break;
+        done += bytes;
     }
+    ::close( fd );
+    if( done < size ) throw std::runtime_error( "short read of " + path.string() );
+    
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    mFiles++;
+    mBytes += size;
     {
-        gl::ScopedBlendAdditive  blendAdditive;
-        //    gl::enableAdditiveBlending();
-        gl::color( 1.0-mColor.r, 1.0-mColor.g, 1.0-mColor.b, mFade*.5 );
-        gl::drawSolidRect(drawBounds);
+        // the only writer of mSeconds, so adding to it under the lock is enough
+        std::lock_guard<std::mutex> lock( mMutex );
+        mSeconds = mSeconds + seconds;
+        Read read = { path.parent_path().filename().string() + "/" + path.filename().string(), (int64_t)size, seconds };
+        mRecent.push_back( read );
+        if( mRecent.size() > RECENT ) mRecent.pop_front();
     }
-    //    gl::enableAlphaBlending();
-    
+    return DataSourceBuffer::create( buffer );
 }
 
-void FadingTexture::fadeToSurface(float duration){
-    timeline().apply( &mFade, 0.0f, duration ).finishFn(ResetFadingTextureFunctor( this ));
+void MediaIO::prefetch(const fs::path &path, int64_t bytes){
+    prefetch( vector<fs::path>( 1, path ), bytes );
 }
 
-void FadingTexture::fadeToSurface(SurfaceRef newSurface, float duration){
-    
-    if( newSurface ) {
-        mLastTexture = mTexture; // the "last" texture is now the current text
-        
-        mTexture = gl::Texture::create( *newSurface.get() );
-        
-        // blend from 0 to 1 over 1.5sec
-        timeline().apply( &mCrossFade, 0.0f, 1.0f, duration );
-        timeline().apply( &mFade, 1.0f, duration );
-        
-    } else {
-        timeline().apply( &mFade, 0.0f, duration );
+void MediaIO::prefetch(const vector<fs::path> &paths, int64_t bytes){
+    mPrefetches++;
+    // opening a file on the share can block too, so it is done off the caller's thread
+    vector<string> files;
+    for(const fs::path &path : paths) files.push_back( path.string() );
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+        int fd = -1;
+        for(size_t i = 0; i < files.size() && fd < 0; i++){
+            fd = ::open( files[i].c_str(), O_RDONLY );
+        }
+        if( fd < 0 ) return;
+        struct stat info;
+        if( fstat( fd, &info ) == 0 ){
+            off_t length = min<int64_t>( info.st_size, bytes );
+#ifdef F_RDADVISE
+            struct radvisory advice = { 0, (int)min<off_t>( length, numeric_limits<int>::max() ) };
+            fcntl( fd, F_RDADVISE, &advice );
+#else
+            posix_fadvise( fd, 0, length, POSIX_FADV_WILLNEED );
+#endif
+        }
+        ::close( fd );
+    });
+}
+
+vector<MediaIO::Read> MediaIO::getRecent() const {
+    std::lock_guard<std::mutex> lock( mMutex );
+    return vector<Read>( mRecent.begin(), mRecent.end() );
+}
+
+vector<string> MediaIO::report() const {
+    vector<Read> recent = getRecent();
+    int64_t bytes = 0;
+    double seconds = 0;
+    vector<double> latencies;
+    for(const Read &read : recent){
+        bytes += read.mBytes;
+        seconds += read.mSeconds;
+        latencies.push_back( read.mSeconds * 1000. );
     }
+    sort( latencies.begin(), latencies.end() );
+    auto percentile = [&latencies]( double p ){ return latencies.empty() ? 0. : latencies[min<size_t>( p * latencies.size(), latencies.size() - 1 )]; };
     
+    vector<string> lines;
+    lines.push_back( ( boost::format( "io: %d files read, %d prefetched, recent %.1f MB/s, %.1fms p50 %.1fms p95" )
+                      % mFiles.load() % mPrefetches.load() % ( seconds > 0 ? bytes / 1048576. / seconds : 0. ) % percentile( .5 ) % percentile( .95 ) ).str() );
+    // the slowest recent files
+    sort( recent.begin(), recent.end(), []( const Read &a, const Read &b ){ return a.mSeconds > b.mSeconds; } );
+    for(size_t i = 0; i < min<size_t>( 3, recent.size() ); i++){
+        lines.push_back( ( boost::format( "  %-40s %8.1fms %6.1f MB/s" ) % recent[i].mName.substr( 0, 40 ) % ( recent[i].mSeconds * 1000. )
+                          % ( recent[i].mSeconds > 0 ? recent[i].mBytes / 1048576. / recent[i].mSeconds : 0. ) ).str() );
+    }
+    return lines;
 }
 
-#pragma mark Project
+#pragma mark GifClip
 
-class Project {
+// Decodes an animated GIF one frame at a time onto a canvas, handling the
+// frames' disposal, and loops back to the first frame after the last one.
+// Only the compressed file, the canvas and, for frames that restore what
+// was under them, a copy of that area are held.
+
+class GifDecoder {
 public:
+    GifDecoder();
     
-    Project(const fs::path &p);
-    void loadYAMLFile(const fs::path &pYAML);
-    void setupResources(const fs::path &p);
-    void reload();
+    bool open(const DataSourceRef &source);
+    bool isAnimated() const { return mFrames > 1; }
     
-    fs::path            mPath;
-    vector<fs::path>    mResources;
-    vector<fs::path>    mImages;
-    vector<fs::path>    mMovies;
+    // composites the next frame and returns how long it shows, in seconds
+    float next();
+    const Surface8u& getCanvas() const { return mCanvas; }
+    int64_t getBytes() const;
     
-    //    ConcurrentCircularBuffer<Surface> *mSurfaces;
+private:
+    void drawFrame(int transparent, int disposal);
+    bool skipBlocks(size_t &pos) const;
+    void readBlocks(vector<uint8_t> &to);
+    static bool decodeLzw(const vector<uint8_t> &data, int minCodeSize, size_t pixels, vector<uint8_t> &indices);
     
-    boost::gregorian::date mDate;
-    std::string         mTitle;
-    std::string         mAbstract;
-    std::string         mSummary;
-    vector<std::string> mParticipants;
-    vector<std::string> mCredits;
-    vector<std::string> mMaterials;
-    vector<std::string> mTags;
-    vector<std::string> mPublished;
-    std::string         mCreativeCommons;
-    Url                 mHomepageURL;
+    BufferRef           mBuffer;
+    const uint8_t       *mData;
+    size_t              mSize, mPos, mFirst;
+    int                 mFrames;
+    const uint8_t       *mPalette;
+    int                 mPaletteSize;
     
+    Surface8u           mCanvas, mPrevious;
+    int                 mDisposal;
+    Area                mDisposalArea;
+    vector<uint8_t>     mCompressed, mIndices;
 };
 
-Project::Project(const fs::path &p){
+GifDecoder::GifDecoder()
+: mData( nullptr ), mSize( 0 ), mPos( 0 ), mFirst( 0 ), mFrames( 0 ), mPalette( nullptr ), mPaletteSize( 0 ), mDisposal( 0 )
+{
+}
+
+bool GifDecoder::open(const DataSourceRef &source){
+    mBuffer = source->getBuffer();
+    mData = static_cast<const uint8_t*>( mBuffer->getData() );
+    mSize = mBuffer->getSize();
+    if( mSize < 13 || ( memcmp( mData, "GIF87a", 6 ) && memcmp( mData, "GIF89a", 6 ) ) ) return false;
     
-    //   mSurfaces = new ConcurrentCircularBuffer<Surface>( 5 ); // room for 5 images
+    int width = mData[6] | mData[7] << 8, height = mData[8] | mData[9] << 8;
+    uint8_t packed = mData[10];
+    mPos = 13;
+    if( packed & 0x80 ){
+        mPalette = mData + mPos;
+        mPaletteSize = 2 << ( packed & 7 );
+        mPos += mPaletteSize * 3;
+    }
+    if( width <= 0 || height <= 0 || width > 16384 || height > 16384 || mPos > mSize ) return false;
+    mFirst = mPos;
     
-    if(fs::exists(p) && fs::is_directory(p)){
-        mPath = p;
-        reload();
+    // counts frames without decoding them, two are enough to tell
+    size_t pos = mFirst;
+    while( pos < mSize && mFrames < 2 ){
+        uint8_t block = mData[pos++];
+        if( block == 0x21 ){
+            if( ++pos > mSize || ! skipBlocks( pos ) ) break;
+        } else if( block == 0x2C ){
+            if( pos + 9 > mSize ) break;
+            uint8_t local = mData[pos + 8];
+            pos += 9 + ( local & 0x80 ? ( 2 << ( local & 7 ) ) * 3 : 0 ) + 1;
+            if( pos > mSize || ! skipBlocks( pos ) ) break;
+            mFrames++;
+        } else {
+            break;
+        }
     }
+    
+    mCanvas = Surface8u( width, height, true, SurfaceChannelOrder::RGBA );
+    memset( mCanvas.getData(), 0, mCanvas.getRowBytes() * height );
+    return mFrames > 0;
 }
 
-void Project::reload(){
-    if(fs::exists(mPath) && mPath != ""){
-        mResources.clear();
-        mImages.clear();
-        mMovies.clear();
-        setupResources(mPath);
-        fs::path pYAML = fs::path(mPath.string() + "/project.yaml");
-        if(fs::exists(pYAML)){
-            loadYAMLFile(pYAML);
+int64_t GifDecoder::getBytes() const {
+    return mSize + (int64_t)mCanvas.getRowBytes() * mCanvas.getHeight() + (int64_t)mPrevious.getRowBytes() * mPrevious.getHeight();
+}
+
+// steps over a run of sub-blocks and its terminator
+bool GifDecoder::skipBlocks(size_t &pos) const {
+    while( pos < mSize ){
+        uint8_t length = mData[pos++];
+        if( length == 0 ) return true;
+        pos += length;
+    }
+    return false;
+}
+
+void GifDecoder::readBlocks(vector<uint8_t> &to){
+    to.clear();
+    while( mPos < mSize ){
+        uint8_t length = mData[mPos++];
+        if( length == 0 ) return;
+        size_t end = min( mPos + length, mSize );
+        to.insert( to.end(), mData + mPos, mData + end );
+        mPos = end;
+    }
+}
+
+float GifDecoder::next(){
+    float delay = .1f;
+    int transparent = -1, disposal = 0;
+    bool looped = false;
+    
+    while( true ){
+        uint8_t block = mPos < mSize ? mData[mPos++] : 0x3B;
+        if( block == 0x21 && mPos < mSize ){
+            uint8_t label = mData[mPos++];
+            if( label == 0xF9 && mPos + 5 <= mSize && mData[mPos] >= 4 ){
+                uint8_t packed = mData[mPos + 1];
+                int centiseconds = mData[mPos + 2] | mData[mPos + 3] << 8;
+                disposal = ( packed >> 2 ) & 7;
+                transparent = packed & 1 ? mData[mPos + 4] : -1;
+                // as in browsers, delays under 20ms show for 100ms
+                delay = centiseconds < 2 ? .1f : centiseconds / 100.f;
+            }
+            skipBlocks( mPos );
+        } else if( block == 0x2C ){
+            drawFrame( transparent, disposal );
+            return delay;
+        } else {
+            // the trailer, or anything after a damaged block, starts the next loop
+            if( looped ) throw std::runtime_error( "no frames in the GIF" );
+            looped = true;
+            mPos = mFirst;
+            mDisposal = 0;
+            memset( mCanvas.getData(), 0, mCanvas.getRowBytes() * mCanvas.getHeight() );
         }
     }
 }
 
-void Project::loadYAMLFile(const fs::path &pYAML){
+void GifDecoder::drawFrame(int transparent, int disposal){
+    // what the previous frame asked to leave behind it
+    if( mDisposal == 2 ){
+        for(int y = mDisposalArea.y1; y < mDisposalArea.y2; y++){
+            memset( mCanvas.getData( ivec2( mDisposalArea.x1, y ) ), 0, mDisposalArea.getWidth() * 4 );
+        }
+    } else if( mDisposal == 3 && mPrevious.getData() ){
+        mCanvas.copyFrom( mPrevious, mPrevious.getBounds(), mDisposalArea.getUL() );
+    }
     
-    // load YAML file
-    YAML::Node projectYaml = YAML::LoadFile(pYAML.c_str());
+    if( mPos + 9 > mSize ) throw std::runtime_error( "truncated GIF frame" );
+    int x = mData[mPos] | mData[mPos + 1] << 8, y = mData[mPos + 2] | mData[mPos + 3] << 8;
+    int width = mData[mPos + 4] | mData[mPos + 5] << 8, height = mData[mPos + 6] | mData[mPos + 7] << 8;
+    uint8_t packed = mData[mPos + 8];
+    mPos += 9;
+    const uint8_t *palette = mPalette;
+    int paletteSize = mPaletteSize;
+    if( packed & 0x80 ){
+        palette = mData + mPos;
+        paletteSize = 2 << ( packed & 7 );
+        mPos += paletteSize * 3;
+    }
+    if( mPos >= mSize ) throw std::runtime_error( "truncated GIF frame" );
+    int minCodeSize = mData[mPos++];
+    readBlocks( mCompressed );
     
-    if(projectYaml["date"]){
+    Area area = Area( x, y, x + width, y + height ).getClipBy( mCanvas.getBounds() );
+    if( disposal == 3 ){
+        mPrevious = mCanvas.clone( area );
+    }
+    mDisposal = disposal;
+    mDisposalArea = area;
+    if( ! decodeLzw( mCompressed, minCodeSize, (size_t)width * height, mIndices ) ) return;
+    
+    // interlaced rows come in four passes
+    vector<int> rows;
+    for(int pass = 0; pass < 4; pass++){
+        static const int start[] = { 0, 4, 2, 1 }, step[] = { 8, 8, 4, 2 };
+        for(int row = ( packed & 0x40 ) ? start[pass] : 0; row < height; row += ( packed & 0x40 ) ? step[pass] : 1) rows.push_back( row );
+        if( ! ( packed & 0x40 ) ) break;
+    }
+    for(int i = 0; i < height; i++){
+        int row = y + rows[i];
+        if( row < area.y1 || row >= area.y2 ) continue;
+        const uint8_t *index = &mIndices[(size_t)i * width];
+        uint8_t *pixel = mCanvas.getData( ivec2( x, row ) );
+        for(int column = x; column < x + width; column++, index++, pixel += 4){
+            if( column < area.x1 || column >= area.x2 || *index == transparent || *index >= paletteSize ) continue;
+            const uint8_t *color = palette + *index * 3;
+            pixel[0] = color[0];
+            pixel[1] = color[1];
+            pixel[2] = color[2];
+            pixel[3] = 255;
+        }
+    }
+}
+
+// Variable-width LZW as GIF uses it. Missing data leaves the rest of the
+// frame transparent, as a truncated download would show.
+bool GifDecoder::decodeLzw(const vector<uint8_t> &data, int minCodeSize, size_t pixels, vector<uint8_t> &indices){
+    indices.assign( pixels, 0 );
+    if( minCodeSize < 2 || minCodeSize > 8 || ! pixels ) return false;
+    
+    const int clear = 1 << minCodeSize, end = clear + 1;
+    uint16_t prefix[4096];
+    uint8_t suffix[4096], stack[4097];
+    for(int code = 0; code < clear; code++) suffix[code] = code;
+    
+    int codeSize = minCodeSize + 1, next = clear + 2, previous = -1;
+    uint8_t first = 0;
+    uint32_t bits = 0;
+    int count = 0;
+    size_t pos = 0, out = 0;
+    while( out < pixels ){
+        while( count < codeSize ){
+            if( pos >= data.size() ) return true;
+            bits |= data[pos++] << count;
+            count += 8;
+        }
+        int code = bits & ( ( 1 << codeSize ) - 1 );
+        bits >>= codeSize;
+        count -= codeSize;
+        
+        if( code == clear ){
+            codeSize = minCodeSize + 1;
+            next = clear + 2;
+            previous = -1;
+            continue;
+        }
+        if( code == end ) break;
+        if( previous < 0 ){
+            if( code > clear ) return true;
+            indices[out++] = first = code;
+            previous = code;
+            continue;
+        }
+        
+        int in = code, depth = 0;
+        if( code >= next ){
+            // the code being defined: the previous string and its first index
+            if( code > next ) return true;
+            stack[depth++] = first;
+            code = previous;
+        }
+        while( code >= clear ){
+            stack[depth++] = suffix[code];
+            code = prefix[code];
+        }
+        stack[depth++] = first = code;
+        if( next < 4096 ){
+            prefix[next] = previous;
+            suffix[next] = first;
+            if( ++next == ( 1 << codeSize ) && codeSize < 12 ) codeSize++;
+        }
+        while( depth && out < pixels ) indices[out++] = stack[--depth];
+        previous = in;
+    }
+    return true;
+}
+
+// An animated GIF played as a clip on a panel. Its first frame is decoded
+// with the slide and shown like one; once shown, the frames after it are
+// decoded one at a time on the dispatch queue, cropped to the panel, into a
+// ring of a few frames the panel takes from when they are due.
+
+class GifClip : public std::enable_shared_from_this<GifClip> {
+public:
+    static const size_t RING = 3;
+    
+    // null unless the source is a GIF of more than one frame
+    static std::shared_ptr<GifClip> create(const DataSourceRef &source);
+    
+    SurfaceRef getFirstFrame() const { return mFirstFrame; }
+    
+    // starts the frames after the first, cropped like it was
+    void play(const Area &crop, double time);
+    void stop();
+    
+    // the next frame if it is due and decoded
+    SurfaceRef nextFrame(double time);
+    double getDue();
+    
+private:
+    GifClip();
+    void decodeAhead();
+    
+    GifDecoder          mDecoder;
+    MemoryEntry         mMemory;
+    SurfaceRef          mFirstFrame;
+    float               mFirstDelay;
+    Area                mCrop;
+    
+    std::mutex          mMutex;
+    std::deque<pair<SurfaceRef, float>> mFrames;
+    bool                mDecoding, mStopped;
+    double              mDue;
+};
+
+typedef std::shared_ptr<GifClip> GifClipRef;
+
+GifClip::GifClip()
+: mMemory( MemoryLedger::SURFACES ), mFirstDelay( 0 ), mDecoding( false ), mStopped( true ), mDue( 0 )
+{
+}
+
+GifClipRef GifClip::create(const DataSourceRef &source){
+    GifClipRef clip( new GifClip() );
+    if( ! clip->mDecoder.open( source ) || ! clip->mDecoder.isAnimated() ) return GifClipRef();
+    clip->mFirstDelay = clip->mDecoder.next();
+    clip->mFirstFrame = trackSurface( Surface::create( clip->mDecoder.getCanvas().clone() ) );
+    clip->mMemory.set( clip->mDecoder.getBytes() );
+    return clip;
+}
+
+void GifClip::play(const Area &crop, double time){
+    std::lock_guard<std::mutex> lock( mMutex );
+    mCrop = crop;
+    mDue = time + mFirstDelay;
+    mStopped = false;
+    mFirstFrame.reset();
+    decodeAhead();
+}
+
+void GifClip::stop(){
+    std::lock_guard<std::mutex> lock( mMutex );
+    mStopped = true;
+    mFrames.clear();
+}
+
+SurfaceRef GifClip::nextFrame(double time){
+    std::lock_guard<std::mutex> lock( mMutex );
+    if( mStopped || mFrames.empty() || time < mDue ) return SurfaceRef();
+    
+    SurfaceRef frame = mFrames.front().first;
+    // a frame that comes late restarts the timing from now
+    mDue = ( time - mDue > .25 ? time : mDue ) + mFrames.front().second;
+    mFrames.pop_front();
+    decodeAhead();
+    return frame;
+}
+
+double GifClip::getDue(){
+    std::lock_guard<std::mutex> lock( mMutex );
+    return mStopped ? numeric_limits<double>::max() : mDue;
+}
+
+// with mMutex held
+void GifClip::decodeAhead(){
+    if( mDecoding || mStopped || mFrames.size() >= RING ) return;
+    mDecoding = true;
+    
+    GifClipRef self = shared_from_this();
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+        SurfaceRef frame;
+        float delay = 0;
         try {
-            mDate = boost::gregorian::from_string(projectYaml["date"].as<std::string>());
-        } catch (...) {
-            mDate = boost::gregorian::date(boost::date_time::not_a_date_time);
+            // only one decode runs at a time, the decoder is not shared
+            delay = self->mDecoder.next();
+            frame = trackSurface( Surface::create( self->mDecoder.getCanvas().clone( self->mCrop ) ) );
+            self->mMemory.set( self->mDecoder.getBytes() );
+        } catch( std::exception &e ) {
+            console() << "Stopping the GIF: " << e.what() << endl;
+        }
+        
+        std::lock_guard<std::mutex> lock( self->mMutex );
+        self->mDecoding = false;
+        if( ! frame ) self->mStopped = true;
+        if( self->mStopped ) return;
+        self->mFrames.push_back( make_pair( frame, delay ) );
+        self->decodeAhead();
+    });
+}
+
+#pragma mark TexturePool
+
+// Slide textures, kept for reuse instead of being created and freed at every
+// slide change. A texture at least the size of its panel holds any crop that
+// fits in its top left, so the pool does not depend on the sizes of the
+// slides. Pixels go up through a small ring of pixel buffers: the copy into
+// the buffer is a memcpy and glTexSubImage2D returns without waiting for the
+// GPU. Fences tell when a buffer or a returned texture is still in use by a
+// frame in flight, so neither is written while the GPU reads it.
+// Main thread only, like everything else touching GL.
+
+class TexturePool {
+public:
+    static const int STAGING = 3;
+    static const int GRAIN = 64;
+    
+    TexturePool();
+    
+    // a texture of at least minSize holding the area of the surface in its top left
+    gl::TextureRef upload(const Surface8u &surface, const Area &area, const ivec2 &minSize);
+    // replaces the top left of a texture with the area of the surface
+    void update(const gl::TextureRef &texture, const Surface8u &surface, const Area &area);
+    // allocates textures ahead of the first slides
+    void reserve(const ivec2 &size, int count);
+    // frees the pool's GL objects, textures lent out are freed when they come back
+    void clear();
+    
+    uint64_t getLent() const { return mLent; }
+    uint64_t getHits() const { return mHits; }
+    uint64_t getAllocations() const { return mAllocations; }
+    double getUploadSeconds() const { return mUploadSeconds; }
+    vector<string> report() const;
+    
+private:
+    struct Entry {
+        gl::TextureRef  mTexture;
+        GLsync          mFence;
+    };
+    
+    static bool isDone(GLsync fence);
+    static void dropFence(GLsync &fence);
+    
+    gl::TextureRef allocate(const ivec2 &size);
+    gl::TextureRef lend(const gl::TextureRef &texture);
+    void giveBack(const gl::TextureRef &texture);
+    
+    deque<Entry>        mFree;
+    gl::PboRef          mPbos[STAGING];
+    GLsync              mPboFences[STAGING];
+    int                 mNext;
+    int64_t             mFreeBytes, mFreeBudget;
+    bool                mClosed;
+    uint64_t            mLent, mHits, mAllocations, mUploads, mOrphans;
+    double              mUploadSeconds;
+};
+
+TexturePool gTexturePool;
+
+TexturePool::TexturePool()
+: mNext( 0 ), mFreeBytes( 0 ), mFreeBudget( 64 << 20 ), mClosed( false ), mLent( 0 ), mHits( 0 ), mAllocations( 0 ), mUploads( 0 ), mOrphans( 0 ), mUploadSeconds( 0 )
+{
+    for(int i = 0; i < STAGING; i++){
+        mPboFences[i] = 0;
+    }
+}
+
+bool TexturePool::isDone(GLsync fence){
+    return ! fence || glClientWaitSync( fence, 0, 0 ) != GL_TIMEOUT_EXPIRED;
+}
+
+void TexturePool::dropFence(GLsync &fence){
+    if( fence ) glDeleteSync( fence );
+    fence = 0;
+}
+
+gl::TextureRef TexturePool::upload(const Surface8u &surface, const Area &area, const ivec2 &minSize){
+    ivec2 size = area.getSize();
+    
+    // the smallest free texture the area fits in which no frame in flight still draws
+    auto best = mFree.end();
+    for(auto it = mFree.begin(); it != mFree.end(); ++it){
+        ivec2 free = it->mTexture->getSize();
+        if( free.x < size.x || free.y < size.y || ! isDone( it->mFence ) ) continue;
+        if( best == mFree.end() || free.x * free.y < best->mTexture->getWidth() * best->mTexture->getHeight() ) best = it;
+    }
+    
+    gl::TextureRef texture;
+    if( best != mFree.end() ){
+        texture = best->mTexture;
+        dropFence( best->mFence );
+        mFreeBytes -= (int64_t)texture->getWidth() * texture->getHeight() * 4;
+        mFree.erase( best );
+        mHits++;
+    } else {
+        // slides larger than the panel get room to spare, so similar ones share textures
+        ivec2 grown = ( ( max( size, minSize ) + ivec2( GRAIN - 1 ) ) / GRAIN ) * GRAIN;
+        texture = allocate( size.x > minSize.x || size.y > minSize.y ? grown : max( size, minSize ) );
+    }
+    
+    update( texture, surface, area );
+    return lend( texture );
+}
+
+void TexturePool::update(const gl::TextureRef &texture, const Surface8u &surface, const Area &area){
+    auto start = std::chrono::steady_clock::now();
+    
+    GLenum format = 0;
+    switch( surface.getChannelOrder().getCode() ){
+        case SurfaceChannelOrder::RGBA: case SurfaceChannelOrder::RGBX: format = GL_RGBA; break;
+        case SurfaceChannelOrder::BGRA: case SurfaceChannelOrder::BGRX: format = GL_BGRA; break;
+        case SurfaceChannelOrder::RGB: format = GL_RGB; break;
+        case SurfaceChannelOrder::BGR: format = GL_BGR; break;
+    }
+    // the other orders GL can't take are converted first
+    const Surface8u *source = &surface;
+    Area from = area;
+    Surface8u converted;
+    if( ! format ){
+        converted = Surface8u( area.getWidth(), area.getHeight(), true, SurfaceChannelOrder::RGBA );
+        converted.copyFrom( surface, area, -area.getUL() );
+        source = &converted;
+        from = converted.getBounds();
+        format = GL_RGBA;
+    }
+    
+    // the texels just past the area repeat its last column and row, so
+    // linear filtering at the edge doesn't blend in what an earlier slide
+    // left there; the top and left edges clamp
+    int padX = texture->getWidth() > from.getWidth() ? 1 : 0;
+    int padY = texture->getHeight() > from.getHeight() ? 1 : 0;
+    size_t pixel = source->getPixelInc();
+    size_t row = from.getWidth() * pixel, paddedRow = row + padX * pixel;
+    size_t bytes = paddedRow * ( from.getHeight() + padY );
+    int staging = mNext;
+    mNext = ( mNext + 1 ) % STAGING;
+    
+    gl::PboRef &pbo = mPbos[staging];
+    if( ! pbo || pbo->getSize() < bytes ){
+        pbo = gl::Pbo::create( GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW );
+    } else if( ! isDone( mPboFences[staging] ) ){
+        // the GPU still reads the previous upload, the buffer gets new storage instead of a wait
+        pbo->bufferData( pbo->getSize(), nullptr, GL_STREAM_DRAW );
+        mOrphans++;
+    }
+    dropFence( mPboFences[staging] );
+    
+    gl::ScopedBuffer scopedPbo( pbo );
+    uint8_t *mapped = static_cast<uint8_t*>( pbo->mapBufferRange( 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT ) );
+    if( ! mapped ){
+        console() << "Unable to map a pixel buffer, slide texture not updated" << endl;
+        return;
+    }
+    for(int y = 0; y < from.getHeight(); y++){
+        uint8_t *to = mapped + y * paddedRow;
+        memcpy( to, source->getData( from.getUL() + ivec2( 0, y ) ), row );
+        if( padX ) memcpy( to + row, to + row - pixel, pixel );
+    }
+    if( padY ) memcpy( mapped + from.getHeight() * paddedRow, mapped + ( from.getHeight() - 1 ) * paddedRow, paddedRow );
+    pbo->unmap();
+    
+    gl::ScopedTextureBind scopedTexture( texture );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    glTexSubImage2D( texture->getTarget(), 0, 0, 0, from.getWidth() + padX, from.getHeight() + padY, format, GL_UNSIGNED_BYTE, nullptr );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+    mPboFences[staging] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    
+    mUploads++;
+    mUploadSeconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+void TexturePool::reserve(const ivec2 &size, int count){
+    for(int i = 0; i < count; i++){
+        Entry entry = { allocate( size ), 0 };
+        mFree.push_back( entry );
+    }
+    int64_t bytes = (int64_t)size.x * size.y * 4 * count;
+    mFreeBytes += bytes;
+    mFreeBudget += bytes;
+}
+
+void TexturePool::clear(){
+    for(Entry &entry : mFree) dropFence( entry.mFence );
+    mFree.clear();
+    mFreeBytes = 0;
+    for(int i = 0; i < STAGING; i++){
+        dropFence( mPboFences[i] );
+        mPbos[i].reset();
+    }
+    mClosed = true;
+}
+
+gl::TextureRef TexturePool::allocate(const ivec2 &size){
+    mAllocations++;
+    gl::TextureRef texture = gl::Texture::create( size.x, size.y, gl::Texture::Format().internalFormat( GL_RGBA8 ) );
+    return gMemory.track( MemoryLedger::TEXTURES, texture, (int64_t)size.x * size.y * 4 );
+}
+
+// the returned pointer hands the texture back to the pool when its last reference goes
+gl::TextureRef TexturePool::lend(const gl::TextureRef &texture){
+    mLent++;
+    std::shared_ptr<gl::TextureRef> holder( new gl::TextureRef( texture ), [this]( gl::TextureRef *held ){
+        giveBack( *held );
+        delete held;
+    } );
+    return gl::TextureRef( holder, texture.get() );
+}
+
+void TexturePool::giveBack(const gl::TextureRef &texture){
+    if( mClosed ) return;
+    Entry entry = { texture, glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 ) };
+    mFree.push_back( entry );
+    mFreeBytes += (int64_t)texture->getWidth() * texture->getHeight() * 4;
+    // the textures returned longest ago go first
+    while( mFreeBytes > mFreeBudget && ! mFree.empty() ){
+        mFreeBytes -= (int64_t)mFree.front().mTexture->getWidth() * mFree.front().mTexture->getHeight() * 4;
+        dropFence( mFree.front().mFence );
+        mFree.pop_front();
+    }
+}
+
+vector<string> TexturePool::report() const {
+    vector<string> lines;
+    lines.push_back( ( boost::format( "textures: %d lent, %.0f%% from the pool, %d allocated, %.2fms per upload, %d buffers orphaned, %.1f MB free" )
+                      % mLent % ( mLent ? mHits * 100. / mLent : 0. ) % mAllocations % ( mUploads ? mUploadSeconds * 1000. / mUploads : 0. ) % mOrphans % ( mFreeBytes / 1048576. ) ).str() );
+    return lines;
+}
+
+#pragma mark FadingTexture
+
+class FadingTexture {
+public:
+    FadingTexture();
+    void draw();
+    // shows the area of the surface, which has the panel's shape
+    void fadeToSurface(SurfaceRef newSurface, const Area &area, float duration=1.5f);
+    void fadeToSurface(float duration=1.5f);
+    // plays a GIF clip whose first frame was the last surface faded to
+    void play(const GifClipRef &clip, const Area &crop);
+    void updateClip(double time);
+    
+    bool isVisible() const;
+    bool hasChanged();
+    Rectf getDrawBounds(const Area &area) const;
+    
+    Anim<float>     mCrossFade;
+    Anim<float>     mFade;
+    Area            mBounds;
+    Color           mColor;
+    // pooled textures, the slides fill the areas in their top left
+    gl::TextureRef  mTexture, mLastTexture;
+    Area            mArea, mLastArea;
+    GifClipRef      mClip;
+    
+private:
+    float           mSeenFade, mSeenCrossFade;
+    gl::Texture     *mSeenTexture, *mSeenLastTexture;
+    int             mClipFrame, mSeenClipFrame;
+};
+
+// Functor which empties the FadingTexture pointed to by ftPtr
+struct ResetFadingTextureFunctor {
+    ResetFadingTextureFunctor( FadingTexture *ftPtr )
+    : mFadingTexturePtr( ftPtr )
+    {}
+    
+    void operator()() {
+        mFadingTexturePtr->mLastTexture.reset();
+        mFadingTexturePtr->mTexture.reset();
+        if( mFadingTexturePtr->mClip ) mFadingTexturePtr->mClip->stop();
+        mFadingTexturePtr->mClip.reset();
+    }
+    
+    FadingTexture	*mFadingTexturePtr;
+};
+
+FadingTexture::FadingTexture(){
+    mFade = 0.0;
+    mCrossFade = 0.0;
+    mColor = Color::white();
+    mSeenFade = mSeenCrossFade = 0.f;
+    mSeenTexture = mSeenLastTexture = NULL;
+    mClipFrame = mSeenClipFrame = 0;
+}
+
+void FadingTexture::draw(){
+    
+    Rectf drawBounds;
+    
+    if( mLastTexture ) {
+        gl::color( mColor.r, mColor.g, mColor.b, (1.0f - mCrossFade)*mFade );
+        drawBounds = getDrawBounds( mLastArea );
+        gl::draw( mLastTexture, mLastArea, drawBounds );
+    }
+    if( mTexture ) {
+        gl::color( mColor.r, mColor.g, mColor.b, mCrossFade*mFade );
+        drawBounds = getDrawBounds( mArea );
+        gl::draw( mTexture, mArea, drawBounds );
+    }
+    {
+        gl::ScopedBlendAdditive  blendAdditive;
+        //    gl::enableAdditiveBlending();
+        gl::color( 1.0-mColor.r, 1.0-mColor.g, 1.0-mColor.b, mFade*.5 );
+        gl::drawSolidRect(drawBounds);
+    }
+    //    gl::enableAlphaBlending();
+    
+}
+
+bool FadingTexture::isVisible() const {
+    return mFade > 0.f && (mTexture || mLastTexture);
+}
+
+// true when the panel looks different than at the previous call
+bool FadingTexture::hasChanged(){
+    bool changed = mFade != mSeenFade || mCrossFade != mSeenCrossFade || mTexture.get() != mSeenTexture || mLastTexture.get() != mSeenLastTexture || mClipFrame != mSeenClipFrame;
+    mSeenFade = mFade;
+    mSeenClipFrame = mClipFrame;
+    mSeenCrossFade = mCrossFade;
+    mSeenTexture = mTexture.get();
+    mSeenLastTexture = mLastTexture.get();
+    return changed;
+}
+
+void FadingTexture::play(const GifClipRef &clip, const Area &crop){
+    mClip = clip;
+    mClip->play( crop, showTime() );
+}
+
+// uploads the clip's next frame over the current one, the same size
+void FadingTexture::updateClip(double time){
+    SurfaceRef frame = mClip ? mClip->nextFrame( time ) : SurfaceRef();
+    if( frame && mTexture ){
+        gTexturePool.update( mTexture, *frame, frame->getBounds() );
+        mClipFrame++;
+    }
+}
+
+Rectf FadingTexture::getDrawBounds(const Area &area) const {
+    Rectf textureBounds = area;
+    return textureBounds.getCenteredFit( mBounds, true );
+}
+
+// the part of a slide a panel shows: the panel's shape, as large as fits
+Area getSlideCrop(const Area &panel, const Area &slide){
+    return Area::proportionalFit( panel, slide, true, true );
+}
+
+void FadingTexture::fadeToSurface(float duration){
+    showTimeline().apply( &mFade, 0.0f, duration ).finishFn(ResetFadingTextureFunctor( this ));
+}
+
+void FadingTexture::fadeToSurface(SurfaceRef newSurface, const Area &area, float duration){
+    
+    if( newSurface ) {
+        mLastTexture = mTexture; // the "last" texture is now the current text
+        mLastArea = mArea;
+        if( mClip ) mClip->stop();
+        mClip.reset();
+        
+        mTexture = gTexturePool.upload( *newSurface, area, mBounds.getSize() );
+        mArea = Area( ivec2( 0 ), area.getSize() );
+        
+        // blend from 0 to 1 over 1.5sec
+        showTimeline().apply( &mCrossFade, 0.0f, 1.0f, duration );
+        showTimeline().apply( &mFade, 1.0f, duration );
+        
+    } else {
+        showTimeline().apply( &mFade, 0.0f, duration );
+    }
+    
+}
+
+#pragma mark PanelCompositor
+
+// Draws all FadingTexture panels in a single pass: each panel contributes its
+// last and current texture (cross-faded and tinted) plus the inverse-tint
+// additive overlay. Layers are accumulated premultiplied in the fragment
+// shader, so the result matches drawing the panels one after another with
+// alpha and additive blending.
+
+class PanelCompositor {
+public:
+    static const int MAX_PANELS = 4;
+    
+    PanelCompositor();
+    bool setup(const Rectf &bounds);
+    bool draw(FadingTexture * const panels[], int numPanels);
+    
+    gl::GlslProgRef mGlsl;
+    gl::BatchRef    mBatch;
+    
+private:
+    vec4            mRects[MAX_PANELS*2];
+    vec4            mTexCoords[MAX_PANELS*2];
+    float           mAlphas[MAX_PANELS*2];
+    vec3            mColors[MAX_PANELS];
+    vec4            mOverlayRects[MAX_PANELS];
+    float           mOverlayAlphas[MAX_PANELS];
+};
+
+static const char *sPanelCompositorVert = R"(
+#version 150
+uniform mat4    ciModelViewProjection;
+in vec4         ciPosition;
+out vec2        vPosition;
+
+void main() {
+    vPosition = ciPosition.xy;
+    gl_Position = ciModelViewProjection * ciPosition;
+}
+)";
+
+static const char *sPanelCompositorFrag = R"(
+#version 150
+uniform sampler2D   uTex0, uTex1, uTex2, uTex3, uTex4, uTex5, uTex6, uTex7;
+uniform vec4        uRects[8];
+uniform vec4        uTexCoords[8];
+uniform float       uAlphas[8];
+uniform vec3        uColors[4];
+uniform vec4        uOverlayRects[4];
+uniform float       uOverlayAlphas[4];
+in vec2             vPosition;
+out vec4            oColor;
+
+bool inside( vec4 rect ) {
+    return all( greaterThanEqual( vPosition, rect.xy ) ) && all( lessThan( vPosition, rect.zw ) );
+}
+
+// premultiplied color of texture layer i, transparent outside its rect
+vec4 layer( sampler2D tex, int i ) {
+    if( uAlphas[i] <= 0.0 || ! inside( uRects[i] ) )
+        return vec4( 0.0 );
+    vec2 t = ( vPosition - uRects[i].xy ) / ( uRects[i].zw - uRects[i].xy );
+    vec4 texel = texture( tex, mix( uTexCoords[i].xy, uTexCoords[i].zw, t ) );
+    float a = texel.a * uAlphas[i];
+    return vec4( texel.rgb * uColors[i/2] * a, a );
+}
+
+vec4 over( vec4 dst, vec4 src ) {
+    return src + dst * ( 1.0 - src.a );
+}
+
+// additive inverse-tint overlay of panel p, leaves coverage untouched
+vec4 overlay( vec4 dst, int p ) {
+    if( uOverlayAlphas[p] <= 0.0 || ! inside( uOverlayRects[p] ) )
+        return dst;
+    return vec4( dst.rgb + ( vec3( 1.0 ) - uColors[p] ) * uOverlayAlphas[p], dst.a );
+}
+
+void main() {
+    vec4 c = vec4( 0.0 );
+    c = overlay( over( over( c, layer( uTex0, 0 ) ), layer( uTex1, 1 ) ), 0 );
+    c = overlay( over( over( c, layer( uTex2, 2 ) ), layer( uTex3, 3 ) ), 1 );
+    c = overlay( over( over( c, layer( uTex4, 4 ) ), layer( uTex5, 5 ) ), 2 );
+    c = overlay( over( over( c, layer( uTex6, 6 ) ), layer( uTex7, 7 ) ), 3 );
+    oColor = c;
+}
+)";
+
+PanelCompositor::PanelCompositor(){
+    for(int i = 0; i < MAX_PANELS*2; i++){
+        mAlphas[i] = 0.f;
+    }
+    for(int i = 0; i < MAX_PANELS; i++){
+        mOverlayAlphas[i] = 0.f;
+    }
+}
+
+bool PanelCompositor::setup(const Rectf &bounds){
+    try {
+        mGlsl = gl::GlslProg::create( gl::GlslProg::Format().vertex( sPanelCompositorVert ).fragment( sPanelCompositorFrag ) );
+        for(int i = 0; i < MAX_PANELS*2; i++){
+            mGlsl->uniform( "uTex" + toString(i), i );
+        }
+        mBatch = gl::Batch::create( geom::Rect( bounds ), mGlsl );
+    } catch( std::exception &e ) {
+        console() << "Panel compositor unavailable, drawing panels one by one: " << e.what() << endl;
+        mGlsl.reset();
+        mBatch.reset();
+    }
+    return (bool)mBatch;
+}
+
+bool PanelCompositor::draw(FadingTexture * const panels[], int numPanels){
+    
+    if( ! mBatch ) return false;
+    
+    vector<pair<gl::TextureRef, int>> bound;
+    
+    for(int p = 0; p < MAX_PANELS; p++){
+        
+        mAlphas[p*2] = mAlphas[p*2+1] = 0.f;
+        mOverlayAlphas[p] = 0.f;
+        
+        if(p >= numPanels || ! panels[p]->isVisible()) continue;
+        
+        FadingTexture *panel = panels[p];
+        gl::TextureRef textures[2] = { panel->mLastTexture, panel->mTexture };
+        Area areas[2] = { panel->mLastArea, panel->mArea };
+        float alphas[2] = { (1.0f - panel->mCrossFade)*panel->mFade, panel->mCrossFade*panel->mFade };
+        Rectf drawBounds;
+        
+        for(int t = 0; t < 2; t++){
+            if( ! textures[t] ) continue;
+            int i = p*2+t;
+            drawBounds = panel->getDrawBounds( areas[t] );
+            mRects[i] = vec4( drawBounds.x1, drawBounds.y1, drawBounds.x2, drawBounds.y2 );
+            Rectf texCoords = textures[t]->getAreaTexCoords( areas[t] );
+            mTexCoords[i] = vec4( texCoords.x1, texCoords.y1, texCoords.x2, texCoords.y2 );
+            mAlphas[i] = alphas[t];
+            if( alphas[t] > 0.f ) bound.push_back( make_pair( textures[t], i ) );
+        }
+        
+        mColors[p] = vec3( panel->mColor.r, panel->mColor.g, panel->mColor.b );
+        mOverlayRects[p] = vec4( drawBounds.x1, drawBounds.y1, drawBounds.x2, drawBounds.y2 );
+        mOverlayAlphas[p] = panel->mFade*.5f;
+    }
+    
+    // nothing to composite when all layers and overlays are fully transparent;
+    // an overlay still shows over panels whose textures are faded out
+    bool overlays = false;
+    for(int p = 0; p < MAX_PANELS; p++){
+        overlays = overlays || mOverlayAlphas[p] > 0.f;
+    }
+    if( bound.empty() && ! overlays ) return true;
+    
+    mGlsl->uniform( "uRects", mRects, MAX_PANELS*2 );
+    mGlsl->uniform( "uTexCoords", mTexCoords, MAX_PANELS*2 );
+    mGlsl->uniform( "uAlphas", mAlphas, MAX_PANELS*2 );
+    mGlsl->uniform( "uColors", mColors, MAX_PANELS );
+    mGlsl->uniform( "uOverlayRects", mOverlayRects, MAX_PANELS );
+    mGlsl->uniform( "uOverlayAlphas", mOverlayAlphas, MAX_PANELS );
+    
+    for(auto &b : bound) b.first->bind( b.second );
+    {
+        gl::ScopedBlendPremult blendPremult;
+        mBatch->draw();
+    }
+    for(auto &b : bound) b.first->unbind( b.second );
+    
+    return true;
+}
+
+#pragma mark DirtyRegions
+
+// Collects the rectangles that changed during a frame and merges them into at
+// most one rectangle per screen column (the three heads). The layers are
+// drawn once per dirty column, scissored and culled to its rectangle, so a
+// head nothing changed on isn't redrawn.
+
+class DirtyRegions {
+public:
+    DirtyRegions(const Rectf &bounds=Rectf(), int columns=3);
+    
+    void add(const Rectf &rect);
+    void addAll();
+    bool isEmpty() const;
+    const vector<Rectf>& getRects() const { return mRects; }
+    void endFrame();
+    
+    Rectf           mBounds;
+    
+private:
+    int             mColumns;
+    vector<Rectf>   mRects;     // this frame, one (possibly empty) rect per column
+};
+
+DirtyRegions::DirtyRegions(const Rectf &bounds, int columns)
+: mBounds( bounds ), mColumns( columns ), mRects( columns, Rectf( 0, 0, 0, 0 ) )
+{}
+
+void DirtyRegions::add(const Rectf &rect){
+    
+    float columnWidth = mBounds.getWidth() / mColumns;
+    
+    for(int i = 0; i < mColumns; i++){
+        Rectf column( mBounds.x1 + i*columnWidth, mBounds.y1, mBounds.x1 + (i+1)*columnWidth, mBounds.y2 );
+        if( ! column.intersects( rect ) ) continue;
+        Rectf clipped = rect.getClipBy( column );
+        if( clipped.getWidth() <= 0 || clipped.getHeight() <= 0 ) continue;
+        if( mRects[i].getWidth() <= 0 ) mRects[i] = clipped;
+        else mRects[i].include( clipped );
+    }
+}
+
+void DirtyRegions::addAll(){
+    add( mBounds );
+}
+
+bool DirtyRegions::isEmpty() const {
+    for(const Rectf &r : mRects){
+        if( r.getWidth() > 0 ) return false;
+    }
+    return true;
+}
+
+void DirtyRegions::endFrame(){
+    mRects.assign( mColumns, Rectf( 0, 0, 0, 0 ) );
+}
+
+// Remembers the value an Anim had when last asked, to tell whether it moved.
+template<typename T>
+class Watched {
+public:
+    Watched(const Anim<T> *anim) : mAnim( anim ), mSeen( anim->value() ) {}
+    
+    bool changed(){
+        bool changed = mAnim->value() != mSeen;
+        mSeen = mAnim->value();
+        return changed;
+    }
+    
+private:
+    const Anim<T>   *mAnim;
+    T               mSeen;
+};
+
+#pragma mark Profiler
+
+// Rolling timings of the named sections of a frame. Every section is timed
+// on the CPU and summed per frame; sections started with gpu set are also
+// timed with GL timer queries, which are read back frames later so the CPU
+// never waits on them. Timer queries can't nest, so a GPU section inside
+// another one is timed on the CPU only.
+
+class Profiler {
+public:
+    struct Stats {
+        size_t  mCount;
+        float   mP50, mP95, mP99, mMax;
+    };
+    
+    Profiler();
+    
+    void setWindow(size_t frames) { mWindow = max<size_t>( frames, 1 ); }
+    void setGpuEnabled(bool enabled) { mGpuEnabled = enabled; }
+    
+    void beginFrame();
+    void endFrame();
+    void begin(const string &section, bool gpu=false);
+    void end();
+    
+    // one line per section, milliseconds over the window
+    vector<string> report() const;
+    // every section's CPU or GPU times, in milliseconds over the window
+    vector<pair<string, Stats>> getStats(bool gpu=false) const;
+    
+private:
+    static const int QUERIES = 8;
+    
+    typedef std::chrono::high_resolution_clock Clock;
+    
+    struct Samples {
+        Samples() : mNext( 0 ) {}
+        void add(float value, size_t window);
+        Stats getStats() const;
+        vector<float>   mValues;
+        size_t          mNext;
+    };
+    
+    struct Section {
+        Section() : mFrameTime( 0 ), mNextQuery( 0 ) { for(int i = 0; i < QUERIES; i++) { mQueries[i] = 0; mPending[i] = false; } }
+        Samples         mCpu, mGpu;
+        float           mFrameTime;
+        GLuint          mQueries[QUERIES];
+        bool            mPending[QUERIES];
+        int             mNextQuery;
+    };
+    
+    struct Open {
+        Section             *mSection;
+        Clock::time_point   mStart;
+        int                 mQuery;
+    };
+    
+    map<string, Section>    mSections;
+    vector<Open>            mOpen;
+    size_t                  mWindow;
+    bool                    mGpuEnabled;
+    bool                    mGpuBusy;
+    Clock::time_point       mFrameStart;
+};
+
+// Times the enclosing scope as a section.
+class ScopedProfile {
+public:
+    ScopedProfile(Profiler &profiler, const string &section, bool gpu=false) : mProfiler( profiler ) { mProfiler.begin( section, gpu ); }
+    ~ScopedProfile() { mProfiler.end(); }
+private:
+    Profiler &mProfiler;
+};
+
+Profiler gProfiler;
+
+void Profiler::Samples::add(float value, size_t window){
+    if( mValues.size() < window ){
+        mValues.push_back( value );
+    } else {
+        mValues[mNext % mValues.size()] = value;
+    }
+    mNext = (mNext + 1) % window;
+}
+
+Profiler::Stats Profiler::Samples::getStats() const {
+    Stats stats = { mValues.size(), 0, 0, 0, 0 };
+    if( mValues.empty() ) return stats;
+    vector<float> sorted( mValues );
+    sort( sorted.begin(), sorted.end() );
+    auto percentile = [&sorted]( float p ){ return sorted[min<size_t>( p * sorted.size(), sorted.size() - 1 )]; };
+    stats.mP50 = percentile( .5f );
+    stats.mP95 = percentile( .95f );
+    stats.mP99 = percentile( .99f );
+    stats.mMax = sorted.back();
+    return stats;
+}
+
+Profiler::Profiler()
+: mWindow( 600 ), mGpuEnabled( true ), mGpuBusy( false ), mFrameStart( Clock::now() )
+{
+}
+
+void Profiler::beginFrame(){
+    // the time between frames, including any time the frame rate cap waited
+    Clock::time_point now = Clock::now();
+    mSections["frame"].mCpu.add( std::chrono::duration<float, std::milli>( now - mFrameStart ).count(), mWindow );
+    mFrameStart = now;
+}
+
+void Profiler::endFrame(){
+    
+    for(auto &entry : mSections){
+        Section &section = entry.second;
+        
+        if( section.mFrameTime > 0 ){
+            section.mCpu.add( section.mFrameTime, mWindow );
+            section.mFrameTime = 0;
+        }
+        
+        for(int i = 0; i < QUERIES; i++){
+            if( ! section.mPending[i] ) continue;
+            GLint available = 0;
+            glGetQueryObjectiv( section.mQueries[i], GL_QUERY_RESULT_AVAILABLE, &available );
+            if( ! available ) continue;
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v( section.mQueries[i], GL_QUERY_RESULT, &nanoseconds );
+            section.mGpu.add( nanoseconds / 1e6f, mWindow );
+            section.mPending[i] = false;
+        }
+    }
+}
+
+void Profiler::begin(const string &section, bool gpu){
+    
+    Open open = { &mSections[section], Clock::time_point(), -1 };
+    
+    // skipped while all of the section's queries are still in flight
+    if( gpu && mGpuEnabled && ! mGpuBusy && ! open.mSection->mPending[open.mSection->mNextQuery] ){
+        int &query = open.mSection->mNextQuery;
+        if( ! open.mSection->mQueries[query] ) glGenQueries( 1, &open.mSection->mQueries[query] );
+        glBeginQuery( GL_TIME_ELAPSED, open.mSection->mQueries[query] );
+        open.mQuery = query;
+        query = (query + 1) % QUERIES;
+        mGpuBusy = true;
+    }
+    
+    open.mStart = Clock::now();
+    mOpen.push_back( open );
+}
+
+void Profiler::end(){
+    
+    Open &open = mOpen.back();
+    open.mSection->mFrameTime += std::chrono::duration<float, std::milli>( Clock::now() - open.mStart ).count();
+    
+    if( open.mQuery >= 0 ){
+        glEndQuery( GL_TIME_ELAPSED );
+        open.mSection->mPending[open.mQuery] = true;
+        mGpuBusy = false;
+    }
+    
+    mOpen.pop_back();
+}
+
+vector<pair<string, Profiler::Stats>> Profiler::getStats(bool gpu) const {
+    vector<pair<string, Stats>> stats;
+    for(const auto &entry : mSections){
+        stats.push_back( make_pair( entry.first, gpu ? entry.second.mGpu.getStats() : entry.second.mCpu.getStats() ) );
+    }
+    return stats;
+}
+
+vector<string> Profiler::report() const {
+    vector<string> lines;
+    lines.push_back( "section              cpu p50   p95   p99   max     gpu p50   p95   p99   max  (ms)" );
+    for(const auto &entry : mSections){
+        Stats cpu = entry.second.mCpu.getStats(), gpu = entry.second.mGpu.getStats();
+        string line = ( boost::format( "%-20s %6.2f %5.2f %5.2f %5.2f" ) % entry.first % cpu.mP50 % cpu.mP95 % cpu.mP99 % cpu.mMax ).str();
+        if( gpu.mCount ){
+            line += ( boost::format( "  %6.2f %5.2f %5.2f %5.2f" ) % gpu.mP50 % gpu.mP95 % gpu.mP99 % gpu.mMax ).str();
+        }
+        lines.push_back( line );
+    }
+    return lines;
+}
+
+#pragma mark QualityGovernor
+
+// Steps the expensive features down a level while frames run over budget
+// and back up while they keep to it. Frames are judged in windows: a window
+// where more than a tenth of the frames missed the budget steps down, and
+// a run of windows on budget steps up again. A step up that runs over
+// straight away doubles the run needed before the next try, so a display
+// that can't keep up settles on the level it can rather than flickering.
+
+class QualityGovernor {
+public:
+    struct Level {
+        int     mStripeLayers;
+        size_t  mSnowflakes;
+        float   mTextScale;     // resolution of the title glyphs
+        float   mTextureScale;  // resolution of the slides
+    };
+    
+    QualityGovernor();
+    
+    // the full quality level and the frame budget, the lower levels follow
+    void setup(const Level &full, float budgetMs);
+    // a new frame budget, at the level reached so far
+    void setBudget(float budgetMs) { mBudget = budgetMs; }
+    
+    // the interval of a frame that drew something; true when the level changed
+    bool addFrame(float ms);
+    
+    const Level &getLevel() const { return mLevels[mLevel]; }
+    size_t getLevelIndex() const { return mLevel; }
+    const string &getReason() const { return mReason; }
+    
+private:
+    static const int WINDOW = 120;      // frames per decision
+    static const int UP_AFTER = 15;     // windows on budget before a step up
+    static const int UP_AFTER_MAX = 240;
+    
+    vector<Level>   mLevels;
+    size_t          mLevel;
+    float           mBudget;
+    int             mFrames, mOver;     // in the current window
+    int             mOnBudget;          // windows in a row
+    int             mUpAfter;
+    bool            mTrial;             // the last change was a step up
+    string          mReason;
+};
+
+QualityGovernor::QualityGovernor()
+: mLevel( 0 ), mBudget( 1000/60.f ), mFrames( 0 ), mOver( 0 ), mOnBudget( 0 ), mUpAfter( UP_AFTER ), mTrial( false )
+{
+    mLevels.push_back( { 3, 100, 1.f, 1.f } );
+}
+
+void QualityGovernor::setup(const Level &full, float budgetMs){
+    mBudget = budgetMs;
+    mLevels = {
+        full,
+        { full.mStripeLayers, full.mSnowflakes/2, full.mTextScale, full.mTextureScale*.75f },
+        { max( full.mStripeLayers-1, 1 ), full.mSnowflakes/4, full.mTextScale*.5f, full.mTextureScale*.75f },
+        { 1, full.mSnowflakes/8, full.mTextScale*.5f, full.mTextureScale*.5f },
+    };
+    mLevel = 0;
+}
+
+bool QualityGovernor::addFrame(float ms){
+    
+    // a frame that missed the budget takes about two of them
+    if( ms > mBudget*1.5f ) mOver++;
+    if( ++mFrames < WINDOW ) return false;
+    
+    float over = mOver / float( mFrames );
+    mFrames = mOver = 0;
+    
+    if( over > .1f ){
+        mOnBudget = 0;
+        if( mTrial ) mUpAfter = min( mUpAfter*2, UP_AFTER_MAX );
+        mTrial = false;
+        if( mLevel + 1 >= mLevels.size() ) return false;
+        mLevel++;
+        mReason = ( boost::format( "%.0f%% of frames over %.1fms" ) % ( over*100 ) % mBudget ).str();
+        return true;
+    }
+    
+    if( over > .02f ){
+        mOnBudget = 0;
+        return false;
+    }
+    
+    mTrial = false;
+    if( ++mOnBudget < mUpAfter || mLevel == 0 ) return false;
+    mOnBudget = 0;
+    mLevel--;
+    mTrial = true;
+    mReason = ( boost::format( "%d windows on budget" ) % mUpAfter ).str();
+    return true;
+}
+
+#pragma mark Layer
+
+// One section of the screen in the retained draw() tree. Layers draw their
+// children after themselves and are culled (with their children) while their
+// opacity is zero. A cached layer renders into an offscreen target covering
+// its bounds only when marked dirty, and composites that target with its
+// opacity every frame. Every layer also reports the part of the window it
+// touches when its opacity or content changed, so only that part is redrawn.
+
+typedef std::shared_ptr<class Layer> LayerRef;
+
+class Layer {
+public:
+    typedef std::function<void(float)>  DrawFn;
+    typedef std::function<float()>      OpacityFn;
+    typedef std::function<bool()>       ChangedFn;
+    typedef std::function<void(DirtyRegions&)> DirtyFn;
+    
+    static LayerRef create(const std::string &name, const DrawFn &drawFn, const OpacityFn &opacityFn = OpacityFn());
+    
+    LayerRef addChild(const LayerRef &child);
+    void setCached(const Rectf &bounds);
+    void markDirty();
+    float getOpacity() const;
+    void collectDirty(DirtyRegions &regions, float parentOpacity=1.f);
+    void draw(float parentOpacity=1.f, const Rectf &clip=Rectf());
+    
+    std::string         mName;
+    DrawFn              mDrawFn;
+    OpacityFn           mOpacityFn;
+    vector<LayerRef>    mChildren;
+    bool                mCached;
+    bool                mDirty;
+    Rectf               mBounds;
+    gl::FboRef          mFbo;
+    Rectf               mRegion;        // where the layer may draw, empty for everywhere
+    ChangedFn           mChangedFn;     // content animating this frame
+    DirtyFn             mDirtyFn;       // reports finer dirty rects itself
+    float               mSeenOpacity;
+    
+    // cached layers composited as they were, and re-rendered
+    static uint64_t     sCacheHits, sCacheMisses;
+    
+private:
+    Layer(const std::string &name, const DrawFn &drawFn, const OpacityFn &opacityFn);
+    void renderCache();
+};
+
+uint64_t Layer::sCacheHits = 0;
+uint64_t Layer::sCacheMisses = 0;
+
+LayerRef Layer::create(const std::string &name, const DrawFn &drawFn, const OpacityFn &opacityFn){
+    return LayerRef( new Layer( name, drawFn, opacityFn ) );
+}
+
+Layer::Layer(const std::string &name, const DrawFn &drawFn, const OpacityFn &opacityFn)
+: mName( name ), mDrawFn( drawFn ), mOpacityFn( opacityFn ), mCached( false ), mDirty( true ), mSeenOpacity( 0.f )
+{}
+
+LayerRef Layer::addChild(const LayerRef &child){
+    mChildren.push_back( child );
+    return child;
+}
+
+void Layer::setCached(const Rectf &bounds){
+    mCached = true;
+    mBounds = mRegion = bounds;
+    mFbo.reset();
+    mDirty = true;
+}
+
+void Layer::markDirty(){
+    mDirty = true;
+}
+
+float Layer::getOpacity() const {
+    return mOpacityFn ? mOpacityFn() : 1.f;
+}
+
+void Layer::renderCache(){
+    
+    ivec2 size( ceil( mBounds.getWidth() ), ceil( mBounds.getHeight() ) );
+    
+    if( ! mFbo || mFbo->getSize() != size ){
+        try {
+            mFbo = gMemory.track( MemoryLedger::TEXT_CACHES, gl::Fbo::create( size.x, size.y, gl::Fbo::Format().colorTexture() ), (int64_t)size.x * size.y * 4 );
+        } catch( std::exception &e ) {
+            console() << "Layer " << mName << " drawn uncached: " << e.what() << endl;
+            mCached = false;
+            mFbo.reset();
+            return;
+        }
+    }
+    
+    gl::ScopedFramebuffer   scopedFbo( mFbo );
+    gl::ScopedViewport      scopedViewport( ivec2( 0 ), size );
+    gl::ScopedState         scopedScissor( GL_SCISSOR_TEST, false );
+    gl::ScopedMatrices      scopedMatrices;
+    gl::setMatricesWindow( size );
+    gl::translate( -mBounds.getUpperLeft() );
+    gl::clear( ColorA( 0.f, 0.f, 0.f, 0.f ) );
+    {
+        // keep the target premultiplied, so it can be faded as a whole
+        gl::ScopedBlend blend( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+        mDrawFn( 1.f );
+    }
+    mDirty = false;
+}
+
+void Layer::collectDirty(DirtyRegions &regions, float parentOpacity){
+    
+    float opacity = parentOpacity * getOpacity();
+    Rectf region = mRegion.getWidth() > 0 ? mRegion : regions.mBounds;
+    
+    // always ask, so the change functions keep track of the previous frame
+    bool changed = mChangedFn && mChangedFn();
+    
+    if( opacity != mSeenOpacity ){
+        regions.add( region );
+    } else if( opacity > 0.f ){
+        if( mDirtyFn ) mDirtyFn( regions );
+        if( changed || ( mCached && mDirty ) ) regions.add( region );
+    }
+    mSeenOpacity = opacity;
+    
+    for(LayerRef &child : mChildren) child->collectDirty( regions, opacity );
+}
+
+void Layer::draw(float parentOpacity, const Rectf &clip){
+    
+    float opacity = parentOpacity * getOpacity();
+    if( opacity <= 0.f ) return;
+    if( clip.getWidth() > 0 && mRegion.getWidth() > 0 && ! mRegion.intersects( clip ) ) return;
+    
+    if( mDrawFn ){
+        ScopedProfile profile( gProfiler, mName, true );
+        
+        if( mCached ) ( mDirty ? sCacheMisses : sCacheHits )++;
+        if( mCached && mDirty ) renderCache();
+        
+        if( mCached ){
+            gl::ScopedBlendPremult blendPremult;
+            gl::color( ColorA( opacity, opacity, opacity, opacity ) );
+            gl::draw( mFbo->getColorTexture(), mBounds );
+        } else {
+            mDrawFn( opacity );
+        }
+    }
+    
+    for(LayerRef &child : mChildren) child->draw( opacity, clip );
+}
+
+#pragma mark Stripes
+
+// Fills perms with the table ci::Perlin builds for the same seed, so noise
+// evaluated elsewhere (e.g. on the GPU) matches the app's Perlin instance.
+static void perlinPermutations(int32_t seed, uint8_t perms[512]){
+    Rand rand( seed );
+    for(size_t t = 0; t < 256; ++t){
+        perms[t] = perms[t + 256] = rand.nextUint() & 255;
+    }
+}
+
+// The stripe effect as one static vertex buffer. Every vertex only knows its
+// layer, segment and corner; the vertex shader displaces it with the same
+// Perlin noise and parameters the per-frame PolyLine2f version used. At high
+// noise a segment's sides can cross into a bow-tie, so each segment is drawn
+// as its bounding box and the fragment shader keeps what lies between the
+// two sides, which is what drawSolid's odd winding rule filled.
+
+class Stripes {
+public:
+    static const int MAX_LAYERS = 16;
+    
+    bool setup(int32_t seed);
+    // the noise's permutations, from the seed
+    void setSeed(int32_t seed);
+    void draw(int numLayers, double time, float noise, float squareness, const vec2 &position, const ColorA &firstColor, const ColorA &layerColor, const vec2 &size);
+    
+    gl::GlslProgRef mGlsl;
+    gl::BatchRef    mBatch;
+    gl::TextureRef  mPermutations;
+};
+
+static const char *sStripesVert = R"(
+#version 150
+uniform mat4        ciModelViewProjection;
+uniform sampler2D   uPerms;
+uniform vec4        uNoiseTime;     // noise x coordinate of each corner
+uniform float       uNoise;
+uniform float       uSquareness;
+uniform vec2        uPosition;
+uniform vec2        uSize;
+uniform vec4        uFirstColor;
+uniform vec4        uLayerColor;
+in vec4             ciPosition;     // layer, segment, corner
+out vec4            vColor;
+out float           vX, vT;         // canvas x, and 0 at the top to 1 at the bottom
+flat out vec4       vSides;         // x of the left side's top and bottom, then the right side's
+
+int perm( int i ) {
+    return int( texelFetch( uPerms, ivec2( i, 0 ), 0 ).r * 255.0 + 0.5 );
+}
+
+float fade( float t ) {
+    return t * t * t * ( t * ( t * 6.0 - 15.0 ) + 10.0 );
+}
+
+float nlerp( float t, float a, float b ) {
+    return a + t * ( b - a );
+}
+
+float grad( int hash, float x, float y, float z ) {
+    int h = hash & 15;
+    float u = h < 8 ? x : y;
+    float v = h < 4 ? y : ( h == 12 || h == 14 ? x : z );
+    return ( ( h & 1 ) == 0 ? u : -u ) + ( ( h & 2 ) == 0 ? v : -v );
+}
+
+float noiseImpl( vec3 p ) {
+    vec3 f = floor( p );
+    int X = int( f.x ) & 255, Y = int( f.y ) & 255, Z = int( f.z ) & 255;
+    p -= f;
+    float u = fade( p.x ), v = fade( p.y ), w = fade( p.z );
+    int A = perm( X ) + Y, AA = perm( A ) + Z, AB = perm( A + 1 ) + Z;
+    int B = perm( X + 1 ) + Y, BA = perm( B ) + Z, BB = perm( B + 1 ) + Z;
+    return nlerp( w, nlerp( v, nlerp( u, grad( perm( AA ), p.x, p.y, p.z ), grad( perm( BA ), p.x - 1.0, p.y, p.z ) ),
+                               nlerp( u, grad( perm( AB ), p.x, p.y - 1.0, p.z ), grad( perm( BB ), p.x - 1.0, p.y - 1.0, p.z ) ) ),
+                     nlerp( v, nlerp( u, grad( perm( AA + 1 ), p.x, p.y, p.z - 1.0 ), grad( perm( BA + 1 ), p.x - 1.0, p.y, p.z - 1.0 ) ),
+                               nlerp( u, grad( perm( AB + 1 ), p.x, p.y - 1.0, p.z - 1.0 ), grad( perm( BB + 1 ), p.x - 1.0, p.y - 1.0, p.z - 1.0 ) ) ) );
+}
+
+// four octaves, like ci::Perlin's default
+float noise( vec3 p ) {
+    float result = 0.0, amp = 0.5;
+    for( int i = 0; i < 4; i++ ) {
+        result += noiseImpl( p ) * amp;
+        p *= 2.0;
+        amp *= 0.5;
+    }
+    return result;
+}
+
+// the displaced x of a corner, clockwise from the top left
+float cornerX( int corner, int layer, float k, float segmentWidth, float third ) {
+    float noiseX, x;
+    if( corner == 0 ) {
+        noiseX = noise( vec3( uNoiseTime.x, k, 2.0 ) );
+        noiseX = mix( noiseX, noiseX - 1.0, uSquareness );
+        x = mix( segmentWidth, 0.0, uSquareness );
+    } else if( corner == 1 ) {
+        noiseX = noise( vec3( uNoiseTime.y, k, 1.5 ) );
+        noiseX = mix( noiseX, noiseX + 1.0, uSquareness );
+        x = third;
+    } else if( corner == 2 ) {
+        noiseX = noise( vec3( uNoiseTime.z, k, 37.0 ) );
+        noiseX = mix( noiseX, noiseX + 1.0, uSquareness );
+        x = third - mix( segmentWidth, 0.0, uSquareness );
+    } else {
+        noiseX = noise( vec3( uNoiseTime.w, k, 3.33 ) );
+        noiseX = mix( noiseX, noiseX - 1.0, uSquareness );
+        x = 0.0;
+    }
+    return x + noiseX * uNoise * segmentWidth * float( 5 + layer );
+}
+
+void main() {
+    int layer = int( ciPosition.x ), segment = int( ciPosition.y ), corner = int( ciPosition.z );
+    float segmentWidth = uSize.x / 6.0;
+    float third = uSize.x / 3.0;
+    float k = float( 4 * ( layer + 1 ) * ( segment + 1 ) );
+    vec2 offset = uPosition * uSize + vec2( third * float( segment ), 0.0 );
+    
+    // every vertex works out all four corners, for the sides and the bounding box
+    vec4 sides = vec4( cornerX( 0, layer, k, segmentWidth, third ), cornerX( 3, layer, k, segmentWidth, third ),
+                       cornerX( 1, layer, k, segmentWidth, third ), cornerX( 2, layer, k, segmentWidth, third ) ) + offset.x;
+    float left = min( min( sides.x, sides.y ), min( sides.z, sides.w ) );
+    float right = max( max( sides.x, sides.y ), max( sides.z, sides.w ) );
+    vT = corner < 2 ? 0.0 : 1.0;
+    vec2 p = vec2( corner == 0 || corner == 3 ? left : right, offset.y + vT * uSize.y );
+    
+    vX = p.x;
+    vSides = sides;
+    vColor = layer == 0 ? uFirstColor : uLayerColor;
+    gl_Position = ciModelViewProjection * vec4( p, 0.0, 1.0 );
+}
+)";
+
+static const char *sStripesFrag = R"(
+#version 150
+in vec4         vColor;
+in float        vX, vT;
+flat in vec4    vSides;
+out vec4        oColor;
+
+void main() {
+    // the top and bottom are straight, so along a row the stripe is what
+    // lies between its left and right side, in either order
+    float a = mix( vSides.x, vSides.y, vT ), b = mix( vSides.z, vSides.w, vT );
+    if( vX < min( a, b ) || vX >= max( a, b ) ) discard;
+    oColor = vColor;
+}
+)";
+
+bool Stripes::setup(int32_t seed){
+    
+    try {
+        mGlsl = gl::GlslProg::create( gl::GlslProg::Format().vertex( sStripesVert ).fragment( sStripesFrag ) );
+    } catch( std::exception &e ) {
+        console() << "Unable to set up the stripes: " << e.what() << endl;
+        return false;
+    }
+    
+    setSeed( seed );
+    mGlsl->uniform( "uPerms", 0 );
+    
+    // the bounding box of each segment, four corners, three segments per layer
+    vector<vec3> corners;
+    vector<uint16_t> indices;
+    for(int layer = 0; layer < MAX_LAYERS; layer++){
+        for(int segment = 0; segment < 3; segment++){
+            uint16_t base = corners.size();
+            for(int corner = 0; corner < 4; corner++){
+                corners.push_back( vec3( layer, segment, corner ) );
+            }
+            for(uint16_t i : { 0, 1, 2, 0, 2, 3 }){
+                indices.push_back( base + i );
+            }
+        }
+    }
+    
+    vector<gl::VboMesh::Layout> layout = { gl::VboMesh::Layout().usage( GL_STATIC_DRAW ).attrib( geom::POSITION, 3 ) };
+    gl::VboMeshRef mesh = gl::VboMesh::create( corners.size(), GL_TRIANGLES, layout, indices.size(), GL_UNSIGNED_SHORT );
+    mesh->bufferAttrib( geom::POSITION, corners.size()*sizeof(vec3), corners.data() );
+    mesh->bufferIndices( indices.size()*sizeof(uint16_t), indices.data() );
+    mBatch = gl::Batch::create( mesh, mGlsl );
+    
+    return true;
+}
+
+void Stripes::setSeed(int32_t seed){
+    uint8_t perms[512];
+    perlinPermutations( seed, perms );
+    mPermutations = gl::Texture::create( perms, GL_RED, 512, 1, gl::Texture::Format().internalFormat( GL_R8 ).dataType( GL_UNSIGNED_BYTE ).minFilter( GL_NEAREST ).magFilter( GL_NEAREST ) );
+}
+
+void Stripes::draw(int numLayers, double time, float noise, float squareness, const vec2 &position, const ColorA &firstColor, const ColorA &layerColor, const vec2 &size){
+    
+    if( ! mBatch ) return;
+    
+    numLayers = math<int>::clamp( numLayers, 1, MAX_LAYERS );
+    
+    mGlsl->uniform( "uNoiseTime", vec4( time*.12*.25, time*.19*.25, time*.13*.25, time*.15*.25 ) );
+    mGlsl->uniform( "uNoise", noise );
+    mGlsl->uniform( "uSquareness", squareness );
+    mGlsl->uniform( "uPosition", position );
+    mGlsl->uniform( "uSize", size );
+    mGlsl->uniform( "uFirstColor", firstColor );
+    mGlsl->uniform( "uLayerColor", layerColor );
+    
+    gl::ScopedTextureBind scopedPerms( mPermutations, 0 );
+    mBatch->draw( 0, numLayers*3*6 );
+}
+
+#pragma mark BatchPerlin
+
+// Four float lanes, only the operations the batched noise needs.
+namespace lanes {
+#if defined( __SSE2__ )
+    typedef __m128  f4;
+    typedef __m128i i4;
+    typedef __m128  m4;
+    inline f4 load( const float *p )                { return _mm_loadu_ps( p ); }
+    inline void store( float *p, f4 a )             { _mm_storeu_ps( p, a ); }
+    inline f4 splat( float a )                      { return _mm_set1_ps( a ); }
+    inline f4 add( f4 a, f4 b )                     { return _mm_add_ps( a, b ); }
+    inline f4 sub( f4 a, f4 b )                     { return _mm_sub_ps( a, b ); }
+    inline f4 mul( f4 a, f4 b )                     { return _mm_mul_ps( a, b ); }
+    inline i4 truncate( f4 a )                      { return _mm_cvttps_epi32( a ); }
+    inline f4 toFloat( i4 a )                       { return _mm_cvtepi32_ps( a ); }
+    inline m4 greater( f4 a, f4 b )                 { return _mm_cmpgt_ps( a, b ); }
+    inline f4 blend( m4 m, f4 a, f4 b )             { return _mm_or_ps( _mm_and_ps( m, a ), _mm_andnot_ps( m, b ) ); }
+    inline f4 negateIf( m4 m, f4 a )                { return _mm_xor_ps( a, _mm_and_ps( m, _mm_set1_ps( -0.f ) ) ); }
+    inline i4 loadInt( const int32_t *p )           { return _mm_loadu_si128( (const __m128i*)p ); }
+    inline void storeInt( int32_t *p, i4 a )        { _mm_storeu_si128( (__m128i*)p, a ); }
+    inline i4 splatInt( int32_t a )                 { return _mm_set1_epi32( a ); }
+    inline i4 andInt( i4 a, i4 b )                  { return _mm_and_si128( a, b ); }
+    inline m4 lessInt( i4 a, i4 b )                 { return _mm_castsi128_ps( _mm_cmplt_epi32( a, b ) ); }
+    inline m4 equalInt( i4 a, i4 b )                { return _mm_castsi128_ps( _mm_cmpeq_epi32( a, b ) ); }
+    inline m4 either( m4 a, m4 b )                  { return _mm_or_ps( a, b ); }
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+    typedef float32x4_t f4;
+    typedef int32x4_t   i4;
+    typedef uint32x4_t  m4;
+    inline f4 load( const float *p )                { return vld1q_f32( p ); }
+    inline void store( float *p, f4 a )             { vst1q_f32( p, a ); }
+    inline f4 splat( float a )                      { return vdupq_n_f32( a ); }
+    inline f4 add( f4 a, f4 b )                     { return vaddq_f32( a, b ); }
+    inline f4 sub( f4 a, f4 b )                     { return vsubq_f32( a, b ); }
+    inline f4 mul( f4 a, f4 b )                     { return vmulq_f32( a, b ); }
+    inline i4 truncate( f4 a )                      { return vcvtq_s32_f32( a ); }
+    inline f4 toFloat( i4 a )                       { return vcvtq_f32_s32( a ); }
+    inline m4 greater( f4 a, f4 b )                 { return vcgtq_f32( a, b ); }
+    inline f4 blend( m4 m, f4 a, f4 b )             { return vbslq_f32( m, a, b ); }
+    inline f4 negateIf( m4 m, f4 a )                { return vreinterpretq_f32_u32( veorq_u32( vreinterpretq_u32_f32( a ), vandq_u32( m, vdupq_n_u32( 0x80000000 ) ) ) ); }
+    inline i4 loadInt( const int32_t *p )           { return vld1q_s32( p ); }
+    inline void storeInt( int32_t *p, i4 a )        { vst1q_s32( p, a ); }
+    inline i4 splatInt( int32_t a )                 { return vdupq_n_s32( a ); }
+    inline i4 andInt( i4 a, i4 b )                  { return vandq_s32( a, b ); }
+    inline m4 lessInt( i4 a, i4 b )                 { return vcltq_s32( a, b ); }
+    inline m4 equalInt( i4 a, i4 b )                { return vceqq_s32( a, b ); }
+    inline m4 either( m4 a, m4 b )                  { return vorrq_u32( a, b ); }
+#endif
+}
+
+// Evaluates ci::Perlin noise for many (x, y, z) samples in one call. The
+// scalar path performs the same float operations in the same order as
+// ci::Perlin::noise( x, y, z ) with the same seed; the SSE2/NEON path runs
+// four samples per step with the permutation lookups done per lane. Noise
+// with z = 0 equals ci::Perlin::noise( x, y ).
+
+class BatchPerlin {
+public:
+    BatchPerlin(uint8_t octaves=4, int32_t seed=0);
+    
+    void setSeed(int32_t seed);
+    int32_t getSeed() const { return mSeed; }
+    const uint8_t* getPermutations() const { return mPerms; }
+    
+    float noise(float x, float y, float z=0.f) const;
+    void noise(const float *x, const float *y, const float *z, float *result, size_t count) const;
+    void noiseScalar(const float *x, const float *y, const float *z, float *result, size_t count) const;
+    
+private:
+    float noiseImpl(float x, float y, float z) const;
+    float grad(int32_t hash, float x, float y, float z) const;
+#if defined( BATCH_PERLIN_SIMD )
+    lanes::f4 noise4(lanes::f4 x, lanes::f4 y, lanes::f4 z) const;
+    lanes::f4 noiseImpl4(lanes::f4 x, lanes::f4 y, lanes::f4 z) const;
+#endif
+    
+    uint8_t         mOctaves;
+    int32_t         mSeed;
+    uint8_t         mPerms[512];
+};
+
+static inline float perlinFade(float t){
+    return t * t * t * (t * (t * 6 - 15) + 10);
+}
+
+static inline float perlinLerp(float t, float a, float b){
+    return a + t * (b - a);
+}
+
+BatchPerlin::BatchPerlin(uint8_t octaves, int32_t seed)
+: mOctaves( octaves )
+{
+    setSeed( seed );
+}
+
+void BatchPerlin::setSeed(int32_t seed){
+    mSeed = seed;
+    perlinPermutations( seed, mPerms );
+}
+
+float BatchPerlin::grad(int32_t hash, float x, float y, float z) const {
+    int32_t h = hash & 15;
+    float u = h<8 ? x : y, v = h<4 ? y : h==12||h==14 ? x : z;
+    return ((h&1) == 0 ? u : -u) + ((h&2) == 0 ? v : -v);
+}
+
+float BatchPerlin::noiseImpl(float x, float y, float z) const {
+    
+    int32_t X = ((int32_t)floorf(x)) & 255, Y = ((int32_t)floorf(y)) & 255, Z = ((int32_t)floorf(z)) & 255;
+    x -= floorf(x); y -= floorf(y); z -= floorf(z);
+    float u = perlinFade(x), v = perlinFade(y), w = perlinFade(z);
+    int32_t A = mPerms[X  ]+Y, AA = mPerms[A]+Z, AB = mPerms[A+1]+Z,
+            B = mPerms[X+1]+Y, BA = mPerms[B]+Z, BB = mPerms[B+1]+Z;
+    
+    return perlinLerp(w, perlinLerp(v, perlinLerp(u, grad(mPerms[AA  ], x  , y  , z   ),
+                                                     grad(mPerms[BA  ], x-1, y  , z   )),
+                                       perlinLerp(u, grad(mPerms[AB  ], x  , y-1, z   ),
+                                                     grad(mPerms[BB  ], x-1, y-1, z   ))),
+                         perlinLerp(v, perlinLerp(u, grad(mPerms[AA+1], x  , y  , z-1 ),
+                                                     grad(mPerms[BA+1], x-1, y  , z-1 )),
+                                       perlinLerp(u, grad(mPerms[AB+1], x  , y-1, z-1 ),
+                                                     grad(mPerms[BB+1], x-1, y-1, z-1 ))));
+}
+
+float BatchPerlin::noise(float x, float y, float z) const {
+    float result = 0.0f;
+    float amp = 0.5f;
+    for(uint8_t i = 0; i < mOctaves; i++){
+        result += noiseImpl( x, y, z ) * amp;
+        x *= 2.0f; y *= 2.0f; z *= 2.0f;
+        amp *= 0.5f;
+    }
+    return result;
+}
+
+void BatchPerlin::noiseScalar(const float *x, const float *y, const float *z, float *result, size_t count) const {
+    for(size_t i = 0; i < count; i++){
+        result[i] = noise( x[i], y[i], z[i] );
+    }
+}
+
+void BatchPerlin::noise(const float *x, const float *y, const float *z, float *result, size_t count) const {
+    size_t i = 0;
+#if defined( BATCH_PERLIN_SIMD )
+    for(; i + 4 <= count; i += 4){
+        lanes::store( result + i, noise4( lanes::load( x + i ), lanes::load( y + i ), lanes::load( z + i ) ) );
+    }
+#endif
+    noiseScalar( x + i, y + i, z + i, result + i, count - i );
+}
+
+#if defined( BATCH_PERLIN_SIMD )
+
+lanes::f4 BatchPerlin::noise4(lanes::f4 x, lanes::f4 y, lanes::f4 z) const {
+    using namespace lanes;
+    f4 result = splat( 0.0f );
+    float amp = 0.5f;
+    for(uint8_t i = 0; i < mOctaves; i++){
+        result = add( result, mul( noiseImpl4( x, y, z ), splat( amp ) ) );
+        x = mul( x, splat( 2.0f ) ); y = mul( y, splat( 2.0f ) ); z = mul( z, splat( 2.0f ) );
+        amp *= 0.5f;
+    }
+    return result;
+}
+
+namespace lanes {
+    // floorf for values in int range: truncate, then step down where that rounded up
+    inline f4 floor( f4 a ) {
+        f4 t = toFloat( truncate( a ) );
+        return sub( t, blend( greater( t, a ), splat( 1.0f ), splat( 0.0f ) ) );
+    }
+    inline f4 fade( f4 t ) {
+        return mul( mul( mul( t, t ), t ), add( mul( t, sub( mul( t, splat( 6.0f ) ), splat( 15.0f ) ) ), splat( 10.0f ) ) );
+    }
+    inline f4 lerp( f4 t, f4 a, f4 b ) {
+        return add( a, mul( t, sub( b, a ) ) );
+    }
+    inline f4 grad( i4 hash, f4 x, f4 y, f4 z ) {
+        i4 h = andInt( hash, splatInt( 15 ) );
+        f4 u = blend( lessInt( h, splatInt( 8 ) ), x, y );
+        f4 v = blend( lessInt( h, splatInt( 4 ) ), y, blend( either( equalInt( h, splatInt( 12 ) ), equalInt( h, splatInt( 14 ) ) ), x, z ) );
+        u = negateIf( equalInt( andInt( h, splatInt( 1 ) ), splatInt( 1 ) ), u );
+        v = negateIf( equalInt( andInt( h, splatInt( 2 ) ), splatInt( 2 ) ), v );
+        return add( u, v );
+    }
+}
+
+lanes::f4 BatchPerlin::noiseImpl4(lanes::f4 x, lanes::f4 y, lanes::f4 z) const {
+    using namespace lanes;
+    
+    f4 fx = lanes::floor( x ), fy = lanes::floor( y ), fz = lanes::floor( z );
+    int32_t X[4], Y[4], Z[4];
+    storeInt( X, andInt( truncate( fx ), splatInt( 255 ) ) );
+    storeInt( Y, andInt( truncate( fy ), splatInt( 255 ) ) );
+    storeInt( Z, andInt( truncate( fz ), splatInt( 255 ) ) );
+    x = sub( x, fx ); y = sub( y, fy ); z = sub( z, fz );
+    f4 u = fade( x ), v = fade( y ), w = fade( z );
+    
+    // the table lookups don't vectorize, hash each lane on its own
+    int32_t hashes[8][4];
+    for(int l = 0; l < 4; l++){
+        int32_t A = mPerms[X[l]  ]+Y[l], AA = mPerms[A]+Z[l], AB = mPerms[A+1]+Z[l],
+                B = mPerms[X[l]+1]+Y[l], BA = mPerms[B]+Z[l], BB = mPerms[B+1]+Z[l];
+        hashes[0][l] = mPerms[AA  ]; hashes[1][l] = mPerms[BA  ];
+        hashes[2][l] = mPerms[AB  ]; hashes[3][l] = mPerms[BB  ];
+        hashes[4][l] = mPerms[AA+1]; hashes[5][l] = mPerms[BA+1];
+        hashes[6][l] = mPerms[AB+1]; hashes[7][l] = mPerms[BB+1];
+    }
+    
+    f4 one = splat( 1.0f );
+    f4 x1 = sub( x, one ), y1 = sub( y, one ), z1 = sub( z, one );
+    
+    return lerp( w, lerp( v, lerp( u, lanes::grad( loadInt( hashes[0] ), x , y , z  ),
+                                      lanes::grad( loadInt( hashes[1] ), x1, y , z  ) ),
+                             lerp( u, lanes::grad( loadInt( hashes[2] ), x , y1, z  ),
+                                      lanes::grad( loadInt( hashes[3] ), x1, y1, z  ) ) ),
+                    lerp( v, lerp( u, lanes::grad( loadInt( hashes[4] ), x , y , z1 ),
+                                      lanes::grad( loadInt( hashes[5] ), x1, y , z1 ) ),
+                             lerp( u, lanes::grad( loadInt( hashes[6] ), x , y1, z1 ),
+                                      lanes::grad( loadInt( hashes[7] ), x1, y1, z1 ) ) ) );
+}
+
+#endif
+
+// Times ci::Perlin against BatchPerlin on the stripe/snow sized workloads and
+// checks both give the same values. Run with --bench-noise.
+static void benchmarkNoise(int32_t seed){
+    
+    Perlin reference( 4, seed );
+    BatchPerlin batch( 4, seed );
+    
+    Rand rand( seed );
+    const size_t count = 1 << 20;
+    vector<float> x( count ), y( count ), z( count ), expected( count ), result( count );
+    for(size_t i = 0; i < count; i++){
+        x[i] = rand.nextFloat( -100.f, 100.f );
+        y[i] = rand.nextFloat( -100.f, 100.f );
+        // every other sample is 2D, the way the snow uses it
+        z[i] = i % 2 ? rand.nextFloat( -100.f, 100.f ) : 0.f;
+    }
+    
+    typedef std::chrono::high_resolution_clock Clock;
+    auto nsPerSample = [count]( Clock::time_point start ){
+        return std::chrono::duration<double, std::nano>( Clock::now() - start ).count() / count;
+    };
+    
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < count; i++){
+        expected[i] = z[i] == 0.f ? reference.noise( x[i], y[i] ) : reference.noise( x[i], y[i], z[i] );
+    }
+    double referenceTime = nsPerSample( start );
+    
+    start = Clock::now();
+    batch.noiseScalar( x.data(), y.data(), z.data(), result.data(), count );
+    double scalarTime = nsPerSample( start );
+    size_t scalarMismatches = 0;
+    for(size_t i = 0; i < count; i++){
+        scalarMismatches += memcmp( &expected[i], &result[i], sizeof(float) ) != 0;
+    }
+    
+    start = Clock::now();
+    batch.noise( x.data(), y.data(), z.data(), result.data(), count );
+    double batchTime = nsPerSample( start );
+    size_t batchMismatches = 0;
+    for(size_t i = 0; i < count; i++){
+        batchMismatches += memcmp( &expected[i], &result[i], sizeof(float) ) != 0;
+    }
+    
+#if defined( BATCH_PERLIN_SIMD )
+    const char *path = "simd";
+#else
+    const char *path = "scalar fallback";
+#endif
+    cout << boost::format( "noise benchmark, %d samples, seed %d\n" ) % count % seed;
+    cout << boost::format( "  ci::Perlin          %6.2f ns/sample\n" ) % referenceTime;
+    cout << boost::format( "  BatchPerlin scalar  %6.2f ns/sample, %d mismatches\n" ) % scalarTime % scalarMismatches;
+    cout << boost::format( "  BatchPerlin %-7s %6.2f ns/sample, %d mismatches, %.2fx\n" ) % path % batchTime % batchMismatches % (referenceTime / batchTime);
+}
+
+#pragma mark Simulation
+
+// Something the simulation thread advances at a fixed rate.
+class SimulationSystem {
+public:
+    virtual ~SimulationSystem() {}
+    
+    // advances the state from time to time + dt, on the simulation thread
+    virtual void step(double time, double dt) = 0;
+    // makes the state after the latest steps visible to the renderer
+    virtual void publish(double time) = 0;
+    // the simulation thread parks while no system is active
+    virtual bool isActive() const { return true; }
+};
+
+typedef std::shared_ptr<SimulationSystem> SimulationSystemRef;
+
+// Steps its systems with a fixed time step on a thread of its own, so motion
+// doesn't depend on the render frame rate and keeps going through hitches on
+// the main thread. Systems publish a copy of their state after stepping and
+// the renderer interpolates between the last two copies. A Box2D world fits
+// in as another system: step() calls b2World::Step with the fixed dt and
+// publish() copies out the body transforms. While no system is active the
+// thread parks on a condition variable until wake().
+class Simulation {
+public:
+    Simulation();
+    ~Simulation();
+    
+    // systems are added before start()
+    void add(const SimulationSystemRef &system);
+    void start(double rate);
+    void stop();
+    // call after a system became active so a parked thread resumes stepping
+    void wake();
+    
+    // steps on the caller's thread instead, up to stepTo's time
+    void startManual(double rate);
+    void stepTo(double time);
+    
+    // seconds since start(), the clock both the steps and the renderer use
+    double getTime() const;
+    double getTimeStep() const { return mTimeStep; }
+    
+private:
+    void run();
+    void stepUntil(double time);
+    bool isAnyActive() const;
+    
+    static const int MAX_CATCH_UP = 10;
+    
+    vector<SimulationSystemRef>             mSystems;
+    double                                  mTimeStep;
+    double                                  mSimulatedTime;
+    bool                                    mManual;
+    std::chrono::steady_clock::time_point   mEpoch;
+    std::atomic<bool>                       mRunning;
+    std::thread                             mThread;
+    std::mutex                              mParkMutex;
+    std::condition_variable                 mParked;
+};
+
+Simulation::Simulation()
+: mTimeStep( 1/180. ), mSimulatedTime( 0 ), mManual( false ), mRunning( false )
+{
+}
+
+Simulation::~Simulation(){
+    stop();
+}
+
+void Simulation::add(const SimulationSystemRef &system){
+    mSystems.push_back( system );
+}
+
+void Simulation::start(double rate){
+    stop();
+    mTimeStep = 1. / max( rate, 1. );
+    mSimulatedTime = 0;
+    mManual = false;
+    mEpoch = std::chrono::steady_clock::now();
+    mRunning = true;
+    mThread = std::thread( &Simulation::run, this );
+}
+
+void Simulation::startManual(double rate){
+    stop();
+    mTimeStep = 1. / max( rate, 1. );
+    mSimulatedTime = 0;
+    mManual = true;
+}
+
+void Simulation::stepTo(double time){
+    if( mManual ) stepUntil( time );
+}
+
+void Simulation::stop(){
+    mRunning = false;
+    wake();
+    if( mThread.joinable() ){
+        mThread.join();
+    }
+}
+
+void Simulation::wake(){
+    // locked so a notify between the predicate check and the wait isn't lost
+    std::lock_guard<std::mutex> lock( mParkMutex );
+    mParked.notify_all();
+}
+
+bool Simulation::isAnyActive() const {
+    for(const SimulationSystemRef &system : mSystems){
+        if( system->isActive() ) return true;
+    }
+    return false;
+}
+
+double Simulation::getTime() const {
+    if( mManual ) return mSimulatedTime;
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - mEpoch ).count();
+}
+
+void Simulation::run(){
+    while( mRunning ){
+        if( ! isAnyActive() ){
+            std::unique_lock<std::mutex> lock( mParkMutex );
+            mParked.wait( lock, [this]{ return ! mRunning || isAnyActive(); } );
+            if( ! mRunning ) break;
+            // resume from now instead of stepping through the parked time
+            mSimulatedTime = floor( getTime() / mTimeStep ) * mTimeStep;
+        }
+        stepUntil( getTime() );
+        std::this_thread::sleep_until( mEpoch + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( mSimulatedTime + mTimeStep ) ) );
+    }
+}
+
+void Simulation::stepUntil(double until){
+    
+    int ticks = 0;
+    while( mSimulatedTime + mTimeStep <= until && ticks < MAX_CATCH_UP ){
+        for(const SimulationSystemRef &system : mSystems){
+            system->step( mSimulatedTime, mTimeStep );
+        }
+        mSimulatedTime += mTimeStep;
+        ticks++;
+    }
+    
+    // after a long stall skip ahead instead of trying to catch up
+    if( ticks == MAX_CATCH_UP ){
+        mSimulatedTime = floor( until / mTimeStep ) * mTimeStep;
+    }
+    
+    if( ticks > 0 ){
+        for(const SimulationSystemRef &system : mSystems){
+            system->publish( mSimulatedTime );
+        }
+    }
+}
+
+#pragma mark Snow
+
+// The december snowflakes as parallel arrays. Every step is one pass over
+// the arrays with the drift noise evaluated in a single batch, and the flakes
+// are drawn as instances of one unit disc in a single draw call. The flakes
+// move on the simulation thread; draw() interpolates between the last two
+// published positions.
+
+class Snow : public SimulationSystem {
+public:
+    Snow();
+    
+    void reset(int32_t seed, size_t maxCount, const vec2 &size);
+    bool setupDraw();
+    
+    // set from the main thread while the simulation runs
+    void setActive(bool active) { mActive = active; }
+    bool isActive() const override { return mActive; }
+    void setDrift(float drift) { mDrift = drift; }
+    // fewer flakes than reset() allowed, down to none
+    void setLimit(size_t limit) { mLimit = limit; }
+    
+    void step(double time, double dt) override;
+    void publish(double time) override;
+    
+    void update(double time, const vec2 &size, float drift);
+    void draw(double time, const ColorA &color);
+    
+    size_t getCount() const { return mX.size(); }
+    size_t getMaxCount() const { return mMaxCount; }
+    
+private:
+    void spawn(const vec2 &size, float scale);
+    
+    size_t              mMaxCount;
+    vec2                mSize;
+    std::atomic<bool>   mActive;
+    std::atomic<float>  mDrift;
+    std::atomic<size_t> mLimit;
+    BatchPerlin         mNoise;
+    Rand                mRand;
+    
+    vector<float>       mX, mY, mRadius;
+    vector<float>       mNoiseX, mNoiseY, mNoiseZ, mForce;
+    
+    // x, y and radius of every flake at the last two published times
+    std::mutex          mSnapshotMutex;
+    vector<vec3>        mPrevious, mCurrent;
+    double              mPreviousTime, mCurrentTime;
+    vector<vec3>        mInstances;
+    
+    gl::GlslProgRef mGlsl;
+    gl::VboRef      mInstanceVbo;
+    gl::BatchRef    mBatch;
+};
+
+static const char *sSnowVert = R"(
+#version 150
+uniform mat4    ciModelViewProjection;
+in vec4         ciPosition;
+in vec3         iFlake;         // x, y, radius
+
+void main() {
+    gl_Position = ciModelViewProjection * vec4( iFlake.xy + ciPosition.xy * iFlake.z, 0.0, 1.0 );
+}
+)";
+
+static const char *sSnowFrag = R"(
+#version 150
+uniform vec4    uColor;
+out vec4        oColor;
+
+void main() {
+    oColor = uColor;
+}
+)";
+
+Snow::Snow()
+: mMaxCount( 0 ), mActive( false ), mDrift( 0 ), mLimit( 0 ), mPreviousTime( 0 ), mCurrentTime( 0 )
+{
+}
+
+void Snow::reset(int32_t seed, size_t maxCount, const vec2 &size){
+    mMaxCount = mLimit = maxCount;
+    mSize = size;
+    mNoise.setSeed( seed );
+    mRand.seed( seed );
+    for(vector<float> *v : { &mX, &mY, &mRadius, &mNoiseX, &mNoiseY, &mNoiseZ, &mForce }){
+        v->clear();
+        v->reserve( maxCount );
+    }
+}
+
+bool Snow::setupDraw(){
+    
+    try {
+        mGlsl = gl::GlslProg::create( gl::GlslProg::Format().vertex( sSnowVert ).fragment( sSnowFrag ) );
+    } catch( std::exception &e ) {
+        console() << "Unable to set up the snow: " << e.what() << endl;
+        return false;
+    }
+    
+    mInstanceVbo = gl::Vbo::create( GL_ARRAY_BUFFER, max<size_t>( mMaxCount, 1 )*sizeof(vec3), nullptr, GL_STREAM_DRAW );
+    geom::BufferLayout instanceLayout;
+    instanceLayout.append( geom::Attrib::CUSTOM_0, 3, 0, 0, 1 /* per instance */ );
+    
+    gl::VboMeshRef mesh = gl::VboMesh::create( geom::Circle().radius( 1 ).subdivisions( 24 ) );
+    mesh->appendVbo( instanceLayout, mInstanceVbo );
+    mBatch = gl::Batch::create( mesh, mGlsl, { { geom::Attrib::CUSTOM_0, "iFlake" } } );
+    
+    return true;
+}
+
+void Snow::spawn(const vec2 &size, float scale){
+    // a tenth of a flake per step for every hundred allowed, which is the
+    // rate the original hundred flakes filled in at
+    size_t limit = min<size_t>( mLimit, mMaxCount );
+    float expected = .1f * limit / 100.f;
+    size_t n = (size_t)expected + (mRand.nextFloat() < expected - floorf(expected) ? 1 : 0);
+    
+    // flakes over a lowered limit are dropped
+    if( mX.size() > limit ){
+        for(vector<float> *v : { &mX, &mY, &mRadius, &mNoiseY, &mNoiseZ }){
+            v->resize( limit );
+        }
+    }
+    
+    for(; n > 0 && mX.size() < limit; n--){
+        float radius = (0.4f*scale) + mRand.nextFloat(scale);
+        mRadius.push_back(radius);
+        mX.push_back(mRand.nextFloat(size.x));
+        mY.push_back(-radius);
+        // every flake follows its own slice of the noise
+        mNoiseY.push_back(mNoiseY.size()*.005f);
+        mNoiseZ.push_back(0.f);
+    }
+    mNoiseX.resize(mX.size());
+    mForce.resize(mX.size());
+}
+
+void Snow::update(double time, const vec2 &size, float drift){
+    
+    float scale = size.y*0.04f;
+    
+    spawn(size, scale);
+    
+    size_t count = mX.size();
+    fill(mNoiseX.begin(), mNoiseX.end(), (float)(time*.1));
+    mNoise.noise(mNoiseX.data(), mNoiseY.data(), mNoiseZ.data(), mForce.data(), count);
+    
+    float fall = scale*0.5f;
+    float sway = drift*1.75f;
+    float *x = mX.data(), *y = mY.data();
+    const float *radius = mRadius.data(), *force = mForce.data();
+    
+    for(size_t i = 0; i < count; i++){
+        float r = radius[i];
+        x[i] += force[i]*fall/r + sway*r;
+        y[i] += fall/r;
+    }
+    
+    // flakes that left the bottom start over at the top
+    for(size_t i = 0; i < count; i++){
+        if(y[i] > size.y + radius[i]){
+            x[i] = mRand.nextFloat(size.x);
+            y[i] = -radius[i];
+        }
+    }
+}
+
+void Snow::step(double time, double dt){
+    // one step per tick, so the motion per step is as before at 60fps with three stripe layers
+    if( mActive ){
+        update( time, mSize, mDrift );
+    }
+}
+
+void Snow::publish(double time){
+    std::lock_guard<std::mutex> lock( mSnapshotMutex );
+    mPrevious.swap( mCurrent );
+    mPreviousTime = mCurrentTime;
+    
+    size_t count = mX.size();
+    mCurrent.resize( count );
+    for(size_t i = 0; i < count; i++){
+        mCurrent[i] = vec3( mX[i], mY[i], mRadius[i] );
+    }
+    mCurrentTime = time;
+}
+
+void Snow::draw(double time, const ColorA &color){
+    
+    if( ! mBatch ) return;
+    
+    {
+        std::lock_guard<std::mutex> lock( mSnapshotMutex );
+        
+        // draw the state one publish behind, between the last two snapshots
+        double span = mCurrentTime - mPreviousTime;
+        float t = span > 0 ? math<double>::clamp( (time - mCurrentTime) / span, 0, 1 ) : 1;
+        
+        size_t count = mCurrent.size();
+        mInstances.resize( count );
+        for(size_t i = 0; i < count; i++){
+            const vec3 &current = mCurrent[i];
+            // new flakes, and flakes that wrapped back to the top, appear where they are now
+            if( i < mPrevious.size() && mPrevious[i].y <= current.y ){
+                mInstances[i] = glm::mix( mPrevious[i], current, t );
+            } else {
+                mInstances[i] = current;
+            }
+        }
+    }
+    
+    if( mInstances.empty() ) return;
+    
+    size_t count = mInstances.size();
+    
+    // orphan last frame's storage instead of waiting for the GPU to release it
+    mInstanceVbo->bufferData( mMaxCount*sizeof(vec3), nullptr, GL_STREAM_DRAW );
+    mInstanceVbo->bufferSubData( 0, count*sizeof(vec3), mInstances.data() );
+    
+    gl::ScopedBlendAdditive blendAdditive;
+    mGlsl->uniform( "uColor", color );
+    mBatch->drawInstanced( count );
+}
+
+// Times the snow update at several flake counts, without a window or GL.
+// Run with --bench-snow.
+static void benchmarkSnow(int32_t seed){
+    
+    vec2 size( 5760, 1080 );
+    typedef std::chrono::high_resolution_clock Clock;
+    
+    cout << boost::format( "snow benchmark, %dx%d, seed %d\n" ) % size.x % size.y % seed;
+    for(size_t maxCount : { 100, 1000, 10000, 50000, 100000 }){
+        Snow snow;
+        snow.reset( seed, maxCount, size );
+        
+        double time = 0;
+        while( snow.getCount() < maxCount ){
+            snow.update( time, size, 0.1f );
+            time += 1/180.;
+        }
+        
+        const int steps = 600;
+        Clock::time_point start = Clock::now();
+        for(int i = 0; i < steps; i++){
+            snow.update( time, size, 0.1f );
+            time += 1/180.;
+        }
+        double ms = std::chrono::duration<double, std::milli>( Clock::now() - start ).count() / steps;
+        cout << boost::format( "  %6d flakes  %7.3f ms/step  %6.2f ns/flake\n" ) % maxCount % ms % (ms*1e6/maxCount);
+    }
+}
+
+#pragma mark Show
+
+// The scripted part of the show as data. A state is a list of cues, each
+// cue one tween of a named property. A cue starts `delay` seconds into the
+// state, or with `append` that long after the property's previous cue in
+// the same state (an append with none is an error); a cue without
+// `append` replaces the property's earlier cues the way
+// showTimeline().apply does. The state ends when its `advance` cue finishes (or
+// after `length` seconds) and the show moves on to `next`. States are
+// compiled once into cues with absolute times, so the show knows how long
+// every state runs and when the next image or movie is needed.
+//
+// The slides, the movies and the switch to the next project follow the
+// media, so they stay in code and are named here as `slides`, `movie` and
+// `project`. A lab.yaml `show:` section replaces this default.
+
+static const char *sDefaultShow = R"(
+start: intro
+states:
+  intro:                # the lab name over the stripes
+    actions: [nextTagline, nextProject, refreshCalendar]
+    next: taglines
+    cues:
+      - { property: stripesSquareness, to: 0, ease: outQuad }
+      - { property: stripesPosition, to: [1, 0], ease: inQuad }
+      - { property: stripesNoise, to: 0, duration: .5, ease: outQuad }
+      - { property: stripesFade, to: .9, duration: .5, ease: inOutQuad }
+      - { property: headerFade, to: 0, duration: .5, ease: inQuad }
+      - { property: projectTitleFade, to: 0, duration: 1, ease: inQuad }
+      - { property: projectDetailsFade, to: 0, duration: 1, ease: inQuad }
+      - { property: stripesPosition, to: [0, 0], duration: 8, ease: outCubic, append: true }
+      - { property: stripesNoise, to: .5, duration: 5, delay: 7.5, ease: inOutSine, append: true }
+      - { property: titleFade, to: 1, duration: 4, delay: 6, ease: outExpo }
+      - { property: stripesFade, to: .6, duration: 4, delay: 5.5, ease: inOutQuad, append: true }
+      - { property: stripesNoise, to: 1, duration: 1.5, ease: inQuad, append: true, advance: true }
+      - { property: stripesFade, to: 1, duration: 2, delay: 1.5, ease: inOutQuad, append: true }
+      - { property: titleFade, from: 1, to: 0, duration: 1.5, delay: 3, ease: outSine, append: true }
+      - { property: stripesSquareness, to: 1, duration: 4.5, delay: 12, ease: inOutQuad, append: true }
+  taglines:             # lab taglines and the calendar
+    actions: [refreshSchedule]
+    next: slides
+    cues:
+      - { property: headerFade, to: 1, duration: .5, ease: inQuad }
+      - { property: logoFade, to: 1, duration: .5, ease: inQuad }
+      - { property: stripesFade, to: 1, duration: 1.5, ease: inOutQuad }
+      - { property: stripesSquareness, to: 0, duration: 5, delay: 4, ease: inOutQuad }
+      - { property: stripesSquareness, to: 1, duration: 5, ease: inOutQuad, append: true }
+      - { property: stripesSquareness, to: 0, duration: 3.5, delay: 10, ease: inOutQuad, append: true }
+      - { property: stripesNoise, to: .25, duration: 5, delay: 3.5, ease: inOutSine }
+      - { property: stripesNoise, to: 0, duration: 5, delay: 15, ease: inOutSine, append: true }
+      - { property: stripesPosition, to: [-2, 0], duration: 5, delay: 26, ease: inQuad, advance: true }
+      - { property: scheduleFade, to: 1, duration: 1.5, delay: 10.5, ease: inOutSine }
+      - { property: scheduleFade, to: 0, duration: 1, delay: 12, ease: inOutSine, append: true }
+      - { property: headerFade, to: 0, duration: 1.5, delay: 5, ease: inQuad, append: true }
+      - { property: logoFade, to: 0, duration: 1, delay: 32, ease: inQuad, append: true }
+)";
+
+struct ShowCue {
+    string          mProperty;
+    bool            mAppend;
+    bool            mHasFrom;
+    vec2            mFrom, mTo;
+    float           mDuration;
+    float           mDelay;         // after the state starts, or after the previous cue with mAppend
+    float           mStart, mEnd;   // seconds into the state
+    EaseFn          mEase;
+};
+
+struct ShowState {
+    string          mName;
+    vector<string>  mActions;
+    vector<ShowCue> mCues;
+    float           mLength;
+    int             mNext;
+};
+
+class Show {
+public:
+    // the states that stay in code
+    enum { STATE_NEXT_PROJECT = -1, STATE_MOVIE = 3, STATE_SLIDES = 4 };
+    
+    Show() : mStart( 0 ) {}
+    
+    void addProperty(const string &name, Anim<float> *anim) { mProperties[name] = Property( anim, NULL ); }
+    void addProperty(const string &name, Anim<vec2> *anim) { mProperties[name] = Property( NULL, anim ); }
+    void addAction(const string &name, const function<void()> &action) { mActions[name] = action; }
+    
+    // compiles a show description, keeps the current show if it has errors
+    bool load(const YAML::Node &node);
+    
+    int getStart() const { return mStart; }
+    bool has(int state) const { return mStates.count( state ) > 0; }
+    string getName(int state) const;
+    
+    // runs the state's actions and starts its cues on the timeline
+    const ShowState& play(int state, Timeline &timeline) const;
+    
+    // seconds from entering state until the slides or a movie need media,
+    // or -1 if the show never gets there
+    double getTimeUntilMedia(int state) const;
+    
+private:
+    typedef pair<Anim<float>*, Anim<vec2>*> Property;
+    
+    static EaseFn getEase(const string &name);
+    ShowCue compileCue(const YAML::Node &node, map<string, float> &propertyEnds, vector<ShowCue> &cues) const;
+    
+    map<string, Property>               mProperties;
+    map<string, function<void()>>       mActions;
+    map<int, ShowState>                 mStates;
+    int                                 mStart;
+};
+
+EaseFn Show::getEase(const string &name){
+    static const map<string, EaseFn> eases = {
+        { "none", EaseNone() },
+        { "inQuad", EaseInQuad() }, { "outQuad", EaseOutQuad() }, { "inOutQuad", EaseInOutQuad() },
+        { "inCubic", EaseInCubic() }, { "outCubic", EaseOutCubic() }, { "inOutCubic", EaseInOutCubic() },
+        { "inSine", EaseInSine() }, { "outSine", EaseOutSine() }, { "inOutSine", EaseInOutSine() },
+        { "inExpo", EaseInExpo() }, { "outExpo", EaseOutExpo() }, { "inOutExpo", EaseInOutExpo() },
+    };
+    auto it = eases.find( name );
+    if( it == eases.end() ) throw runtime_error( "unknown ease " + name );
+    return it->second;
+}
+
+static vec2 showValue(const YAML::Node &node){
+    if( node.IsSequence() ) return vec2( node[0].as<float>(), node[1].as<float>() );
+    return vec2( node.as<float>(), 0 );
+}
+
+ShowCue Show::compileCue(const YAML::Node &node, map<string, float> &propertyEnds, vector<ShowCue> &cues) const {
+    ShowCue cue;
+    cue.mProperty = node["property"].as<string>();
+    if( ! mProperties.count( cue.mProperty ) ) throw runtime_error( "unknown property " + cue.mProperty );
+    cue.mAppend = node["append"] && node["append"].as<bool>();
+    cue.mHasFrom = (bool)node["from"];
+    if( cue.mHasFrom ) cue.mFrom = showValue( node["from"] );
+    cue.mTo = showValue( node["to"] );
+    cue.mDuration = node["duration"] ? node["duration"].as<float>() : 0.f;
+    cue.mDelay = node["delay"] ? node["delay"].as<float>() : 0.f;
+    cue.mEase = getEase( node["ease"] ? node["ease"].as<string>() : "none" );
+    
+    if( cue.mAppend ){
+        // the tween it would follow may belong to another state, so its
+        // start isn't known here
+        auto end = propertyEnds.find( cue.mProperty );
+        if( end == propertyEnds.end() ) throw runtime_error( "append cue of " + cue.mProperty + " without an earlier cue in its state" );
+        cue.mStart = end->second + cue.mDelay;
+    } else {
+        // like apply, drops the property's earlier tweens
+        cue.mStart = cue.mDelay;
+        cues.erase( remove_if( cues.begin(), cues.end(), [&cue]( const ShowCue &c ){ return c.mProperty == cue.mProperty; } ), cues.end() );
+    }
+    cue.mEnd = cue.mStart + cue.mDuration;
+    propertyEnds[cue.mProperty] = cue.mEnd;
+    return cue;
+}
+
+bool Show::load(const YAML::Node &node){
+    
+    map<int, ShowState> states;
+    int start;
+    
+    try {
+        // named states first, so next can refer forward
+        map<string, int> ids = { { "project", STATE_NEXT_PROJECT }, { "movie", STATE_MOVIE }, { "slides", STATE_SLIDES } };
+        int nextId = 0;
+        for(YAML::const_iterator it = node["states"].begin(); it != node["states"].end(); ++it){
+            while( nextId == STATE_MOVIE || nextId == STATE_SLIDES ) nextId++;
+            ids[it->first.as<string>()] = nextId++;
+        }
+        
+        auto idOf = [&ids]( const string &name ){
+            auto it = ids.find( name );
+            if( it == ids.end() ) throw runtime_error( "unknown state " + name );
+            return it->second;
+        };
+        
+        for(YAML::const_iterator it = node["states"].begin(); it != node["states"].end(); ++it){
+            ShowState state;
+            state.mName = it->first.as<string>();
+            state.mNext = idOf( it->second["next"].as<string>() );
+            state.mLength = -1;
+            
+            if( it->second["actions"] ){
+                for(const YAML::Node &action : it->second["actions"]){
+                    state.mActions.push_back( action.as<string>() );
+                    if( ! mActions.count( state.mActions.back() ) ) throw runtime_error( "unknown action " + state.mActions.back() );
+                }
+            }
+            
+            map<string, float> propertyEnds;
+            for(const YAML::Node &cueNode : it->second["cues"]){
+                ShowCue cue = compileCue( cueNode, propertyEnds, state.mCues );
+                if( cueNode["advance"] && cueNode["advance"].as<bool>() ) state.mLength = cue.mEnd;
+                state.mCues.push_back( cue );
+            }
+            if( it->second["length"] ) state.mLength = it->second["length"].as<float>();
+            if( state.mLength < 0 ) throw runtime_error( "state " + state.mName + " never advances" );
+            
+            states[idOf( state.mName )] = state;
+        }
+        
+        start = idOf( node["start"].as<string>() );
+        
+    } catch( std::exception &e ) {
+        console() << "Unable to load the show: " << e.what() << endl;
+        return false;
+    }
+    
+    mStates = states;
+    mStart = start;
+    
+    for(auto &entry : mStates){
+        console() << boost::format( "show state %s (%d): %d cues, %.1fs, then %s" ) % entry.second.mName % entry.first % entry.second.mCues.size() % entry.second.mLength % getName( entry.second.mNext ) << endl;
+    }
+    
+    return true;
+}
+
+string Show::getName(int state) const {
+    auto it = mStates.find( state );
+    if( it != mStates.end() ) return it->second.mName;
+    switch( state ){
+        case STATE_NEXT_PROJECT: return "project";
+        case STATE_MOVIE: return "movie";
+        case STATE_SLIDES: return "slides";
+    }
+    return to_string( state );
+}
+
+const ShowState& Show::play(int state, Timeline &timeline) const {
+    
+    const ShowState &s = mStates.at( state );
+    
+    for(const string &action : s.mActions){
+        mActions.at( action )();
+    }
+    
+    for(const ShowCue &cue : s.mCues){
+        const Property &property = mProperties.at( cue.mProperty );
+        if( property.first ){
+            Anim<float> *anim = property.first;
+            if( cue.mAppend && cue.mHasFrom ) timeline.appendTo( anim, cue.mFrom.x, cue.mTo.x, cue.mDuration, cue.mEase ).delay( cue.mDelay );
+            else if( cue.mAppend ) timeline.appendTo( anim, cue.mTo.x, cue.mDuration, cue.mEase ).delay( cue.mDelay );
+            else if( cue.mHasFrom ) timeline.apply( anim, cue.mFrom.x, cue.mTo.x, cue.mDuration, cue.mEase ).delay( cue.mDelay );
+            else timeline.apply( anim, cue.mTo.x, cue.mDuration, cue.mEase ).delay( cue.mDelay );
+        } else {
+            Anim<vec2> *anim = property.second;
+            if( cue.mAppend && cue.mHasFrom ) timeline.appendTo( anim, cue.mFrom, cue.mTo, cue.mDuration, cue.mEase ).delay( cue.mDelay );
+            else if( cue.mAppend ) timeline.appendTo( anim, cue.mTo, cue.mDuration, cue.mEase ).delay( cue.mDelay );
+            else if( cue.mHasFrom ) timeline.apply( anim, cue.mFrom, cue.mTo, cue.mDuration, cue.mEase ).delay( cue.mDelay );
+            else timeline.apply( anim, cue.mTo, cue.mDuration, cue.mEase ).delay( cue.mDelay );
+        }
+    }
+    
+    return s;
+}
+
+double Show::getTimeUntilMedia(int state) const {
+    double time = 0;
+    for(size_t i = 0; i <= mStates.size(); i++){
+        if( state == STATE_SLIDES || state == STATE_MOVIE ) return time;
+        auto it = mStates.find( state );
+        if( it == mStates.end() ) return -1;
+        time += it->second.mLength;
+        state = it->second.mNext;
+    }
+    return -1;
+}
+
+#pragma mark ProjectPack
+
+// A project folder in a single file, written offline with --pack and
+// memory mapped by Project, so loading a project is one sequential read
+// rather than a stat and open per file on the network share. The pack
+// holds project.yaml, the subtitles and every slide, with JPEGs scaled
+// down to what the largest panel shows of them. Movies stay next to the
+// pack, since QuickTime plays from files, but are listed in its index.
+// The index keeps the size and modification time each file had when it
+// was packed, so a file overwritten in place makes the pack out of date.
+//
+//   "ATRPACK2", uint32 count,
+//   count x ( uint16 name length, name, uint64 offset, uint64 size,
+//             uint64 file size, int64 file time ),
+//   the contents, each at a 16 byte aligned offset from the start
+
+class ProjectPack : public std::enable_shared_from_this<ProjectPack> {
+public:
+    static const char *FILENAME;
+    
+    ProjectPack();
+    ~ProjectPack();
+    
+    // packs a project folder, or every project folder in a portfolio
+    static bool write(const fs::path &dir, const ivec2 &canvas);
+    
+    bool open(const fs::path &file);
+    void close();
+    bool isOpen() const { return mData != nullptr; }
+    // whether every packed file in the project is still as it was packed
+    bool isCurrent(const fs::path &project) const;
+    
+    // the packed names in folder order, movies included
+    const vector<string>& getNames() const { return mNames; }
+    bool has(const string &name) const;
+    // the contents in place, keeping the pack mapped while in use
+    DataSourceRef getData(const string &name) const;
+    
+private:
+    struct Item {
+        uint64_t    mOffset, mSize;
+        uint64_t    mFileSize;
+        int64_t     mFileTime;
+    };
+    
+    static bool writeProject(const fs::path &project, const ivec2 &canvas);
+    static string readFile(const fs::path &path);
+    static string scaleSlide(const fs::path &image, const ivec2 &canvas);
+    
+    map<string, Item>   mItems;
+    vector<string>      mNames;
+    uint8_t             *mData;
+    size_t              mSize;
+};
+
+const char *ProjectPack::FILENAME = "project.atriumpack";
+
+static const char sPackMagic[8] = { 'A', 'T', 'R', 'P', 'A', 'C', 'K', '2' };
+
+ProjectPack::ProjectPack()
+: mData( nullptr ), mSize( 0 )
+{
+}
+
+ProjectPack::~ProjectPack(){
+    close();
+}
+
+bool ProjectPack::open(const fs::path &file){
+    close();
+    
+    int fd = ::open( file.c_str(), O_RDONLY );
+    if( fd < 0 ) return false;
+    struct stat info;
+    if( fstat( fd, &info ) < 0 || info.st_size < (off_t)sizeof(sPackMagic) + 4 ){
+        ::close( fd );
+        return false;
+    }
+    void *data = mmap( nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if( data == MAP_FAILED ) return false;
+    mData = static_cast<uint8_t*>( data );
+    mSize = info.st_size;
+    
+    // the whole pack is about to be read front to back
+    madvise( mData, mSize, MADV_SEQUENTIAL );
+    madvise( mData, mSize, MADV_WILLNEED );
+    
+    // every field is checked against the size, a truncated pack is just not used
+    size_t pos = 0;
+    auto read = [this, &pos]( void *to, size_t bytes ){
+        if( pos + bytes > mSize ) return false;
+        memcpy( to, mData + pos, bytes );
+        pos += bytes;
+        return true;
+    };
+    char magic[8];
+    uint32_t count = 0;
+    bool valid = read( magic, sizeof(magic) ) && memcmp( magic, sPackMagic, sizeof(magic) ) == 0 && read( &count, sizeof(count) );
+    for(uint32_t i = 0; valid && i < count; i++){
+        uint16_t length = 0;
+        Item item;
+        valid = read( &length, sizeof(length) ) && pos + length <= mSize;
+        if( ! valid ) break;
+        string name( reinterpret_cast<const char*>( mData + pos ), length );
+        pos += length;
+        valid = read( &item.mOffset, sizeof(item.mOffset) ) && read( &item.mSize, sizeof(item.mSize) ) && item.mOffset + item.mSize <= mSize
+            && read( &item.mFileSize, sizeof(item.mFileSize) ) && read( &item.mFileTime, sizeof(item.mFileTime) );
+        if( valid ){
+            mItems[name] = item;
+            mNames.push_back( name );
+        }
+    }
+    if( ! valid ){
+        console() << "Ignoring the damaged pack: " << file << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ProjectPack::close(){
+    if( mData ) munmap( mData, mSize );
+    mData = nullptr;
+    mSize = 0;
+    mItems.clear();
+    mNames.clear();
+}
+
+bool ProjectPack::isCurrent(const fs::path &project) const {
+    // a file that can't be looked at counts as changed
+    for(const auto &item : mItems){
+        boost::system::error_code sizeError, timeError;
+        fs::path file = project / item.first;
+        uintmax_t size = fs::file_size( file, sizeError );
+        std::time_t time = fs::last_write_time( file, timeError );
+        if( sizeError || timeError || size != item.second.mFileSize || time != item.second.mFileTime ) return false;
+    }
+    return true;
+}
+
+bool ProjectPack::has(const string &name) const {
+    auto it = mItems.find( name );
+    return it != mItems.end() && it->second.mSize > 0;
+}
+
+DataSourceRef ProjectPack::getData(const string &name) const {
+    auto it = mItems.find( name );
+    if( it == mItems.end() || it->second.mSize == 0 ) return DataSourceRef();
+    // wraps the mapping without copying it, a project reloading meanwhile
+    // releases its pack but the mapping lives on until the decode is done
+    std::shared_ptr<const ProjectPack> pack = shared_from_this();
+    BufferRef buffer( new Buffer( mData + it->second.mOffset, it->second.mSize ), [pack]( Buffer *buffer ){ delete buffer; } );
+    return DataSourceBuffer::create( buffer );
+}
+
+string ProjectPack::readFile(const fs::path &path){
+    std::ifstream file( path.string(), std::ios::binary );
+    return string( std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() );
+}
+
+// A JPEG slide scaled down to the most the left, middle, right or full
+// panel shows of it once cropped to the panel's shape, encoded again.
+string ProjectPack::scaleSlide(const fs::path &image, const ivec2 &canvas){
+    Surface8u surface( loadImage( image ) );
+    
+    float scale = 0;
+    for(vec2 panel : { vec2( canvas.x/3.f, canvas.y ), vec2( canvas ) }){
+        Area crop = getSlideCrop( Area( ivec2( 0 ), ivec2( panel ) ), surface.getBounds() );
+        scale = max( scale, panel.x / crop.getWidth() );
+    }
+    if( scale >= .9f ) return readFile( image );
+    
+    ivec2 size( vec2( surface.getSize() ) * scale );
+    fs::path scaled = fs::temp_directory_path() / fs::unique_path( "atriumpack-%%%%%%%%.jpg" );
+    writeImage( scaled, ip::resizeCopy( surface, surface.getBounds(), size ), ImageTarget::Options().quality( .9f ) );
+    string data = readFile( scaled );
+    fs::remove( scaled );
+    return data;
+}
+
+bool ProjectPack::writeProject(const fs::path &project, const ivec2 &canvas){
+    
+    vector<fs::path> files;
+    copy( fs::directory_iterator( project ), fs::directory_iterator(), back_inserter( files ) );
+    sort( files.begin(), files.end() );
+    
+    // what goes in, in folder order, and how each file was when it went in
+    vector<pair<string, string>> items;
+    vector<pair<uint64_t, int64_t>> stamps;
+    for(const fs::path &file : files){
+        string name = file.filename().string();
+        string extension = boost::to_lower_copy( file.extension().string() );
+        if( name == FILENAME || ! fs::is_regular_file( file ) ) continue;
+        
+        try {
+            size_t packed = items.size();
+            pair<uint64_t, int64_t> stamp( fs::file_size( file ), fs::last_write_time( file ) );
+            if( extension == ".jpg" || extension == ".jpeg" ){
+                items.push_back( make_pair( name, scaleSlide( file, canvas ) ) );
+            } else if( extension == ".png" || extension == ".gif" || extension == ".yaml" || extension == ".js" ){
+                items.push_back( make_pair( name, readFile( file ) ) );
+            } else if( extension == ".mov" || extension == ".mp4" || extension == ".m4v" || extension == ".avi" ){
+                items.push_back( make_pair( name, string() ) );
+            }
+            if( items.size() > packed ) stamps.push_back( stamp );
+        } catch( std::exception &e ) {
+            console() << "Leaving " << file << " out of the pack: " << e.what() << endl;
+        }
+    }
+    
+    // offsets follow from the size of the index
+    uint64_t offset = sizeof(sPackMagic) + sizeof(uint32_t);
+    for(const auto &item : items) offset += sizeof(uint16_t) + item.first.size() + 4*sizeof(uint64_t);
+    
+    fs::path path = project / FILENAME, partial = project / ( string( FILENAME ) + ".partial" );
+    std::ofstream file( partial.string(), std::ios::binary | std::ios::trunc );
+    uint32_t count = items.size();
+    file.write( sPackMagic, sizeof(sPackMagic) );
+    file.write( reinterpret_cast<const char*>( &count ), sizeof(count) );
+    vector<uint64_t> offsets;
+    for(size_t i = 0; i < items.size(); i++){
+        offset = ( offset + 15 ) & ~uint64_t( 15 );
+        offsets.push_back( offset );
+        uint16_t length = items[i].first.size();
+        uint64_t size = items[i].second.size();
+        file.write( reinterpret_cast<const char*>( &length ), sizeof(length) );
+        file.write( items[i].first.data(), length );
+        file.write( reinterpret_cast<const char*>( &offset ), sizeof(offset) );
+        file.write( reinterpret_cast<const char*>( &size ), sizeof(size) );
+        file.write( reinterpret_cast<const char*>( &stamps[i].first ), sizeof(stamps[i].first) );
+        file.write( reinterpret_cast<const char*>( &stamps[i].second ), sizeof(stamps[i].second) );
+        offset += size;
+    }
+    for(size_t i = 0; i < items.size(); i++){
+        while( (uint64_t)file.tellp() < offsets[i] ) file.put( 0 );
+        file.write( items[i].second.data(), items[i].second.size() );
+    }
+    file.close();
+    if( ! file ){
+        console() << "Unable to write the pack for " << project << endl;
+        fs::remove( partial );
+        return false;
+    }
+    // readers only ever see a complete pack
+    fs::rename( partial, path );
+    // the rename touched the folder, a pack is current while it's as new as
+    // the folder, on the share's clock
+    boost::system::error_code error;
+    std::time_t folderTime = fs::last_write_time( project, error );
+    if( ! error && folderTime > fs::last_write_time( path ) ) fs::last_write_time( path, folderTime );
+    console() << boost::format( "packed %s: %d files, %.1f MB" ) % project.filename().string() % items.size() % ( fs::file_size( path ) / 1048576. ) << endl;
+    return true;
+}
+
+bool ProjectPack::write(const fs::path &dir, const ivec2 &canvas){
+    if( fs::exists( dir / "project.yaml" ) ) return writeProject( dir, canvas );
+    
+    bool packed = false;
+    for(fs::directory_iterator it( dir ), end; it != end; ++it){
+        if( fs::exists( it->path() / "project.yaml" ) ) packed = writeProject( it->path(), canvas ) || packed;
+    }
+    return packed;
+}
+
+#pragma mark Project
+
+class Project {
+public:
+    
+    Project(const fs::path &p);
+    void loadYAMLFile(const fs::path &pYAML);
+    void setupResources(const fs::path &p);
+    void reload();
+    
+    // a file of the project, read from its pack when it has an up to date one
+    bool hasResource(const fs::path &path) const;
+    DataSourceRef openResource(const fs::path &path) const;
+    // has a file the show will open soon read ahead, unless it is packed
+    void prefetchResource(const fs::path &path, int64_t bytes=numeric_limits<int64_t>::max()) const;
+    
+    fs::path            mPath;
+    std::shared_ptr<ProjectPack> mPack;
+    vector<fs::path>    mResources;
+    vector<fs::path>    mImages;
+    vector<fs::path>    mMovies;
+    
+    //    ConcurrentCircularBuffer<Surface> *mSurfaces;
+    
+    boost::gregorian::date mDate;
+    std::string         mTitle;
+    std::string         mAbstract;
+    std::string         mSummary;
+    vector<std::string> mParticipants;
+    vector<std::string> mCredits;
+    vector<std::string> mMaterials;
+    vector<std::string> mTags;
+    vector<std::string> mPublished;
+    std::string         mCreativeCommons;
+    Url                 mHomepageURL;
+    
+private:
+    int64_t getBytes() const;
+    
+    MemoryEntry         mMemory;
+};
+
+Project::Project(const fs::path &p)
+: mMemory( MemoryLedger::PROJECTS, sizeof(Project) )
+{
+    
+    //   mSurfaces = new ConcurrentCircularBuffer<Surface>( 5 ); // room for 5 images
+    
+    if(fs::exists(p) && fs::is_directory(p)){
+        mPath = p;
+        reload();
+    }
+}
+
+void Project::reload(){
+    if(fs::exists(mPath) && mPath != ""){
+        mResources.clear();
+        mImages.clear();
+        mMovies.clear();
+        
+        // a pack older than the project's yaml or the folder is out of date, as
+        // is one with a packed file changed since, the loose files are used
+        // then; adding, removing or renaming a file touches the folder, and
+        // anything that can't be looked at counts as changed
+        fs::path pPack = mPath / ProjectPack::FILENAME;
+        boost::system::error_code packError, yamlError, folderError;
+        mPack.reset();
+        std::time_t packTime = fs::last_write_time(pPack, packError);
+        std::time_t yamlTime = fs::last_write_time(mPath / "project.yaml", yamlError);
+        std::time_t folderTime = fs::last_write_time(mPath, folderError);
+        if(!packError && !yamlError && !folderError && packTime >= yamlTime && packTime >= folderTime){
+            mPack = make_shared<ProjectPack>();
+            if(!mPack->open(pPack) || !mPack->isCurrent(mPath)) mPack.reset();
+        }
+        
+        setupResources(mPath);
+        fs::path pYAML = fs::path(mPath.string() + "/project.yaml");
+        if(hasResource(pYAML)){
+            loadYAMLFile(pYAML);
+        }
+        mMemory.set( getBytes() );
+    }
+}
+
+// the project with its paths and texts
+int64_t Project::getBytes() const {
+    int64_t bytes = sizeof(Project);
+    for(const vector<fs::path> *paths : { &mResources, &mImages, &mMovies }){
+        for(const fs::path &path : *paths) bytes += sizeof(fs::path) + path.native().capacity();
+    }
+    for(const std::string *text : { &mTitle, &mAbstract, &mSummary, &mCreativeCommons }){
+        bytes += text->capacity();
+    }
+    for(const vector<std::string> *texts : { &mParticipants, &mCredits, &mMaterials, &mTags, &mPublished }){
+        for(const std::string &text : *texts) bytes += sizeof(std::string) + text.capacity();
+    }
+    return bytes;
+}
+
+void Project::loadYAMLFile(const fs::path &pYAML){
+    
+    // load YAML file
+    std::string source = loadString( openResource( pYAML ) );
+    MemoryEntry document( MemoryLedger::YAML_DOCUMENTS, source.size() );
+    YAML::Node projectYaml = YAML::Load(source);
+    
+    if(projectYaml["date"]){
+        try {
+            mDate = boost::gregorian::from_string(projectYaml["date"].as<std::string>());
+        } catch (...) {
+            mDate = boost::gregorian::date(boost::date_time::not_a_date_time);
+        }
+    }
+    
+    if(projectYaml["title"]){
+        mTitle = projectYaml["title"].as<std::string>();
+    }
+    
+    if(projectYaml["abstract"]){
+        mAbstract = projectYaml["abstract"].as<std::string>();
+    }
+    
+    if(projectYaml["summary"]){
+        mSummary = projectYaml["summary"].as<std::string>();
+    }
+    
+    if(projectYaml["participants"]){
+        mParticipants.clear();
+        YAML::Node n = projectYaml["participants"];
+        for(YAML::const_iterator it=n.begin();it!=n.end();++it)
+            mParticipants.push_back((*it)["name"].as<std::string>());
+    }
+    
+    if(projectYaml["credits"]){
+        mCredits.clear();
+        YAML::Node n = projectYaml["credits"];
+        for(YAML::const_iterator it=n.begin();it!=n.end();++it)
+            mCredits.push_back((*it)["name"].as<std::string>());
+    }
+    
+    if(projectYaml["materials"]){
+        mMaterials.clear();
+        YAML::Node n = projectYaml["materials"];
+        for(YAML::const_iterator it=n.begin();it!=n.end();++it)
+            mMaterials.push_back(it->as<std::string>());
+    }
+    
+    if(projectYaml["tags"]){
+        mTags.clear();
+        YAML::Node n = projectYaml["tags"];
+        for(YAML::const_iterator it=n.begin();it!=n.end();++it)
+            mTags.push_back(it->as<std::string>());
+    }
+    
+    if(projectYaml["published"]){
+        mPublished.clear();
+        YAML::Node n = projectYaml["published"];
+        for(YAML::const_iterator it=n.begin();it!=n.end();++it)
+            mPublished.push_back(it->as<std::string>());
+    }
+    
+    if(projectYaml["homepage"]){
+        try {
+            mHomepageURL = Url(projectYaml["homepage"].as<std::string>());
+        } catch (...){
+            mHomepageURL = Url();
+        }
+    }
+    
+    //std::string         mCreativeCommons;
+    
+    
+}
+
+bool Project::hasResource(const fs::path &path) const {
+    if(mPack && path.parent_path() == mPath) return mPack->has(path.filename().string());
+    return fs::exists(path);
+}
+
+DataSourceRef Project::openResource(const fs::path &path) const {
+    if(mPack && path.parent_path() == mPath && mPack->has(path.filename().string())){
+        return mPack->getData(path.filename().string());
+    }
+    return gMediaIO.open(path);
+}
+
+void Project::prefetchResource(const fs::path &path, int64_t bytes) const {
+    if(mPack && path.parent_path() == mPath && mPack->has(path.filename().string())) return;
+    gMediaIO.prefetch(path, bytes);
+}
+
+void Project::setupResources(const fs::path &p){
+    
+    if(fs::exists(p) && fs::is_directory(p)){
+        
+        typedef vector<fs::path> paths;         // store paths,
+        paths resPaths;                         // so we can sort them later
+        
+        if(mPack){
+            // the pack lists the folder as it was packed
+            for(const string &name : mPack->getNames()) resPaths.push_back(p / name);
+        } else {
+            copy(fs::directory_iterator(p), fs::directory_iterator(), back_inserter(resPaths));
+        }
+        
+        sort(resPaths.begin(), resPaths.end()); // sort, since directory iteration
+        // is not ordered on some file systems
+        
+        reverse(resPaths.begin(), resPaths.end());
+        
+        for (paths::const_iterator resIt (resPaths.begin()); resIt != resPaths.end(); ++resIt)
+        {
+            
+            if(boost::iequals(resIt->extension().string(), ".pdf") ){
+                // pdf files
+            }
+            
+            if(boost::iequals(resIt->extension().string(), ".mov") ||
+               boost::iequals(resIt->extension().string(), ".mp4") ||
+               boost::iequals(resIt->extension().string(), ".m4v") ||
+               boost::iequals(resIt->extension().string(), ".avi") ){
+                // movie files
+                mResources.push_back(*resIt);
+                mMovies.push_back(*resIt);
+            }
+            
+            if(boost::iequals(resIt->extension().string(), ".jpg") ||
+               boost::iequals(resIt->extension().string(), ".png") ||
+               boost::iequals(resIt->extension().string(), ".gif") ||
+               boost::iequals(resIt->extension().string(), ".jpeg") ){
+                //image files
+                mResources.push_back(*resIt);
+                mImages.push_back(*resIt);
+            }
+        }
+    }
+    
+}
+
+// A slide's image from data read through its project, typed by the file's
+// extension since the data may come from a pack.
+ImageSourceRef loadSlide(const DataSourceRef &data, const fs::path &image){
+    return loadImage( data, ImageSource::Options(), image.extension().string().substr( 1 ) );
+}
+
+#pragma mark Benchmark
+
+// Writes a small portfolio in the layout readConfig expects: a lab.yaml, an
+// empty calendar and a few published projects with generated photo-sized
+// images. Everything follows from the seed, so runs compare; images that
+// already exist are kept.
+static void writeFixturePortfolio(const fs::path &dir, int32_t seed, int projects, int imagesPerProject){
+    
+    Rand rand( seed );
+    
+    fs::create_directories( dir / "calendar" );
+    for(const char *name : { "timeEdit.ics", "timeEditTmp.ics" }){
+        std::ofstream( ( dir / "calendar" / name ).string() ) << "BEGIN:VCALENDAR\nVERSION:2.0\nEND:VCALENDAR\n";
+    }
+    std::ofstream( ( dir / "lab.yaml" ).string() ) << "taglines:\n  - a fixed tagline for the benchmark.\n  - another fixed tagline.\n";
+    
+    string lorem = "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. ";
+    
+    for(int p = 1; p <= projects; p++){
+        fs::path project = dir / "projects" / ( boost::format( "2017-01-%02d fixture %d" ) % p % p ).str();
+        fs::create_directories( project );
+        
+        std::ofstream yaml( ( project / "project.yaml" ).string() );
+        yaml << "title: Fixture project " << p << "\n";
+        yaml << "date: 2017-01-" << ( boost::format( "%02d" ) % p ) << "\n";
+        yaml << "abstract: " << lorem << "\n";
+        yaml << "summary: " << lorem << lorem << lorem << "\n";
+        yaml << "participants:\n  - name: First Participant\n  - name: Second Participant\n";
+        yaml << "tags: [fixture, benchmark]\n";
+        yaml << "published: [displays]\n";
+        
+        for(int i = 0; i < imagesPerProject; i++){
+            fs::path image = project / ( boost::format( "image%02d.jpg" ) % i ).str();
+            
+            int width = 3000 + rand.nextInt( 1000 ), height = 2000 + rand.nextInt( 500 );
+            Color a( rand.nextFloat(), rand.nextFloat(), rand.nextFloat() ), b( rand.nextFloat(), rand.nextFloat(), rand.nextFloat() );
+            if( fs::exists( image ) ) continue;
+            
+            // gradients with grain, so they decode like photos rather than flat color
+            Surface8u surface( width, height, false );
+            Surface8u::Iter iter = surface.getIter();
+            while( iter.line() ){
+                while( iter.pixel() ){
+                    float t = ( iter.x() + iter.y() ) / float( surface.getWidth() + surface.getHeight() );
+                    int grain = rand.nextInt( 24 ) - 12;
+                    Color c = lerp( a, b, t );
+                    iter.r() = constrain( int( c.r * 255 ) + grain, 0, 255 );
+                    iter.g() = constrain( int( c.g * 255 ) + grain, 0, 255 );
+                    iter.b() = constrain( int( c.b * 255 ) + grain, 0, 255 );
+                }
+            }
+            writeImage( image, surface );
+        }
+    }
+}
+
+// count, mean and percentiles of a list of milliseconds
+static JsonTree benchmarkSummary(const string &key, vector<double> values){
+    JsonTree summary = JsonTree::makeObject( key );
+    sort( values.begin(), values.end() );
+    double sum = 0;
+    for(double v : values) sum += v;
+    auto percentile = [&values]( double p ){ return values.empty() ? 0. : values[min<size_t>( p * values.size(), values.size() - 1 )]; };
+    summary.addChild( JsonTree( "count", (uint64_t)values.size() ) );
+    summary.addChild( JsonTree( "mean", values.empty() ? 0. : sum / values.size() ) );
+    summary.addChild( JsonTree( "p50", percentile( .5 ) ) );
+    summary.addChild( JsonTree( "p95", percentile( .95 ) ) );
+    summary.addChild( JsonTree( "p99", percentile( .99 ) ) );
+    summary.addChild( JsonTree( "max", values.empty() ? 0. : values.back() ) );
+    return summary;
+}
+
+#pragma mark AssetProfiler
+
+// Measures what every slide and movie of every project under the resource
+// path costs the show, through the loader's own code: reading, decoding,
+// the decoded bytes, resampling the full panel's crop to the canvas the way
+// --pack and a lower quality level scale slides, and opening movies. The
+// report is sorted by cost and flags the assets over budget:
+//   --profile-assets [DIR] --report FILE.csv|FILE.json --canvas 5760x1080
+//   --read-ms 500 --decode-ms 250 --decoded-mb 64 --open-ms 1000
+
+class AssetProfiler {
+public:
+    struct Asset {
+        string          mProject, mFile, mKind;
+        int64_t         mFileBytes, mDecodedBytes;
+        ivec2           mSize;
+        double          mReadMs, mDecodeMs, mResampleMs, mOpenMs;
+        vector<string>  mFlags;
+        string          mError;
+        
+        double getCost() const { return mReadMs + mDecodeMs + mResampleMs + mOpenMs; }
+    };
+    
+    explicit AssetProfiler(const vector<string> &args);
+    void run();
+    
+private:
+    Asset profileImage(const Project &project, const fs::path &path) const;
+    Asset profileMovie(const Project &project, const fs::path &path) const;
+    void writeCsv(std::ostream &out) const;
+    void writeJson(std::ostream &out) const;
+    
+    fs::path        mResourcePath, mReport;
+    Area            mCanvas;
+    double          mReadBudget, mDecodeBudget, mOpenBudget;
+    int64_t         mDecodedBudget;
+    vector<Asset>   mAssets;
+};
+
+AssetProfiler::AssetProfiler(const vector<string> &args)
+: mCanvas( 0, 0, 5760, 1080 ), mReadBudget( 500 ), mDecodeBudget( 250 ), mOpenBudget( 1000 ), mDecodedBudget( 64 << 20 )
+{
+    try {
+        YAML::Node config = YAML::LoadFile(Platform::get()->getResourcePath(RES_CUSTOM_YAML_CONFIG).c_str());
+        mResourcePath = expand_user( config["resourcePath"].as<std::string>() );
+    } catch( std::exception &e ) {
+        console() << "No resource path in the config file: " << e.what() << endl;
+    }
+    mReport = getLogsPath() / "assets.csv";
+    
+    for(size_t i = 0; i + 1 < args.size(); i++){
+        const string &value = args[i + 1];
+        try {
+            if( args[i] == "--profile-assets" && ! boost::starts_with( value, "--" ) ) mResourcePath = expand_user( value );
+            else if( args[i] == "--report" ) mReport = value;
+            else if( args[i] == "--read-ms" ) mReadBudget = stod( value );
+            else if( args[i] == "--decode-ms" ) mDecodeBudget = stod( value );
+            else if( args[i] == "--open-ms" ) mOpenBudget = stod( value );
+            else if( args[i] == "--decoded-mb" ) mDecodedBudget = stod( value ) * 1048576;
+            else if( args[i] == "--canvas" ){
+                ivec2 canvas = mCanvas.getSize();
+                sscanf( value.c_str(), "%dx%d", &canvas.x, &canvas.y );
+                mCanvas = Area( ivec2( 0 ), canvas );
+            }
+        } catch( std::exception &e ) {
+            console() << "Ignoring asset profiler option " << args[i] << " " << value << ": " << e.what() << endl;
+        }
+    }
+}
+
+void AssetProfiler::run(){
+    vector<fs::path> projects;
+    fs::path dir = mResourcePath / "projects";
+    if( fs::is_directory( dir ) ){
+        copy( fs::directory_iterator( dir ), fs::directory_iterator(), back_inserter( projects ) );
+    }
+    sort( projects.begin(), projects.end() );
+    
+    // every project, published to the displays or not
+    for(const fs::path &path : projects){
+        if( ! fs::is_directory( path ) ) continue;
+        Project project( path );
+        console() << "Profiling " << path.filename().string() << ": " << project.mImages.size() << " slides, " << project.mMovies.size() << " movies" << endl;
+        for(const fs::path &image : project.mImages) mAssets.push_back( profileImage( project, image ) );
+        for(const fs::path &movie : project.mMovies) mAssets.push_back( profileMovie( project, movie ) );
+    }
+    sort( mAssets.begin(), mAssets.end(), []( const Asset &a, const Asset &b ){ return a.getCost() > b.getCost(); } );
+    
+    fs::create_directories( fs::absolute( mReport ).parent_path() );
+    std::ofstream out( mReport.string() );
+    if( boost::iequals( mReport.extension().string(), ".json" ) ){
+        writeJson( out );
+    } else {
+        writeCsv( out );
+    }
+    
+    size_t flagged = 0;
+    for(const Asset &asset : mAssets){
+        if( asset.mFlags.empty() ) continue;
+        flagged++;
+        console() << ( boost::format( "  %-50s %s" ) % ( asset.mProject + "/" + asset.mFile ) % boost::algorithm::join( asset.mFlags, ", " ) ).str() << endl;
+    }
+    console() << mAssets.size() << " assets profiled, " << flagged << " over budget, report in " << mReport << endl;
+}
+
+AssetProfiler::Asset AssetProfiler::profileImage(const Project &project, const fs::path &path) const {
+    Asset asset = { project.mPath.filename().string(), path.filename().string(), "image", 0, 0, ivec2( 0 ), 0, 0, 0, 0 };
+    typedef std::chrono::high_resolution_clock Clock;
+    auto ms = []( Clock::time_point from, Clock::time_point to ){ return std::chrono::duration<double, std::milli>( to - from ).count(); };
+    try {
+        auto start = Clock::now();
+        DataSourceRef data = project.openResource( path );
+        auto read = Clock::now();
+        Surface8u surface( loadSlide( data, path ) );
+        auto decoded = Clock::now();
+        // slides already at or below the canvas' resolution aren't resampled
+        Area crop = getSlideCrop( mCanvas, surface.getBounds() );
+        if( crop.getWidth() > mCanvas.getWidth() ){
+            Surface8u scaled = ip::resizeCopy( surface, crop, mCanvas.getSize() );
+        }
+        auto resampled = Clock::now();
+        
+        asset.mFileBytes = data->getBuffer()->getSize();
+        asset.mSize = surface.getSize();
+        asset.mDecodedBytes = (int64_t)surface.getRowBytes() * surface.getHeight();
+        asset.mReadMs = ms( start, read );
+        asset.mDecodeMs = ms( read, decoded );
+        asset.mResampleMs = ms( decoded, resampled );
+    } catch( std::exception &e ) {
+        asset.mError = e.what();
+        asset.mFlags.push_back( "unreadable" );
+    }
+    if( asset.mReadMs > mReadBudget ) asset.mFlags.push_back( "slow read" );
+    if( asset.mDecodeMs > mDecodeBudget ) asset.mFlags.push_back( "slow decode" );
+    if( asset.mDecodedBytes > mDecodedBudget ) asset.mFlags.push_back( "large" );
+    return asset;
+}
+
+AssetProfiler::Asset AssetProfiler::profileMovie(const Project &project, const fs::path &path) const {
+    Asset asset = { project.mPath.filename().string(), path.filename().string(), "movie", 0, 0, ivec2( 0 ), 0, 0, 0, 0 };
+    boost::system::error_code error;
+    asset.mFileBytes = fs::file_size( path, error );
+    try {
+        // what loadMovieFile blocks the main thread for, without a GL context here
+        auto start = std::chrono::high_resolution_clock::now();
+        qtime::MovieSurfaceRef movie = qtime::MovieSurface::create( path );
+        asset.mOpenMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+        asset.mSize = movie->getSize();
+        asset.mDecodedBytes = (int64_t)asset.mSize.x * asset.mSize.y * 4;
+    } catch( std::exception &e ) {
+        asset.mError = e.what();
+        asset.mFlags.push_back( "unreadable" );
+    }
+    if( asset.mOpenMs > mOpenBudget ) asset.mFlags.push_back( "slow open" );
+    return asset;
+}
+
+void AssetProfiler::writeCsv(std::ostream &out) const {
+    auto quoted = []( const string &text ){ return "\"" + boost::replace_all_copy( text, "\"", "\"\"" ) + "\""; };
+    out << "project,file,kind,file_bytes,width,height,decoded_bytes,read_ms,decode_ms,resample_ms,open_ms,flags,error" << endl;
+    for(const Asset &asset : mAssets){
+        out << quoted( asset.mProject ) << "," << quoted( asset.mFile ) << "," << asset.mKind << ","
+            << asset.mFileBytes << "," << asset.mSize.x << "," << asset.mSize.y << "," << asset.mDecodedBytes << ","
+            << ( boost::format( "%.2f,%.2f,%.2f,%.2f," ) % asset.mReadMs % asset.mDecodeMs % asset.mResampleMs % asset.mOpenMs )
+            << quoted( boost::algorithm::join( asset.mFlags, ";" ) ) << "," << quoted( asset.mError ) << endl;
+    }
+}
+
+void AssetProfiler::writeJson(std::ostream &out) const {
+    JsonTree budgets = JsonTree::makeObject( "budgets" );
+    budgets.addChild( JsonTree( "readMs", mReadBudget ) );
+    budgets.addChild( JsonTree( "decodeMs", mDecodeBudget ) );
+    budgets.addChild( JsonTree( "decodedMB", mDecodedBudget / 1048576. ) );
+    budgets.addChild( JsonTree( "openMs", mOpenBudget ) );
+    
+    JsonTree assets = JsonTree::makeArray( "assets" );
+    for(const Asset &asset : mAssets){
+        JsonTree entry;
+        entry.addChild( JsonTree( "project", asset.mProject ) );
+        entry.addChild( JsonTree( "file", asset.mFile ) );
+        entry.addChild( JsonTree( "kind", asset.mKind ) );
+        entry.addChild( JsonTree( "fileBytes", (double)asset.mFileBytes ) );
+        entry.addChild( JsonTree( "width", asset.mSize.x ) );
+        entry.addChild( JsonTree( "height", asset.mSize.y ) );
+        entry.addChild( JsonTree( "decodedBytes", (double)asset.mDecodedBytes ) );
+        entry.addChild( JsonTree( "readMs", asset.mReadMs ) );
+        entry.addChild( JsonTree( "decodeMs", asset.mDecodeMs ) );
+        entry.addChild( JsonTree( "resampleMs", asset.mResampleMs ) );
+        entry.addChild( JsonTree( "openMs", asset.mOpenMs ) );
+        JsonTree flags = JsonTree::makeArray( "flags" );
+        for(const string &flag : asset.mFlags) flags.pushBack( JsonTree( "", flag ) );
+        entry.addChild( flags );
+        if( ! asset.mError.empty() ) entry.addChild( JsonTree( "error", asset.mError ) );
+        assets.pushBack( entry );
+    }
+    
+    JsonTree report;
+    report.addChild( JsonTree( "resourcePath", mResourcePath.string() ) );
+    report.addChild( JsonTree( "canvas", ( boost::format( "%dx%d" ) % mCanvas.getWidth() % mCanvas.getHeight() ).str() ) );
+    report.addChild( budgets );
+    report.addChild( assets );
+    out << report.serialize() << endl;
+}
+
+#pragma mark ShowSync
+
+// Runs the show of a second display in lockstep with the first over UDP.
+// Every value that steers the show goes through ShowTrace::steer: the
+// leader sends each one to its followers as it happens, and a follower
+// takes the leader's in place of its own, like a replay arriving live. The
+// follower's show clock is slewed to the leader's, estimated from pings
+// with the fastest round trip, and transition times are among the steered
+// values, so both displays reach every transition at the same show time.
+//
+// A follower joins as the leader starts a show cycle: it holds at the
+// start of its own until then. The leader ends the events of every
+// transition with an `end` event, and the follower's main thread keeps the
+// current frame until the leader's whole transition is there, so steering
+// it never waits. When the leader goes quiet, or a transition or slide it
+// waits for doesn't come, it carries on by itself until it can join again.
+// The leader only answers the followers it was given, and resends a few
+// events per ping at most, so it can't be used to flood another host.
+//
+// One message per datagram, tab separated:
+//   ping   seq sent acked           follower to leader, four a second
+//   pong   seq sent time seed       leader to follower, time is the leader's show time
+//   event  n time kind value        leader to followers, resent until acked
+
+class ShowSync {
+public:
+    enum Role { OFF, LEADER, FOLLOWER };
+    
+    static const int PORT = 47800;
+    
+    ShowSync();
+    ~ShowSync();
+    
+    // followers are host names or addresses, pings from anywhere else are ignored
+    bool lead(int port, int32_t seed, const vector<string> &followers);
+    bool follow(const string &host, int port);
+    void stop();
+    
+    Role getRole() const { return mRole; }
+    // the leader's event a follower joins on
+    void setJoin(const string &kind, const string &value);
+    
+    // sends the value from the leader, a follower gets the leader's instead
+    string steer(const string &kind, const string &value);
+    // the leader's next value of this kind on a follower, without taking it
+    string peek(const string &kind, const string &fallback) const;
+    
+    // from the main thread once per frame, moves the show clock toward the leader's
+    void update();
+    // from a follower's main thread at the start of a show cycle: whether to
+    // hold it for the leader's, which it then joins
+    bool waitForLeader();
+    // from the main thread before a transition: whether all of the leader's
+    // is here, if not the frame is kept and this asked again the next one
+    bool isReady();
+    // from the main thread after a transition
+    void endTransition();
+    
+    bool isLocked() const { return mLocked; }
+    int32_t getSeed() const { return mSeed; }
+    double getOffset() const { return mOffset; }
+    double getRoundTrip() const { return mRoundTrip; }
+    uint64_t getEvents() const { return mEvents; }
+    size_t getFollowers() const;
+    vector<string> report() const;
+    
+private:
+    static const size_t HISTORY = 1024;
+    static const size_t SAMPLES = 16;
+    static const size_t RESENDS = 16;     // per ping
+    // how long the main thread keeps its frame for a transition of the
+    // leader's, and the loader waits for an image, shorter than any slide
+    static constexpr double TRANSITION_PATIENCE = 1.;
+    static constexpr double LOADER_PATIENCE = 3.;
+    
+    struct Event {
+        uint64_t    mNumber;
+        double      mTime;
+        string      mKind, mValue;
+    };
+    
+    struct Peer {
+        struct sockaddr_in  mAddress;
+        uint64_t            mAcked;
+        double              mHeard;
+    };
+    
+    static bool resolve(const string &host, struct in_addr &address);
+    
+    bool open(int port, Role role);
+    void run();
+    void send(const string &message, const struct sockaddr_in &to);
+    void receive(const vector<string> &fields, const struct sockaddr_in &from);
+    void drain(double now);
+    void deliver(const Event &event);
+    void unlock(const string &reason);
+    
+    std::atomic<Role>               mRole;  // also read by the loader thread
+    std::thread::id                 mMainThread;
+    int                             mSocket;
+    std::shared_ptr<std::thread>    mThread;
+    std::atomic<bool>               mShouldQuit;
+    mutable std::mutex              mMutex;
+    std::condition_variable         mArrived;
+    
+    // leader
+    vector<in_addr_t>               mFollowers;
+    deque<Event>                    mHistory;
+    map<string, Peer>               mPeers;
+    
+    // follower
+    struct sockaddr_in              mLeader;
+    double                          mStarted, mHeard, mNextPing, mGapSince;
+    uint64_t                        mPingSeq, mExpected;
+    map<uint64_t, Event>            mPending;
+    map<string, deque<Event>>       mQueues;
+    map<uint64_t, double>           mPings;
+    deque<pair<double, double>>     mSamples;       // round trip, offset
+    deque<double>                   mSkews;         // transition lateness behind the leader
+    string                          mJoinKind, mJoinValue;
+    bool                            mJoining;
+    double                          mReadySince;
+    
+    std::atomic<bool>               mLocked;
+    std::atomic<int32_t>            mSeed;
+    std::atomic<double>             mOffset, mRoundTrip;
+    std::atomic<uint64_t>           mEvents, mResends, mLosses;
+};
+
+ShowSync::ShowSync()
+: mRole( OFF ), mSocket( -1 ), mShouldQuit( false ), mStarted( 0 ), mHeard( -1 ), mNextPing( 0 ), mGapSince( -1 ), mPingSeq( 0 ), mExpected( 0 ),
+mJoining( false ), mReadySince( -1 ), mLocked( false ), mSeed( 0 ), mOffset( 0 ), mRoundTrip( 0 ), mEvents( 0 ), mResends( 0 ), mLosses( 0 )
+{
+}
+
+ShowSync::~ShowSync(){
+    stop();
+}
+
+bool ShowSync::resolve(const string &host, struct in_addr &address){
+    struct addrinfo hints, *found = nullptr;
+    memset( &hints, 0, sizeof(hints) );
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if( getaddrinfo( host.c_str(), nullptr, &hints, &found ) != 0 || ! found ) return false;
+    address = reinterpret_cast<struct sockaddr_in*>( found->ai_addr )->sin_addr;
+    freeaddrinfo( found );
+    return true;
+}
+
+bool ShowSync::open(int port, Role role){
+    mSocket = socket( AF_INET, SOCK_DGRAM, 0 );
+    if( mSocket < 0 ){
+        console() << "Unable to sync the show: " << strerror( errno ) << endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt( mSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse) );
+    
+    struct sockaddr_in address;
+    memset( &address, 0, sizeof(address) );
+    address.sin_family = AF_INET;
+    address.sin_port = htons( port );
+    address.sin_addr.s_addr = htonl( INADDR_ANY );
+    if( ::bind( mSocket, (struct sockaddr*)&address, sizeof(address) ) < 0 ){
+        console() << "Unable to sync the show on port " << port << ": " << strerror( errno ) << endl;
+        close( mSocket );
+        mSocket = -1;
+        return false;
+    }
+    
+    // everything the thread reads is set before it starts
+    mRole = role;
+    mShouldQuit = false;
+    mStarted = getElapsedSeconds();
+    mMainThread = std::this_thread::get_id();
+    mThread = make_shared<std::thread>( &ShowSync::run, this );
+    return true;
+}
+
+bool ShowSync::lead(int port, int32_t seed, const vector<string> &followers){
+    mFollowers.clear();
+    for(const string &follower : followers){
+        struct in_addr address;
+        if( ! resolve( follower, address ) ){
+            console() << "Unable to find the show follower " << follower << endl;
+            continue;
+        }
+        mFollowers.push_back( address.s_addr );
+    }
+    if( mFollowers.empty() ){
+        console() << "Not leading the show, no followers listed in syncFollowers or --followers" << endl;
+        return false;
+    }
+    
+    mSeed = seed;
+    if( ! open( port, LEADER ) ) return false;
+    console() << "Leading the show on UDP port " << port << endl;
+    return true;
+}
+
+bool ShowSync::follow(const string &host, int port){
+    memset( &mLeader, 0, sizeof(mLeader) );
+    mLeader.sin_family = AF_INET;
+    mLeader.sin_port = htons( port );
+    if( ! resolve( host, mLeader.sin_addr ) ){
+        console() << "Unable to sync the show, no leader at " << host << endl;
+        return false;
+    }
+    
+    // any port, the leader answers where the pings come from
+    if( ! open( 0, FOLLOWER ) ) return false;
+    console() << "Following the show of " << host << ":" << port << endl;
+    return true;
+}
+
+void ShowSync::stop(){
+    mShouldQuit = true;
+    mArrived.notify_all();
+    if( mThread ){
+        mThread->join();
+        mThread.reset();
+    }
+    if( mSocket >= 0 ){
+        close( mSocket );
+        mSocket = -1;
+    }
+    mLocked = false;
+}
+
+void ShowSync::setJoin(const string &kind, const string &value){
+    std::lock_guard<std::mutex> lock( mMutex );
+    mJoinKind = kind;
+    mJoinValue = value;
+}
+
+string ShowSync::steer(const string &kind, const string &value){
+    if( mRole == LEADER ){
+        std::lock_guard<std::mutex> lock( mMutex );
+        Event event = { mHistory.empty() ? 1 : mHistory.back().mNumber + 1, showTime(), kind, value };
+        mHistory.push_back( event );
+        if( mHistory.size() > HISTORY ) mHistory.pop_front();
+        mEvents++;
+        string message = ( boost::format( "event\t%d\t%.6f\t%s\t%s" ) % event.mNumber % event.mTime % kind % value ).str();
+        for(const auto &peer : mPeers){
+            send( message, peer.second.mAddress );
+        }
+        return value;
+    }
+    
+    if( mRole != FOLLOWER || ! mLocked ) return value;
+    
+    // the main thread only steers once isReady() saw the leader's whole
+    // transition; the loader decodes ahead at its own pace and may wait
+    std::unique_lock<std::mutex> lock( mMutex );
+    if( std::this_thread::get_id() != mMainThread ){
+        double seconds = LOADER_PATIENCE;
+        mArrived.wait_for( lock, std::chrono::duration<double>( seconds ), [&]{ return mShouldQuit || ! mLocked || ! mQueues[kind].empty(); } );
+    }
+    if( ! mLocked || mQueues[kind].empty() ){
+        lock.unlock();
+        unlock( "no " + kind + " from the leader" );
+        return value;
+    }
+    Event event = mQueues[kind].front();
+    mQueues[kind].pop_front();
+    if( kind == "transition" ){
+        // how much later than the leader this display gets there
+        mSkews.push_back( abs( showTime() - event.mTime ) );
+        if( mSkews.size() > 100 ) mSkews.pop_front();
+    }
+    return event.mValue;
+}
+
+string ShowSync::peek(const string &kind, const string &fallback) const {
+    if( mRole != FOLLOWER || ! mLocked ) return fallback;
+    std::lock_guard<std::mutex> lock( mMutex );
+    auto queue = mQueues.find( kind );
+    return queue != mQueues.end() && ! queue->second.empty() ? queue->second.front().mValue : fallback;
+}
+
+bool ShowSync::isReady(){
+    if( mRole != FOLLOWER || ! mLocked ) return true;
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        double now = getElapsedSeconds();
+        if( ! mQueues["end"].empty() ){
+            mReadySince = -1;
+            return true;
+        }
+        if( mReadySince < 0 ) mReadySince = now;
+        if( now - mReadySince < TRANSITION_PATIENCE ) return false;
+        mReadySince = -1;
+    }
+    unlock( "no transition from the leader" );
+    return true;
+}
+
+void ShowSync::endTransition(){
+    if( mRole == LEADER ){
+        steer( "end", "" );
+    } else if( mRole == FOLLOWER && mLocked ){
+        std::lock_guard<std::mutex> lock( mMutex );
+        if( ! mQueues["end"].empty() ) mQueues["end"].pop_front();
+    }
+}
+
+void ShowSync::update(){
+    if( mRole != FOLLOWER ) return;
+    
+    double offset;
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        // the clock of a show running by itself is left alone
+        if( mSamples.empty() || ! ( mLocked || mJoining ) ) return;
+        // the sample with the fastest round trip has the least asymmetric delay in it
+        auto best = min_element( mSamples.begin(), mSamples.end() );
+        offset = best->second;
+        mRoundTrip = best->first;
+    }
+    
+    // jumps only while held at the start of a cycle to join; once locked the
+    // show clock never runs backwards, so it slews a little per frame, steps
+    // over a large lag, and takes back a large lead a few milliseconds per
+    // frame, less than a frame lasts
+    double step = offset - mOffset;
+    if( mLocked && step >= .1 ){
+        console() << ( boost::format( "Show clock %.0fms behind the leader's, stepping forward" ) % ( step * 1000. ) ).str() << endl;
+    } else if( mLocked ){
+        step = math<double>::clamp( step, step > -.1 ? -.0005 : -.005, .0005 );
+    }
+    mOffset = mOffset + step;
+    setClockOffset( mOffset );
+}
+
+bool ShowSync::waitForLeader(){
+    if( mRole != FOLLOWER || mLocked ) return false;
+    std::lock_guard<std::mutex> lock( mMutex );
+    double now = getElapsedSeconds();
+    // a leader just launched along with the follower gets a few seconds to answer
+    mJoining = mHeard >= 0 ? now - mHeard < 2. : now - mStarted < 10.;
+    return mJoining;
+}
+
+size_t ShowSync::getFollowers() const {
+    std::lock_guard<std::mutex> lock( mMutex );
+    return mPeers.size();
+}
+
+vector<string> ShowSync::report() const {
+    vector<string> lines;
+    if( mRole == LEADER ){
+        lines.push_back( ( boost::format( "sync: leading %d followers, %d events, %d resent" ) % getFollowers() % mEvents.load() % mResends.load() ).str() );
+    } else if( mRole == FOLLOWER ){
+        vector<double> skews;
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            skews.assign( mSkews.begin(), mSkews.end() );
+        }
+        sort( skews.begin(), skews.end() );
+        auto percentile = [&skews]( double p ){ return skews.empty() ? 0. : skews[min<size_t>( p * skews.size(), skews.size() - 1 )]; };
+        lines.push_back( ( boost::format( "sync: %s, clock %+.2fs, %.1fms round trip, transitions %.1fms p50 %.1fms p95 behind, %d events, lost %d times" )
+                          % ( mLocked ? "following" : "waiting for the leader" ) % mOffset.load() % ( mRoundTrip * 1000. )
+                          % ( percentile( .5 ) * 1000. ) % ( percentile( .95 ) * 1000. ) % mEvents.load() % mLosses.load() ).str() );
+    }
+    return lines;
+}
+
+void ShowSync::send(const string &message, const struct sockaddr_in &to){
+    sendto( mSocket, message.data(), message.size(), 0, (const struct sockaddr*)&to, sizeof(to) );
+}
+
+void ShowSync::run(){
+    char buffer[2048];
+    while( ! mShouldQuit ){
+        // wakes up often enough to ping and to notice stop()
+        struct pollfd ready = { mSocket, POLLIN, 0 };
+        if( poll( &ready, 1, 50 ) > 0 ){
+            struct sockaddr_in from;
+            socklen_t fromLength = sizeof(from);
+            ssize_t length = recvfrom( mSocket, buffer, sizeof(buffer) - 1, 0, (struct sockaddr*)&from, &fromLength );
+            if( length > 0 ){
+                // the value is the rest of the message, whatever it holds
+                vector<string> fields;
+                string message( buffer, length );
+                size_t start = 0;
+                while( fields.size() < 4 ){
+                    size_t tab = message.find( '\t', start );
+                    if( tab == string::npos ) break;
+                    fields.push_back( message.substr( start, tab - start ) );
+                    start = tab + 1;
+                }
+                fields.push_back( message.substr( start ) );
+                try {
+                    receive( fields, from );
+                } catch( std::exception &e ) {
+                    console() << "Bad show sync message: " << e.what() << endl;
+                }
+            }
+        }
+        
+        double now = getElapsedSeconds();
+        std::unique_lock<std::mutex> lock( mMutex );
+        if( mRole == LEADER ){
+            for(auto it = mPeers.begin(); it != mPeers.end(); ){
+                if( now - it->second.mHeard > 5. ){
+                    console() << "Show follower at " << it->first << " went quiet" << endl;
+                    it = mPeers.erase( it );
+                } else {
+                    ++it;
+                }
+            }
+        } else if( mRole == FOLLOWER && now >= mNextPing ){
+            mNextPing = now + .25;
+            mPings[++mPingSeq] = now;
+            if( mPings.size() > SAMPLES ) mPings.erase( mPings.begin() );
+            send( ( boost::format( "ping\t%d\t%.6f\t%d" ) % mPingSeq % now % ( mExpected ? mExpected - 1 : 0 ) ).str(), mLeader );
+            
+            // an event that never came, what follows can't be taken in order
+            bool lost = mGapSince >= 0 && now - mGapSince > 1.;
+            bool quiet = mLocked && now - mHeard > 2.;
+            if( lost ){
+                mExpected = mPending.begin()->first;
+                drain( now );
+            }
+            lock.unlock();
+            mArrived.notify_all();
+            if( lost ) unlock( "missed events from the leader" );
+            if( quiet ) unlock( "the leader went quiet" );
+        }
+    }
+}
+
+void ShowSync::receive(const vector<string> &fields, const struct sockaddr_in &from){
+    const string &type = fields[0];
+    double now = getElapsedSeconds();
+    
+    if( mRole == LEADER && type == "ping" && fields.size() >= 4 ){
+        if( find( mFollowers.begin(), mFollowers.end(), from.sin_addr.s_addr ) == mFollowers.end() ) return;
+        std::lock_guard<std::mutex> lock( mMutex );
+        string key = ( boost::format( "%s:%d" ) % inet_ntoa( from.sin_addr ) % ntohs( from.sin_port ) ).str();
+        bool joined = ! mPeers.count( key );
+        Peer &peer = mPeers[key];
+        peer.mAddress = from;
+        peer.mHeard = now;
+        uint64_t acked = stoull( fields[3] );
+        uint64_t last = mHistory.empty() ? 0 : mHistory.back().mNumber;
+        if( joined ){
+            // a new follower joins at a cycle start, what came before is of no use to it
+            peer.mAcked = last;
+            console() << "Show follower at " << key << " joined" << endl;
+        } else {
+            peer.mAcked = max( peer.mAcked, acked );
+        }
+        send( ( boost::format( "pong\t%s\t%s\t%.6f\t%d" ) % fields[1] % fields[2] % showTime() % mSeed.load() ).str(), from );
+        
+        // the oldest of what the follower hasn't acknowledged, lost or still on its way
+        size_t resent = 0;
+        for(const Event &event : mHistory){
+            if( event.mNumber <= peer.mAcked ) continue;
+            if( resent++ == RESENDS ) break;
+            send( ( boost::format( "event\t%d\t%.6f\t%s\t%s" ) % event.mNumber % event.mTime % event.mKind % event.mValue ).str(), from );
+            mResends++;
+        }
+        return;
+    }
+    
+    if( mRole != FOLLOWER || from.sin_addr.s_addr != mLeader.sin_addr.s_addr || from.sin_port != mLeader.sin_port ) return;
+    
+    if( type == "pong" && fields.size() >= 5 ){
+        std::lock_guard<std::mutex> lock( mMutex );
+        mHeard = now;
+        mSeed = stoi( fields[4] );
+        auto ping = mPings.find( stoull( fields[1] ) );
+        if( ping == mPings.end() ) return;
+        // the leader's time was taken halfway through the round trip
+        double sent = ping->second, leaderTime = stod( fields[3] );
+        mPings.erase( ping );
+        mSamples.push_back( make_pair( now - sent, leaderTime - ( sent + now ) / 2. ) );
+        if( mSamples.size() > SAMPLES ) mSamples.pop_front();
+    } else if( type == "event" && fields.size() >= 5 ){
+        Event event = { stoull( fields[1] ), stod( fields[2] ), fields[3], fields[4] };
+        std::unique_lock<std::mutex> lock( mMutex );
+        mHeard = now;
+        if( ! mExpected ) mExpected = event.mNumber;
+        if( event.mNumber < mExpected ) return;
+        mPending[event.mNumber] = event;
+        drain( now );
+        lock.unlock();
+        mArrived.notify_all();
+    }
+}
+
+// with the lock held: events in order only, a gap waits for the resend
+void ShowSync::drain(double now){
+    while( ! mPending.empty() && mPending.begin()->first == mExpected ){
+        deliver( mPending.begin()->second );
+        mPending.erase( mPending.begin() );
+        mExpected++;
+    }
+    mGapSince = mPending.empty() ? -1 : mGapSince >= 0 ? mGapSince : now;
+}
+
+// with the lock held
+void ShowSync::deliver(const Event &event){
+    mEvents++;
+    if( ! mLocked ){
+        // joins on the leader's cycle start, if the show here holds for it
+        if( ! mJoining || event.mKind != mJoinKind || event.mValue != mJoinValue ) return;
+        mQueues.clear();
+        mSkews.clear();
+        mJoining = false;
+        mLocked = true;
+        console() << "Joined the leader's show" << endl;
+    }
+    deque<Event> &queue = mQueues[event.mKind];
+    queue.push_back( event );
+    if( queue.size() > 64 ){
+        // the show here took a different turn than the leader's
+        mLocked = false;
+        mQueues.clear();
+        mLosses++;
+        console() << "Left the leader's show, " << event.mKind << " events pile up" << endl;
+        mArrived.notify_all();
+    }
+}
+
+void ShowSync::unlock(const string &reason){
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        if( ! mLocked ) return;
+        mLocked = false;
+        mQueues.clear();
+        mLosses++;
+    }
+    console() << "Left the leader's show, " << reason << ", carrying on until the next cycle start" << endl;
+    mArrived.notify_all();
+}
+
+#pragma mark ShowTrace
+
+// A compact record of what steered the show, one line per event with the
+// show time: random draws, transitions, projects, images and movies.
+//   812.250	transition	4
+// Recorded on a display, the same file replays that sequence on a virtual
+// clock. While replaying, steer() hands back the recorded values of each
+// kind in order, so the show follows the recording even where the loader
+// runs at a different pace. Lines starting with # hold the header. With a
+// ShowSync, the values are the leader's on a follower. Recording keeps the
+// newest MAX_KEPT traces next to the new one and stops at MAX_BYTES.
+class ShowTrace {
+public:
+    enum Mode { OFF, RECORD, REPLAY };
+    
+    ShowTrace() : mMode( OFF ), mSync( NULL ) {}
+    
+    void setSync(ShowSync *sync) { mSync = sync; }
+    
+    bool record(const fs::path &path, const vector<pair<string, string>> &header);
+    bool replay(const fs::path &path);
+    
+    Mode getMode() const { return mMode; }
+    string getHeader(const string &key, const string &fallback = "") const;
+    
+    // the value of an event of this kind: written down while recording, the
+    // next recorded one while replaying, or the given one once those run out
+    string steer(const string &kind, const string &value);
+    int steer(const string &kind, int value);
+    float steer(const string &kind, float value);
+    double steer(const string &kind, double value);
+    // written down while recording, only informative on replay
+    void note(const string &kind, const string &value);
+    // the value the next steer of this kind gets from the recording or the
+    // leader, without taking it, or the fallback
+    string peek(const string &kind, const string &fallback) const;
+    
+    float randFloat(float from, float to) { return steer( "rand", ci::randFloat( from, to ) ); }
+    int randInt(int range) { return steer( "rand", ci::randInt( range ) ); }
+    
+    // whether all recorded events of this kind have been replayed
+    bool isReplayed(const string &kind) const;
+    
+private:
+    static const size_t MAX_KEPT = 10;
+    static const std::streamoff MAX_BYTES = 64 * 1024 * 1024;
+    
+    // with the lock held
+    void write(const string &kind, const string &value);
+    
+    Mode                        mMode;
+    ShowSync                    *mSync;
+    std::ofstream               mFile;
+    map<string, string>         mHeader;
+    map<string, deque<string>>  mRecorded;
+    mutable std::mutex          mMutex; // images are steered from the loader thread
+};
+
+bool ShowTrace::record(const fs::path &path, const vector<pair<string, string>> &header){
+    // the names start with the date, so they sort oldest first
+    vector<fs::path> traces;
+    boost::system::error_code error;
+    for(fs::directory_iterator it( path.parent_path(), error ), end; it != end; it.increment( error )){
+        string name = it->path().filename().string();
+        if( boost::starts_with( name, "trace " ) && it->path().extension() == ".tsv" ) traces.push_back( it->path() );
+    }
+    sort( traces.begin(), traces.end() );
+    for(size_t i = 0; i + MAX_KEPT < traces.size(); i++){
+        fs::remove( traces[i], error );
+    }
+    
+    mFile.open( path.string(), std::ios::trunc );
+    if( ! mFile.is_open() ){
+        console() << "Unable to record the show trace at: " << path << endl;
+        return false;
+    }
+    for(const auto &entry : header){
+        mFile << "#\t" << entry.first << "\t" << entry.second << "\n";
+    }
+    mFile.flush();
+    mMode = RECORD;
+    console() << "Recording the show trace at: " << path << endl;
+    return true;
+}
+
+bool ShowTrace::replay(const fs::path &path){
+    std::ifstream file( path.string() );
+    if( ! file.is_open() ){
+        console() << "No show trace at: " << path << endl;
+        return false;
+    }
+    size_t count = 0;
+    string line;
+    while( getline( file, line ) ){
+        size_t kind = line.find( '\t' );
+        size_t value = kind == string::npos ? string::npos : line.find( '\t', kind + 1 );
+        if( value == string::npos ) continue;
+        if( line[0] == '#' ){
+            mHeader[line.substr( kind + 1, value - kind - 1 )] = line.substr( value + 1 );
+        } else {
+            mRecorded[line.substr( kind + 1, value - kind - 1 )].push_back( line.substr( value + 1 ) );
+            count++;
+        }
+    }
+    mMode = REPLAY;
+    console() << "Replaying " << count << " events from: " << path << endl;
+    return true;
+}
+
+string ShowTrace::getHeader(const string &key, const string &fallback) const {
+    auto it = mHeader.find( key );
+    return it != mHeader.end() ? it->second : fallback;
+}
+
+string ShowTrace::steer(const string &kind, const string &value){
+    // waits for the leader's value on a follower, so outside the lock
+    string steered = mSync ? mSync->steer( kind, value ) : value;
+    
+    std::lock_guard<std::mutex> lock( mMutex );
+    if( mMode == REPLAY ){
+        auto it = mRecorded.find( kind );
+        if( it != mRecorded.end() && ! it->second.empty() ){
+            string recorded = it->second.front();
+            it->second.pop_front();
+            return recorded;
+        }
+    } else if( mMode == RECORD ){
+        write( kind, steered );
+    }
+    return steered;
+}
+
+void ShowTrace::write(const string &kind, const string &value){
+    // flushed per event, so the trace leading up to a crash survives it
+    mFile << boost::format( "%.3f" ) % showTime() << "\t" << kind << "\t" << value << endl;
+    if( mFile.tellp() > MAX_BYTES ){
+        mFile.close();
+        mMode = OFF;
+        console() << "Stopped recording the show trace at " << MAX_BYTES / ( 1024 * 1024 ) << " MB" << endl;
+    }
+}
+
+int ShowTrace::steer(const string &kind, int value){
+    string recorded = steer( kind, toString( value ) );
+    try {
+        return stoi( recorded );
+    } catch( std::exception &e ) {
+        console() << "Bad " << kind << " in the show trace: " << recorded << endl;
+        return value;
+    }
+}
+
+float ShowTrace::steer(const string &kind, float value){
+    // enough digits that the replayed float is the recorded one
+    string recorded = steer( kind, ( boost::format( "%.9g" ) % value ).str() );
+    try {
+        return stof( recorded );
+    } catch( std::exception &e ) {
+        console() << "Bad " << kind << " in the show trace: " << recorded << endl;
+        return value;
+    }
+}
+
+double ShowTrace::steer(const string &kind, double value){
+    string recorded = steer( kind, ( boost::format( "%.6f" ) % value ).str() );
+    try {
+        return stod( recorded );
+    } catch( std::exception &e ) {
+        console() << "Bad " << kind << " in the show trace: " << recorded << endl;
+        return value;
+    }
+}
+
+string ShowTrace::peek(const string &kind, const string &fallback) const {
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        if( mMode == REPLAY ){
+            auto it = mRecorded.find( kind );
+            return it != mRecorded.end() && ! it->second.empty() ? it->second.front() : fallback;
+        }
+    }
+    return mSync ? mSync->peek( kind, fallback ) : fallback;
+}
+
+void ShowTrace::note(const string &kind, const string &value){
+    std::lock_guard<std::mutex> lock( mMutex );
+    if( mMode == RECORD ) write( kind, value );
+}
+
+bool ShowTrace::isReplayed(const string &kind) const {
+    std::lock_guard<std::mutex> lock( mMutex );
+    if( mMode != REPLAY ) return false;
+    auto it = mRecorded.find( kind );
+    return it == mRecorded.end() || it->second.empty();
+}
+
+#pragma mark Watchdog
+
+// Notices when the main thread hasn't finished a frame for a while, and
+// writes a report with a few stack samples of every watched thread to the
+// logs folder, along with what the show was doing. The watchdog samples a
+// thread from its own thread: it suspends it, walks its frame pointers from
+// the registers Mach hands back, resumes it and then symbolizes the return
+// addresses. A report gets a last line once frames resume.
+
+class Watchdog {
+public:
+    Watchdog();
+    ~Watchdog();
+    
+    void start(double threshold, const fs::path &dir);
+    void stop();
+    
+    // from the thread itself, for as long as it should be sampled
+    void watch(const string &name);
+    void unwatch();
+    
+    // from the main thread once per frame, and as the show moves on
+    void frame();
+    void setStatus(const string &status);
+    
+private:
+    static const int SAMPLES = 5;
+    static const int MAX_FRAMES = 64;
+    
+    void run();
+    vector<string> sample(pthread_t thread);
+    void report(double stalled);
+    
+    std::shared_ptr<std::thread> mThread;
+    std::atomic<bool>           mShouldQuit;
+    double                      mThreshold;
+    fs::path                    mDir, mReport;
+    std::atomic<double>         mLastFrame;
+    std::mutex                  mMutex;     // held while sampling, so watched threads outlive it
+    map<pthread_t, string>      mThreads;
+    string                      mStatus;
+};
+
+Watchdog::Watchdog()
+: mShouldQuit( false ), mThreshold( 2 ), mLastFrame( 0 )
+{
+}
+
+Watchdog::~Watchdog(){
+    stop();
+}
+
+void Watchdog::start(double threshold, const fs::path &dir){
+    mThreshold = threshold;
+    mDir = dir;
+    mLastFrame = getElapsedSeconds();
+    
+    mShouldQuit = false;
+    mThread = make_shared<std::thread>( &Watchdog::run, this );
+}
+
+void Watchdog::stop(){
+    mShouldQuit = true;
+    if( mThread ){
+        mThread->join();
+        mThread.reset();
+    }
+}
+
+void Watchdog::watch(const string &name){
+    std::lock_guard<std::mutex> lock( mMutex );
+    mThreads[pthread_self()] = name;
+}
+
+void Watchdog::unwatch(){
+    std::lock_guard<std::mutex> lock( mMutex );
+    mThreads.erase( pthread_self() );
+}
+
+void Watchdog::frame(){
+    mLastFrame = getElapsedSeconds();
+}
+
+void Watchdog::setStatus(const string &status){
+    std::lock_guard<std::mutex> lock( mMutex );
+    mStatus = status;
+}
+
+vector<string> Watchdog::sample(pthread_t thread){
+    vector<string> lines;
+    thread_act_t machThread = pthread_mach_thread_np( thread );
+    if( thread_suspend( machThread ) != KERN_SUCCESS ) return lines;
+    
+    void *frames[MAX_FRAMES];
+    int count = 0;
+    uintptr_t pc = 0, fp = 0;
+#if defined( __x86_64__ )
+    x86_thread_state64_t state;
+    mach_msg_type_number_t stateCount = x86_THREAD_STATE64_COUNT;
+    if( thread_get_state( machThread, x86_THREAD_STATE64, (thread_state_t)&state, &stateCount ) == KERN_SUCCESS ){
+        pc = state.__rip;
+        fp = state.__rbp;
+    }
+#elif defined( __arm64__ )
+    arm_thread_state64_t state;
+    mach_msg_type_number_t stateCount = ARM_THREAD_STATE64_COUNT;
+    if( thread_get_state( machThread, ARM_THREAD_STATE64, (thread_state_t)&state, &stateCount ) == KERN_SUCCESS ){
+        pc = arm_thread_state64_get_pc( state );
+        fp = arm_thread_state64_get_fp( state );
+    }
+#endif
+    if( pc ) frames[count++] = (void*)pc;
+    // each frame starts with the caller's frame pointer and the return
+    // address; read through vm_read_overwrite so a bad pointer can't fault
+    while( fp && count < MAX_FRAMES ){
+        uintptr_t frame[2];
+        vm_size_t read = 0;
+        if( vm_read_overwrite( mach_task_self(), fp, sizeof(frame), (vm_address_t)frame, &read ) != KERN_SUCCESS || read != sizeof(frame) ) break;
+        if( ! frame[1] ) break;
+        frames[count++] = (void*)frame[1];
+        // the stack grows down, so callers' frames are higher up
+        if( frame[0] <= fp ) break;
+        fp = frame[0];
+    }
+    
+    // symbolizing takes locks the suspended thread may hold, so after resuming
+    thread_resume( machThread );
+    
+    char **symbols = backtrace_symbols( frames, count );
+    for(int i = 0; symbols && i < count; i++){
+        lines.push_back( symbols[i] );
+    }
+    free( symbols );
+    return lines;
+}
+
+void Watchdog::report(double stalled){
+    time_t now = time( NULL );
+    char stamp[64];
+    strftime( stamp, sizeof(stamp), "stall %Y-%m-%d %H.%M.%S.txt", localtime( &now ) );
+    mReport = mDir / stamp;
+    std::ofstream file( mReport.string() );
+    
+    std::unique_lock<std::mutex> lock( mMutex );
+    file << "No frame for " << boost::format( "%.1f" ) % stalled << "s, during: " << mStatus << endl;
+    lock.unlock();
+    
+    for(int i = 0; i < SAMPLES && ! mShouldQuit; i++){
+        if( i > 0 ) std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+        lock.lock();
+        for(const auto &thread : mThreads){
+            file << endl << "sample " << i + 1 << " of " << thread.second << " at +" << boost::format( "%.1f" ) % ( getElapsedSeconds() - mLastFrame ) << "s" << endl;
+            for(const string &line : sample( thread.first )){
+                file << "  " << line << endl;
+            }
+        }
+        lock.unlock();
+    }
+    console() << "Stalled for " << stalled << "s, report at: " << mReport << endl;
+}
+
+void Watchdog::run(){
+    
+    double stalledFrom = -1;
+    while( ! mShouldQuit ){
+        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+        
+        double lastFrame = mLastFrame;
+        double since = getElapsedSeconds() - lastFrame;
+        if( stalledFrom < 0 && since > mThreshold ){
+            stalledFrom = lastFrame;
+            report( since );
+        } else if( stalledFrom >= 0 && lastFrame != stalledFrom ){
+            std::ofstream( mReport.string(), std::ios::app ) << endl << boost::format( "Frames resumed after %.1fs" ) % ( lastFrame - stalledFrom ) << endl;
+            stalledFrom = -1;
+        }
+    }
+}
+
+#pragma mark MetricsServer
+
+// Serves the app's metrics to monitoring over HTTP on a loopback port, in
+// the Prometheus text format. The main thread publishes a fresh text now
+// and then; the server thread only ever hands out the last one, so a slow
+// scraper never holds up a frame.
+
+class MetricsServer {
+public:
+    MetricsServer();
+    ~MetricsServer();
+    
+    bool start(int port);
+    void stop();
+    
+    void publish(const string &text);
+    
+private:
+    void run();
+    void respond(int client);
+    
+    int                             mSocket;
+    std::shared_ptr<std::thread>    mThread;
+    std::atomic<bool>               mShouldQuit;
+    std::mutex                      mMutex;
+    string                          mText;
+};
+
+// Builds the text for MetricsServer, one metric family at a time.
+class MetricsText {
+public:
+    MetricsText() { mText.precision( 12 ); }
+    
+    MetricsText& family(const string &name, const string &type, const string &help){
+        mText << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+        return *this;
+    }
+    MetricsText& sample(const string &name, double value, const string &labels=""){
+        mText << name;
+        if( ! labels.empty() ) mText << "{" << labels << "}";
+        mText << " " << value << "\n";
+        return *this;
+    }
+    string str() const { return mText.str(); }
+    
+private:
+    std::ostringstream mText;
+};
+
+MetricsServer::MetricsServer()
+: mSocket( -1 ), mShouldQuit( false )
+{
+}
+
+MetricsServer::~MetricsServer(){
+    stop();
+}
+
+bool MetricsServer::start(int port){
+    mSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    if( mSocket < 0 ){
+        console() << "Unable to serve metrics: " << strerror( errno ) << endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt( mSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse) );
+    
+    // loopback only, the displays aren't meant to be reachable from outside
+    struct sockaddr_in address;
+    memset( &address, 0, sizeof(address) );
+    address.sin_family = AF_INET;
+    address.sin_port = htons( port );
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    
+    if( ::bind( mSocket, (struct sockaddr*)&address, sizeof(address) ) < 0 || listen( mSocket, 4 ) < 0 ){
+        console() << "Unable to serve metrics on port " << port << ": " << strerror( errno ) << endl;
+        close( mSocket );
+        mSocket = -1;
+        return false;
+    }
+    
+    mShouldQuit = false;
+    mThread = make_shared<std::thread>( &MetricsServer::run, this );
+    console() << "Serving metrics at http://127.0.0.1:" << port << "/metrics" << endl;
+    return true;
+}
+
+void MetricsServer::stop(){
+    mShouldQuit = true;
+    if( mThread ){
+        mThread->join();
+        mThread.reset();
+    }
+    if( mSocket >= 0 ){
+        close( mSocket );
+        mSocket = -1;
+    }
+}
+
+void MetricsServer::publish(const string &text){
+    std::lock_guard<std::mutex> lock( mMutex );
+    mText = text;
+}
+
+void MetricsServer::run(){
+    while( ! mShouldQuit ){
+        // wakes up now and then to notice stop()
+        struct pollfd ready = { mSocket, POLLIN, 0 };
+        if( poll( &ready, 1, 250 ) <= 0 ) continue;
+        
+        int client = accept( mSocket, NULL, NULL );
+        if( client < 0 ) continue;
+        
+        // a scraper that stops reading mustn't hang the server
+        struct timeval timeout = { 1, 0 };
+        setsockopt( client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout) );
+        setsockopt( client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout) );
+#ifdef SO_NOSIGPIPE
+        int noSignal = 1;
+        setsockopt( client, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal) );
+#endif
+        
+        respond( client );
+        close( client );
+    }
+}
+
+void MetricsServer::respond(int client){
+    char request[2048];
+    ssize_t length = recv( client, request, sizeof(request) - 1, 0 );
+    if( length <= 0 ) return;
+    request[length] = 0;
+    
+    string status = "200 OK", body;
+    if( strncmp( request, "GET /metrics", 12 ) == 0 || strncmp( request, "GET / ", 6 ) == 0 ){
+        std::lock_guard<std::mutex> lock( mMutex );
+        body = mText;
+    } else {
+        status = "404 Not Found";
+        body = "try /metrics\n";
+    }
+    
+    string response = "HTTP/1.0 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + toString( body.size() ) + "\r\nConnection: close\r\n\r\n" + body;
+    for(size_t sent = 0; sent < response.size(); ){
+        ssize_t n = send( client, response.data() + sent, response.size() - sent, 0 );
+        if( n <= 0 ) return;
+        sent += n;
+    }
+}
+
+#pragma mark SharedSurfaceCache
+
+// Decoded slides shared between the display instances on one machine. The
+// pixels of every entry live in their own POSIX shared memory object, which
+// other instances map read-only instead of decoding the image again. The
+// index is one more shared object holding a fixed table of entries, claimed
+// and released with atomic operations only, so an instance that dies never
+// leaves a lock behind.
+//
+// Every instance holds a slot in the index with its pid and counts its own
+// references to each entry. Entries nobody references are evicted oldest
+// first once the cache outgrows its budget, and the references and half
+// written entries of instances that are gone are cleared on the way.
+
+class SharedSurfaceCache {
+public:
+    SharedSurfaceCache();
+    ~SharedSurfaceCache();
+    
+    bool open(size_t budgetBytes);
+    void close();
+    bool isOpen() const { return mIndex != nullptr; }
+    
+    // a key for an image file as decoded at a scale
+    static uint64_t makeKey(const fs::path &path, float scale);
+    
+    // the shared surface, mapped in place, or null when no instance decoded it yet
+    SurfaceRef find(uint64_t key);
+    // copies the surface into the cache and returns the shared copy, or
+    // the surface itself when it can't be cached
+    SurfaceRef insert(uint64_t key, const SurfaceRef &surface);
+    
+private:
+    static const int        MAX_INSTANCES = 8;
+    static const int        ENTRIES = 512;
+    static const uint32_t   MAGIC = 0x41445343; // ADSC
+    
+    enum State : uint32_t { FREE, WRITING, READY, EVICTING };
+    
+    struct Entry {
+        std::atomic<uint64_t>   mKey;
+        std::atomic<uint32_t>   mState;
+        std::atomic<int32_t>    mWriter;    // the instance slot filling it in
+        int32_t                 mWidth, mHeight, mRowBytes, mChannelOrder;
+        uint64_t                mBytes;
+        std::atomic<uint64_t>   mLastUsed;
+        std::atomic<uint32_t>   mRefs[MAX_INSTANCES];
+    };
+    
+    struct Index {
+        std::atomic<uint32_t>   mMagic;
+        std::atomic<uint64_t>   mBytes;     // held by ready entries
+        std::atomic<uint64_t>   mClock;     // orders uses, for eviction
+        std::atomic<int32_t>    mInstances[MAX_INSTANCES];
+        Entry                   mEntries[ENTRIES];
+    };
+    
+    string getName(const Entry &entry) const;
+    bool isClaimed(uint64_t key, const Entry *except) const;
+    SurfaceRef map(Entry &entry, bool writable);
+    void release(Entry &entry);
+    void reap();
+    bool evict(uint64_t bytes);
+    
+    Index       *mIndex;
+    int         mSlot;
+    size_t      mBudget;
+};
+
+static const char *sSharedIndexName = "/AtriumDisplay.index";
+
+SharedSurfaceCache::SharedSurfaceCache()
+: mIndex( nullptr ), mSlot( -1 ), mBudget( 0 )
+{
+}
+
+SharedSurfaceCache::~SharedSurfaceCache(){
+    close();
+}
+
+bool SharedSurfaceCache::open(size_t budgetBytes){
+    
+    static_assert( ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "the index needs lock-free atomics" );
+    
+    mBudget = budgetBytes;
+    
+    // the first instance to arrive creates and stamps the index
+    bool created = true;
+    int fd = shm_open( sSharedIndexName, O_RDWR | O_CREAT | O_EXCL, 0600 );
+    if( fd < 0 && errno == EEXIST ){
+        created = false;
+        fd = shm_open( sSharedIndexName, O_RDWR, 0600 );
+    }
+    if( fd < 0 || ( created && ftruncate( fd, sizeof(Index) ) < 0 ) ){
+        console() << "Unable to open the shared surface cache: " << strerror( errno ) << endl;
+        if( fd >= 0 ) ::close( fd );
+        return false;
+    }
+    
+    void *memory = mmap( nullptr, sizeof(Index), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if( memory == MAP_FAILED ){
+        console() << "Unable to map the shared surface cache: " << strerror( errno ) << endl;
+        return false;
+    }
+    // zero filled by ftruncate, which is a valid state for every atomic in it
+    mIndex = static_cast<Index*>( memory );
+    if( created ){
+        mIndex->mMagic = MAGIC;
+    } else {
+        for(int i = 0; i < 1000 && mIndex->mMagic != MAGIC; i++){
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+    }
+    if( mIndex->mMagic != MAGIC ){
+        console() << "The shared surface cache is from another version, not using it" << endl;
+        close();
+        return false;
+    }
+    
+    reap();
+    int32_t pid = getpid();
+    for(int i = 0; i < MAX_INSTANCES && mSlot < 0; i++){
+        int32_t vacant = 0;
+        if( mIndex->mInstances[i].compare_exchange_strong( vacant, pid ) ) mSlot = i;
+    }
+    if( mSlot < 0 ){
+        console() << "The shared surface cache has no room for another instance" << endl;
+        close();
+        return false;
+    }
+    
+    console() << "Shared surface cache as instance " << mSlot << ", " << mIndex->mBytes / 1048576 << " MB shared" << endl;
+    return true;
+}
+
+void SharedSurfaceCache::close(){
+    if( ! mIndex ) return;
+    if( mSlot >= 0 ){
+        // surfaces still mapped keep their pixels, but no longer the entries
+        for(Entry &entry : mIndex->mEntries) entry.mRefs[mSlot] = 0;
+        mIndex->mInstances[mSlot] = 0;
+        mSlot = -1;
+    }
+    munmap( mIndex, sizeof(Index) );
+    mIndex = nullptr;
+}
+
+uint64_t SharedSurfaceCache::makeKey(const fs::path &path, float scale){
+    // FNV-1a over everything that changes the decoded pixels
+    boost::system::error_code error;
+    string id = ( boost::format( "%s|%d|%d|%.3f" ) % path.string() % fs::file_size( path, error ) % fs::last_write_time( path, error ) % scale ).str();
+    uint64_t hash = 14695981039346656037ULL;
+    for(unsigned char c : id){
+        hash = ( hash ^ c ) * 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+string SharedSurfaceCache::getName(const Entry &entry) const {
+    // one object per entry, so an eviction only ever unlinks its own; shared
+    // memory names are limited to 31 characters on macOS
+    return ( boost::format( "/AtriumDisp.%03x.%016x" ) % ( &entry - mIndex->mEntries ) % entry.mKey ).str();
+}
+
+// True when another entry is being written or holds the key.
+bool SharedSurfaceCache::isClaimed(uint64_t key, const Entry *except) const {
+    for(const Entry &entry : mIndex->mEntries){
+        if( &entry == except || entry.mKey != key ) continue;
+        uint32_t state = entry.mState;
+        if( ( state == WRITING || state == READY ) && entry.mKey == key ) return true;
+    }
+    return false;
+}
+
+SurfaceRef SharedSurfaceCache::map(Entry &entry, bool writable){
+    string name = getName( entry );
+    int fd = shm_open( name.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0600 );
+    if( fd < 0 ) return SurfaceRef();
+    if( writable && ftruncate( fd, entry.mBytes ) < 0 ){
+        ::close( fd );
+        return SurfaceRef();
+    }
+    void *pixels = mmap( nullptr, entry.mBytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if( pixels == MAP_FAILED ) return SurfaceRef();
+    
+    // the surface borrows the mapping, which goes with the last reference to it
+    size_t bytes = entry.mBytes;
+    Entry *held = &entry;
+    Surface8u *surface = new Surface8u( static_cast<uint8_t*>( pixels ), entry.mWidth, entry.mHeight, entry.mRowBytes, SurfaceChannelOrder( entry.mChannelOrder ) );
+    return SurfaceRef( surface, [this, held, pixels, bytes]( Surface8u *surface ){
+        delete surface;
+        munmap( pixels, bytes );
+        release( *held );
+    } );
+}
+
+void SharedSurfaceCache::release(Entry &entry){
+    if( mIndex && mSlot >= 0 ) entry.mRefs[mSlot]--;
+}
+
+SurfaceRef SharedSurfaceCache::find(uint64_t key){
+    if( ! mIndex ) return SurfaceRef();
+    
+    for(Entry &entry : mIndex->mEntries){
+        if( entry.mKey != key ) continue;
+        
+        // referenced before checking it's ready, which an eviction checks the other way round
+        entry.mRefs[mSlot]++;
+        if( entry.mState != READY || entry.mKey != key ){
+            entry.mRefs[mSlot]--;
+            return SurfaceRef();
+        }
+        entry.mLastUsed = ++mIndex->mClock;
+        SurfaceRef surface = map( entry, false );
+        if( ! surface ) entry.mRefs[mSlot]--;
+        return surface;
+    }
+    return SurfaceRef();
+}
+
+SurfaceRef SharedSurfaceCache::insert(uint64_t key, const SurfaceRef &surface){
+    if( ! mIndex || ! surface ) return surface;
+    
+    // another instance may have been quicker, or be decoding it right now
+    SurfaceRef existing = find( key );
+    if( existing || isClaimed( key, nullptr ) ) return existing ? existing : surface;
+    
+    uint64_t bytes = (uint64_t)surface->getRowBytes() * surface->getHeight();
+    if( bytes > mBudget ) return surface;
+    reap();
+    if( mIndex->mBytes + bytes > mBudget && ! evict( mIndex->mBytes + bytes - mBudget ) ) return surface;
+    
+    // claim a free entry, then the key: both claimants publish the key before
+    // looking for the other, so two instances decoding the same image at the
+    // same time can't both keep it, at worst both let it go
+    for(Entry &entry : mIndex->mEntries){
+        uint32_t vacant = FREE;
+        if( ! entry.mState.compare_exchange_strong( vacant, WRITING ) ) continue;
+        
+        entry.mWriter = mSlot;
+        entry.mKey = key;
+        if( isClaimed( key, &entry ) ){
+            entry.mKey = 0;
+            entry.mState = FREE;
+            return surface;
+        }
+        entry.mWidth = surface->getWidth();
+        entry.mHeight = surface->getHeight();
+        entry.mRowBytes = surface->getRowBytes();
+        entry.mChannelOrder = surface->getChannelOrder().getCode();
+        entry.mBytes = bytes;
+        
+        SurfaceRef shared = map( entry, true );
+        if( ! shared ){
+            shm_unlink( getName( entry ).c_str() );
+            entry.mKey = 0;
+            entry.mState = FREE;
+            return surface;
+        }
+        entry.mRefs[mSlot]++;
+        memcpy( shared->getData(), surface->getData(), bytes );
+        
+        entry.mLastUsed = ++mIndex->mClock;
+        mIndex->mBytes += bytes;
+        entry.mState = READY;
+        return shared;
+    }
+    return surface;
+}
+
+// Frees what instances that are gone left behind.
+void SharedSurfaceCache::reap(){
+    for(int i = 0; i < MAX_INSTANCES; i++){
+        int32_t pid = mIndex->mInstances[i];
+        if( pid == 0 || i == mSlot || kill( pid, 0 ) == 0 || errno != ESRCH ) continue;
+        if( ! mIndex->mInstances[i].compare_exchange_strong( pid, 0 ) ) continue;
+        
+        for(Entry &entry : mIndex->mEntries){
+            entry.mRefs[i] = 0;
+            uint32_t writing = WRITING;
+            if( entry.mWriter == i && entry.mState.compare_exchange_strong( writing, EVICTING ) ){
+                shm_unlink( getName( entry ).c_str() );
+                entry.mKey = 0;
+                entry.mState = FREE;
+            }
+        }
+    }
+}
+
+// Evicts unreferenced entries, least recently used first, until enough
+// bytes are free. False when too much of the cache is in use.
+bool SharedSurfaceCache::evict(uint64_t bytes){
+    uint64_t freed = 0;
+    while( freed < bytes ){
+        Entry *oldest = nullptr;
+        for(Entry &entry : mIndex->mEntries){
+            if( entry.mState != READY ) continue;
+            uint32_t refs = 0;
+            for(int i = 0; i < MAX_INSTANCES; i++) refs += entry.mRefs[i];
+            if( refs == 0 && ( ! oldest || entry.mLastUsed < oldest->mLastUsed ) ) oldest = &entry;
+        }
+        if( ! oldest ) return false;
+        
+        uint32_t ready = READY;
+        if( ! oldest->mState.compare_exchange_strong( ready, EVICTING ) ) continue;
+        uint32_t refs = 0;
+        for(int i = 0; i < MAX_INSTANCES; i++) refs += oldest->mRefs[i];
+        if( refs > 0 ){
+            // found in the meantime
+            oldest->mState = READY;
+            continue;
+        }
+        shm_unlink( getName( *oldest ).c_str() );
+        mIndex->mBytes -= oldest->mBytes;
+        freed += oldest->mBytes;
+        oldest->mKey = 0;
+        oldest->mState = FREE;
+    }
+    return true;
+}
+
+#pragma mark CachedTextureFont
+
+// A texture font whose glyph atlas is kept on disk once it has been
+// rasterized, keyed by a hash of the font resource, its size and the canvas
+// height. A restarted display maps the file once and uploads the pages as
+// they are, rather than rendering every glyph again.
+//
+//   "ATRFONT1", uint32 glyphs, uint32 pages,
+//   glyphs x ( uint16 glyph, uint16 page, int32 clip area[4], float origin offset[2] ),
+//   pages x ( int32 width, height, uint32 internal format, data format,
+//             int32 swizzle mask[4], uint64 bytes, the pixels )
+
+class CachedTextureFont : public gl::TextureFont {
+public:
+    static gl::TextureFontRef create(const DataSourceRef &resource, float size, int canvasHeight, const Format &format = Format());
+    
+private:
+    CachedTextureFont(const Font &font, const string &chars, const Format &format);
+    
+    bool load(const fs::path &path);
+    void save(const fs::path &path) const;
+};
+
+static const char sFontMagic[8] = { 'A', 'T', 'R', 'F', 'O', 'N', 'T', '1' };
+
+CachedTextureFont::CachedTextureFont(const Font &font, const string &chars, const Format &format)
+: gl::TextureFont( font, chars, format )
+{
+}
+
+gl::TextureFontRef CachedTextureFont::create(const DataSourceRef &resource, float size, int canvasHeight, const Format &format){
+    // FNV-1a over the font file and everything that changes the atlas
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash]( const void *data, size_t bytes ){
+        for(size_t i = 0; i < bytes; i++){
+            hash = ( hash ^ static_cast<const uint8_t*>( data )[i] ) * 1099511628211ULL;
         }
-    }
+    };
+    BufferRef buffer = resource->getBuffer();
+    mix( buffer->getData(), buffer->getSize() );
+    string id = ( boost::format( "%.3f|%d|%d|%dx%d|%s" ) % size % canvasHeight % format.hasMipmapping()
+                 % format.getTextureWidth() % format.getTextureHeight() % defaultChars() ).str();
+    mix( id.data(), id.size() );
+    fs::path path = getCachePath() / "fonts" / ( boost::format( "%016x.atlas" ) % hash ).str();
     
-    if(projectYaml["title"]){
-        mTitle = projectYaml["title"].as<std::string>();
-    }
+    Font font( resource, size );
     
-    if(projectYaml["abstract"]){
-        mAbstract = projectYaml["abstract"].as<std::string>();
-    }
+    // no glyphs are rendered for an atlas that is read from the cache
+    std::shared_ptr<CachedTextureFont> cached( new CachedTextureFont( font, "", format ) );
+    if( cached->load( path ) ) return cached;
     
-    if(projectYaml["summary"]){
-        mSummary = projectYaml["summary"].as<std::string>();
+    std::shared_ptr<CachedTextureFont> rendered( new CachedTextureFont( font, defaultChars(), format ) );
+    try {
+        rendered->save( path );
+    } catch( std::exception &e ) {
+        console() << "Unable to cache the font atlas " << path << ": " << e.what() << endl;
     }
+    return rendered;
+}
+
+bool CachedTextureFont::load(const fs::path &path){
+    int fd = ::open( path.c_str(), O_RDONLY );
+    if( fd < 0 ) return false;
+    struct stat info;
+    void *data = fstat( fd, &info ) == 0 && info.st_size > 0 ? mmap( nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 ) : MAP_FAILED;
+    ::close( fd );
+    if( data == MAP_FAILED ) return false;
     
-    if(projectYaml["participants"]){
-        mParticipants.clear();
-        YAML::Node n = projectYaml["participants"];
-        for(YAML::const_iterator it=n.begin();it!=n.end();++it)
-            mParticipants.push_back((*it)["name"].as<std::string>());
+    // every field is checked against the size, a truncated file is rendered again
+    const uint8_t *bytes = static_cast<const uint8_t*>( data );
+    size_t pos = 0, end = info.st_size;
+    auto read = [bytes, end, &pos]( void *to, size_t size ){
+        if( pos + size > end ) return false;
+        memcpy( to, bytes + pos, size );
+        pos += size;
+        return true;
+    };
+    char magic[8];
+    uint32_t glyphs = 0, pages = 0;
+    bool valid = read( magic, sizeof(magic) ) && memcmp( magic, sFontMagic, sizeof(magic) ) == 0
+        && read( &glyphs, sizeof(glyphs) ) && read( &pages, sizeof(pages) );
+    for(uint32_t i = 0; valid && i < glyphs; i++){
+        uint16_t glyph = 0, page = 0;
+        int32_t area[4];
+        float offset[2];
+        valid = read( &glyph, sizeof(glyph) ) && read( &page, sizeof(page) ) && read( area, sizeof(area) ) && read( offset, sizeof(offset) ) && page < pages;
+        if( valid ){
+            GlyphInfo &glyphInfo = mGlyphMap[glyph];
+            glyphInfo.mTextureIndex = page;
+            glyphInfo.mClipArea = Area( area[0], area[1], area[2], area[3] );
+            glyphInfo.mOriginOffset = vec2( offset[0], offset[1] );
+        }
     }
-    
-    if(projectYaml["credits"]){
-        mCredits.clear();
-        YAML::Node n = projectYaml["credits"];
-        for(YAML::const_iterator it=n.begin();it!=n.end();++it)
-            mCredits.push_back((*it)["name"].as<std::string>());
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    for(uint32_t i = 0; valid && i < pages; i++){
+        int32_t size[2] = { 0, 0 }, swizzle[4];
+        uint32_t formats[2] = { 0, 0 };
+        uint64_t length = 0;
+        valid = read( size, sizeof(size) ) && read( formats, sizeof(formats) ) && read( swizzle, sizeof(swizzle) )
+            && read( &length, sizeof(length) ) && pos + length <= end;
+        // a page holds exactly its pixels, in one of the layouts save() writes
+        uint64_t channels = formats[1] == GL_RED ? 1 : formats[1] == GL_RG ? 2 : formats[1] == GL_RGBA ? 4 : 0;
+        valid = valid && channels > 0 && size[0] > 0 && size[1] > 0 && length == (uint64_t)size[0] * (uint64_t)size[1] * channels;
+        if( valid ){
+            gl::Texture::Format format;
+            format.setInternalFormat( formats[0] );
+            format.setSwizzleMask( swizzle[0], swizzle[1], swizzle[2], swizzle[3] );
+            format.enableMipmapping( mFormat.hasMipmapping() );
+            mTextures.push_back( gl::Texture::create( bytes + pos, formats[1], size[0], size[1], format ) );
+            pos += length;
+        }
     }
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+    munmap( data, info.st_size );
     
-    if(projectYaml["materials"]){
-        mMaterials.clear();
-        YAML::Node n = projectYaml["materials"];
-        for(YAML::const_iterator it=n.begin();it!=n.end();++it)
-            mMaterials.push_back(it->as<std::string>());
+    if( ! valid ){
+        mGlyphMap.clear();
+        mTextures.clear();
     }
+    return valid;
+}
+
+void CachedTextureFont::save(const fs::path &path) const {
+    fs::create_directories( path.parent_path() );
+    fs::path partial = path.string() + ".partial";
+    std::ofstream file( partial.string(), std::ios::binary | std::ios::trunc );
+    auto write = [&file]( const void *data, size_t bytes ){
+        file.write( static_cast<const char*>( data ), bytes );
+    };
     
-    if(projectYaml["tags"]){
-        mTags.clear();
-        YAML::Node n = projectYaml["tags"];
-        for(YAML::const_iterator it=n.begin();it!=n.end();++it)
-            mTags.push_back(it->as<std::string>());
+    uint32_t glyphs = mGlyphMap.size(), pages = mTextures.size();
+    write( sFontMagic, sizeof(sFontMagic) );
+    write( &glyphs, sizeof(glyphs) );
+    write( &pages, sizeof(pages) );
+    for(const auto &glyph : mGlyphMap){
+        uint16_t id = glyph.first, page = glyph.second.mTextureIndex;
+        const Area &clip = glyph.second.mClipArea;
+        int32_t area[4] = { clip.x1, clip.y1, clip.x2, clip.y2 };
+        float offset[2] = { glyph.second.mOriginOffset.x, glyph.second.mOriginOffset.y };
+        write( &id, sizeof(id) );
+        write( &page, sizeof(page) );
+        write( area, sizeof(area) );
+        write( offset, sizeof(offset) );
     }
     
-    if(projectYaml["published"]){
-        mPublished.clear();
-        YAML::Node n = projectYaml["published"];
-        for(YAML::const_iterator it=n.begin();it!=n.end();++it)
-            mPublished.push_back(it->as<std::string>());
+    // the pages are read back in their own channel layout, with the swizzle
+    // that makes them draw as white glyphs
+    glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+    for(const gl::TextureRef &texture : mTextures){
+        uint32_t formats[2] = { texture->getInternalFormat(), GL_RGBA };
+        size_t channels = 4;
+        if( formats[0] == GL_R8 || formats[0] == GL_RED ){
+            formats[1] = GL_RED;
+            channels = 1;
+        } else if( formats[0] == GL_RG8 || formats[0] == GL_RG ){
+            formats[1] = GL_RG;
+            channels = 2;
+        }
+        int32_t size[2] = { texture->getWidth(), texture->getHeight() };
+        std::array<GLint, 4> mask = texture->getSwizzleMask();
+        int32_t swizzle[4] = { mask[0], mask[1], mask[2], mask[3] };
+        vector<uint8_t> pixels( size[0] * size[1] * channels );
+        {
+            gl::ScopedTextureBind bind( texture );
+            glGetTexImage( texture->getTarget(), 0, formats[1], GL_UNSIGNED_BYTE, pixels.data() );
+        }
+        uint64_t length = pixels.size();
+        write( size, sizeof(size) );
+        write( formats, sizeof(formats) );
+        write( swizzle, sizeof(swizzle) );
+        write( &length, sizeof(length) );
+        write( pixels.data(), pixels.size() );
     }
+    glPixelStorei( GL_PACK_ALIGNMENT, 4 );
     
-    if(projectYaml["homepage"]){
-        try {
-            mHomepageURL = Url(projectYaml["homepage"].as<std::string>());
-        } catch (...){
-            mHomepageURL = Url();
-        }
+    file.close();
+    if( ! file ){
+        fs::remove( partial );
+        throw std::runtime_error( "write failed" );
     }
+    // readers only ever see a complete atlas
+    fs::rename( partial, path );
+}
+
+#pragma mark ConfigWatcher
+
+// Notices edits to a few files by polling their modification times on a
+// dispatch timer. File system events would be cheaper, but they miss the
+// edits that reach the resource path through the share's sync.
+
+class ConfigWatcher {
+public:
+    ConfigWatcher();
+    ~ConfigWatcher();
     
-    //std::string         mCreativeCommons;
+    // calls changedFn on the watcher's queue when any of the files changes
+    void start(const vector<fs::path> &files, double interval, const function<void()> &changedFn);
+    void setFiles(const vector<fs::path> &files);
+    void stop();
     
+private:
+    void poll();
     
+    std::mutex              mMutex;
+    vector<fs::path>        mFiles;
+    vector<std::time_t>     mTimes;
+    function<void()>        mChangedFn;
+    dispatch_queue_t        mQueue;
+    dispatch_source_t       mTimer;
+};
+
+ConfigWatcher::ConfigWatcher()
+: mQueue( nullptr ), mTimer( nullptr )
+{
 }
 
-void Project::setupResources(const fs::path &p){
-    
-    if(fs::exists(p) && fs::is_directory(p)){
-        
-        typedef vector<fs::path> paths;         // store paths,
-        paths resPaths;                         // so we can sort them later
-        
-        copy(fs::directory_iterator(p), fs::directory_iterator(), back_inserter(resPaths));
-        
-        sort(resPaths.begin(), resPaths.end()); // sort, since directory iteration
-        // is not ordered on some file systems
-        
-        reverse(resPaths.begin(), resPaths.end());
-        
-        for (paths::const_iterator resIt (resPaths.begin()); resIt != resPaths.end(); ++resIt)
-        {
-            
-            if(boost::iequals(resIt->extension().string(), ".pdf") ){
-                // pdf files
-            }
-            
-            if(boost::iequals(resIt->extension().string(), ".mov") ||
-               boost::iequals(resIt->extension().string(), ".mp4") ||
-               boost::iequals(resIt->extension().string(), ".m4v") ||
-               boost::iequals(resIt->extension().string(), ".avi") ){
-                // movie files
-                mResources.push_back(*resIt);
-                mMovies.push_back(*resIt);
-            }
-            
-            if(boost::iequals(resIt->extension().string(), ".jpg") ||
-               boost::iequals(resIt->extension().string(), ".png") ||
-               boost::iequals(resIt->extension().string(), ".gif") ||
-               boost::iequals(resIt->extension().string(), ".jpeg") ){
-                //image files
-                mResources.push_back(*resIt);
-                mImages.push_back(*resIt);
-            }
-        }
+ConfigWatcher::~ConfigWatcher(){
+    stop();
+}
+
+void ConfigWatcher::start(const vector<fs::path> &files, double interval, const function<void()> &changedFn){
+    stop();
+    setFiles( files );
+    mChangedFn = changedFn;
+    mQueue = dispatch_queue_create( "AtriumDisplay.config", DISPATCH_QUEUE_SERIAL );
+    mTimer = dispatch_source_create( DISPATCH_SOURCE_TYPE_TIMER, 0, 0, mQueue );
+    dispatch_source_set_timer( mTimer, dispatch_time( DISPATCH_TIME_NOW, interval * NSEC_PER_SEC ), interval * NSEC_PER_SEC, NSEC_PER_SEC / 10 );
+    dispatch_source_set_event_handler( mTimer, ^{ poll(); } );
+    dispatch_resume( mTimer );
+}
+
+void ConfigWatcher::setFiles(const vector<fs::path> &files){
+    std::lock_guard<std::mutex> lock( mMutex );
+    mFiles = files;
+    mTimes.clear();
+    for(const fs::path &file : mFiles){
+        boost::system::error_code error;
+        std::time_t time = fs::last_write_time( file, error );
+        mTimes.push_back( error ? 0 : time );
     }
-    
 }
 
+void ConfigWatcher::stop(){
+    if( ! mTimer ) return;
+    dispatch_source_cancel( mTimer );
+    // waits for a poll that is under way
+    dispatch_sync( mQueue, ^{} );
+    dispatch_release( mTimer );
+    dispatch_release( mQueue );
+    mTimer = nullptr;
+    mQueue = nullptr;
+}
+
+void ConfigWatcher::poll(){
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        for(size_t i = 0; i < mFiles.size(); i++){
+            // a file being replaced has no time for a moment, that is a change too
+            boost::system::error_code error;
+            std::time_t time = fs::last_write_time( mFiles[i], error );
+            if( error ) time = 0;
+            changed = changed || time != mTimes[i];
+            mTimes[i] = time;
+        }
+    }
+    if( changed ) mChangedFn();
+}
 
 #pragma mark AtriumDisplayApp
 
@@ -338,19 +5495,79 @@ public:
     void mouseDown( MouseEvent event );
     void update();
     void draw();
+    void keyDown( KeyEvent event );
+    int32_t setupBenchmark(const vector<string> &args);
+    void endBenchmarkFrame();
+    void finishBenchmark();
+    int32_t setupReplay();
+    void finishReplay();
+    void setupTitleFonts(float scale);
+    void governQuality(bool busy);
+    void publishMetrics();
+    
+    // the size the show is laid out for, the window's except in the benchmark
+    ivec2 getCanvasSize() const { return mCanvasSize; }
+    int getCanvasWidth() const { return mCanvasSize.x; }
+    int getCanvasHeight() const { return mCanvasSize.y; }
+    Area getCanvasBounds() const { return Area( ivec2( 0 ), mCanvasSize ); }
+    void drawProfile();
+    void logProfile();
+    void drawScene(const Rectf &clip);
+    void setupLayers();
     void loadNextProject();
+    void renderProjectHeader();
+    void scheduleTransition(float delay);
+    void setupShow();
+    void updateMediaDeadline();
+    bool isMovieDue() const;
+    void refreshCalendar();
+    void throttleFrameRate(bool idle);
     void shutdown();
     
     bool readConfig();
+    deque<Project*> scanProjects(const fs::path &dir);
+    void setTaglines(const YAML::Node &taglines);
+    
+    // config.yaml and lab.yaml as read again after an edit, on the watcher's
+    // queue, to be applied when the next show cycle begins
+    struct PendingConfig {
+        ~PendingConfig() { for(Project *project : mProjects) delete project; }
+        
+        YAML::Node          mConfig, mLab;
+        bool                mHasLab;
+        float               mFrameRate, mIdleFrameRate;
+        double              mProfileLogInterval;
+        fs::path            mResourcePath;
+        bool                mScanned;       // the resource path is new, its projects are in mProjects
+        deque<Project*>     mProjects;
+    };
+    void reloadConfig();
+    void applyConfig();
     
     void loadImagesThreadFn();
     
-    ConcurrentCircularBuffer<SurfaceRef>	*mSurfaces;
+    // a decoded slide, and the clip it starts when it is an animated GIF
+    struct Slide {
+        SurfaceRef  mSurface;
+        GifClipRef  mClip;
+    };
+    ConcurrentCircularBuffer<Slide>	*mSurfaces;
     
     deque<Project*>        mProjects;
     
     void loadMovieFile( const fs::path &path );
     
+    void drawProjectDetails(float alpha);
+    void drawPanels(float alpha);
+    void drawStripes(float alpha);
+    void drawProjectTitle(float alpha);
+    void drawMovie(float alpha);
+    void drawTaglines(float alpha);
+    void drawSchedule(float alpha);
+    void drawLogo(float alpha);
+    void drawLabTitle(float alpha);
+    void drawBorders(float alpha);
+    
     qtime::MovieGlRef		mMovie;
     gl::TextureRef			mMovieFrameTexture, mMovieInfoTexture;
     JsonTree                mMovieSubtitles;
@@ -361,6 +5578,56 @@ public:
     Project                 *mCurrentProject;
     
     gl::TextureRef	mTitleTexture, mHeaderTexture, mProjectTexture, mLogoTexture;
+    vec2                    mHeaderMeasure;
+    
+    LayerRef                mRootLayer;
+    LayerRef                mProjectDetailsLayer, mProjectTitleLayer, mTaglinesLayer, mScheduleLayer;
+    DirtyRegions            mDirtyRegions;
+    gl::FboRef              mSceneFbo;
+    std::atomic<bool>       mCalendarChanged;
+    bool                    mShowProfile;
+    ivec2                   mCanvasSize;
+    
+    // decoded slides shared with other instances, see SharedSurfaceCache
+    SharedSurfaceCache      mSharedCache;
+    std::atomic<uint64_t>   mSharedCacheHits, mSharedCacheMisses;
+    
+    // for monitoring, see MetricsServer
+    MetricsServer           mMetrics;
+    double                  mNextMetrics;
+    std::atomic<double>     mCalendarFetched;
+    
+    // reports frames that don't come, see Watchdog
+    Watchdog                mWatchdog;
+    
+    // steps features down on slow displays, see QualityGovernor
+    QualityGovernor         mQuality;
+    bool                    mGovernQuality;
+    double                  mLastFrameTime;
+    bool                    mLastFrameBusy;
+    std::atomic<float>      mTextureScale;
+    float                   mTextScale;
+    
+    // a trace of the show, recorded in the field or replayed, see ShowTrace
+    ShowTrace               mTrace;
+    ShowSync                mSync;
+    int32_t                 mNoiseSeed;
+    bool                    mVirtualClock;
+    
+    // headless benchmark, see setupBenchmark()
+    bool                    mBenchmark;
+    int32_t                 mBenchmarkSeed;
+    int                     mBenchmarkCycles, mBenchmarkCyclesDone;
+    fs::path                mBenchmarkFixtures, mBenchmarkReport;
+    vector<double>          mBenchmarkFrameTimes;
+    vector<vector<int64_t>> mBenchmarkMemory;
+    bool                    mBenchmarkLeakCheck;
+    std::chrono::high_resolution_clock::time_point mBenchmarkFrameStart;
+    std::mutex              mDecodeTimesMutex;
+    vector<double>          mDecodeTimes;
+    double                  mProfileLogInterval;
+    double                  mNextProfileLog;
+    bool                    mIsDecember;
     
     gl::TextureFontRef      mTitleFontPrimary;
     gl::TextureFontRef      mTitleFontSecondary;
@@ -377,6 +5644,8 @@ public:
     bool					mShouldQuit;
     shared_ptr<thread>		mThread;
     FadingTexture			mFullTexture, mLeftTexture, mMidTexture, mRightTexture;
+    PanelCompositor         mPanelCompositor;
+    bool                    mUsePanelCompositor;
     FadingTexture *         mFadedTexture;
     int                     mFadedTextureFadeCount;
     Anim<float>				mFade;
@@ -387,6 +5656,15 @@ public:
     Anim<float>             mStripesSquareness;
     int                     mTransitionState;
     int                     mTransitionStateNext;
+    double                  mNextTransitionTime;
+    Show                    mShow;
+    YAML::Node              mShowYaml;
+    std::atomic<double>     mMediaDeadline;     // when the slides or a movie next need media
+    std::atomic<bool>       mLoading;
+    bool                    mHeldForSlide;      // the last frame kept the transition for the loader
+    double                  mDecodeSeconds;     // recent decode time, loader thread only
+    float                   mFrameRate, mIdleFrameRate;
+    vector<void*>           mAnimTargets;
     double					mLastTime;
     Anim<float>             mLogoFade;
     Anim<float>             mHeaderFade;
@@ -397,9 +5675,18 @@ public:
     int                     mTaglineStringPos;
     vector<string>          mTaglineStrings;
     
-    vector<Snowflake>       mSnowflakes;
+    Simulation              mSimulation;
+    shared_ptr<Snow>        mSnow;
     
     YAML::Node              configYaml;
+    YAML::Node              mLabYaml;
+    MemoryEntry             mConfigMemory { MemoryLedger::YAML_DOCUMENTS };
+    
+    ConfigWatcher           mConfigWatcher;
+    fs::path                mWatchedResourcePath;   // the watcher's queue only
+    std::mutex              mPendingConfigMutex;
+    shared_ptr<PendingConfig> mPendingConfig;
+    MemoryEntry             mCalendarMemory { MemoryLedger::CALENDAR };
     
     ICalendar               *mTimeEditCalendar;
     fs::path                mTimeEditCalendarFile;
@@ -407,7 +5694,8 @@ public:
     
     fs::path                configResourcePath;
     
-    Perlin                  perlin;
+    Stripes                 mStripes;
+    int                     mStripeLayers;
 };
 
 AtriumDisplayApp::~AtriumDisplayApp(){
@@ -419,20 +5707,42 @@ void AtriumDisplayApp::setup()
 {
     hideCursor();
     
-    srandomdev();
-    randSeed(random());
-    perlin.setSeed(randInt());
+    // --benchmark plays a fixed show offscreen, see setupBenchmark(), and
+    // --replay FILE plays a recorded show trace, see setupReplay()
+    const vector<string> &args = getCommandLineArgs();
+    mBenchmark = find( args.begin(), args.end(), "--benchmark" ) != args.end();
+    auto replay = find( args.begin(), args.end(), "--replay" );
+    mCanvasSize = getWindowSize();
+    
+    int32_t seed;
+    if( mBenchmark ){
+        seed = setupBenchmark( args );
+    } else if( replay != args.end() && replay + 1 != args.end() && mTrace.replay( *( replay + 1 ) ) ){
+        seed = setupReplay();
+    } else {
+        srandomdev();
+        seed = random();
+    }
+    randSeed( seed );
+    mVirtualClock = mBenchmark || mTrace.getMode() == ShowTrace::REPLAY;
+    mNoiseSeed = randInt();
     
     mShouldQuit = false;
-    mSurfaces = new ConcurrentCircularBuffer<SurfaceRef>( 3 ); // room for 5 images
+    mSurfaces = new ConcurrentCircularBuffer<Slide>( 3 ); // room for 5 images
     
     // create and launch the thread
     // mThread = shared_ptr<thread>( new thread( bind( &AtriumDisplayApp::loadImagesThreadFn, this ) ) );
     
-    mFullTexture.mBounds = getWindowBounds();
-    mLeftTexture.mBounds.set(0, 0, getWindowWidth()/3.f, getWindowHeight());
-    mMidTexture.mBounds.set(getWindowWidth()/3.f, 0, getWindowWidth()*2.f/3.f, getWindowHeight());
-    mRightTexture.mBounds.set(getWindowWidth()*2.f/3.f, 0, getWindowWidth(), getWindowHeight());
+    mFullTexture.mBounds = getCanvasBounds();
+    mLeftTexture.mBounds.set(0, 0, getCanvasWidth()/3.f, getCanvasHeight());
+    mMidTexture.mBounds.set(getCanvasWidth()/3.f, 0, getCanvasWidth()*2.f/3.f, getCanvasHeight());
+    mRightTexture.mBounds.set(getCanvasWidth()*2.f/3.f, 0, getCanvasWidth(), getCanvasHeight());
+    
+    // the textures all four panels hold in the steady state, current and last
+    gTexturePool.reserve( mFullTexture.mBounds.getSize(), 2 );
+    gTexturePool.reserve( mLeftTexture.mBounds.getSize(), 6 );
+    
+    mUsePanelCompositor = false;
     
     mTintColor = mFullTexture.mColor = mLeftTexture.mColor = mMidTexture.mColor = mRightTexture.mColor = Color(1.f,.85f, .75f);
     
@@ -442,32 +5752,24 @@ void AtriumDisplayApp::setup()
     
 #pragma mark AtriumDisplayApp @Font loading
     
-    gl::TextureFont::Format f;
-    f.enableMipmapping( true );
-    
     { // render itu logo
         TextLayout layout;
         layout.clear( ColorA( 0.1f, 0.1f, 0.1f, 1.f ) );
-        layout.setFont( Font( loadResource(RES_CUSTOM_FONT_LIGHT), getWindowHeight()*0.09895 ) );
+        layout.setFont( Font( loadResource(RES_CUSTOM_FONT_LIGHT), getCanvasHeight()*0.09895 ) );
         layout.setColor( ColorA( 1., 1., 1., 1. ) );
         layout.addLine("  IT UNIVERSITY OF COPENHAGEN  ");
         Surface8u rendered = layout.render( true, PREMULT );
-        mLogoTexture = gl::Texture::create( rendered );
-    }
-    { // texture fonts
-        Font titleFontPrimary = Font( loadResource(RES_CUSTOM_FONT_BOLD), getWindowHeight()*0.4 );
-        mTitleFontPrimary = gl::TextureFont::create( titleFontPrimary, f );
-        Font titleFontSecondary = Font( loadResource(RES_CUSTOM_FONT_LIGHT), getWindowHeight()*0.4 );
-        mTitleFontSecondary = gl::TextureFont::create( titleFontSecondary, f );
+        mLogoTexture = createTexture( rendered, MemoryLedger::TEXT_CACHES );
     }
+    setupTitleFonts( 1.f );
     // Font objects
-    mHeaderFont = Font( loadResource(RES_CUSTOM_FONT_LIGHT), getWindowHeight()*0.1 );
-    mParagraphFont = Font( loadResource(RES_CUSTOM_FONT_REGULAR), getWindowHeight()*0.0475 );
-    mParagraphFontBold = Font( loadResource(RES_CUSTOM_FONT_SEMIBOLD), getWindowHeight()*0.0475 );
-    mSubtitleFont = Font( loadResource(RES_CUSTOM_FONT_SEMIBOLD), getWindowHeight()*0.065 );
-    mSmallFont = Font( loadResource(RES_CUSTOM_FONT_SEMIBOLD), getWindowHeight()*0.025 );
-    // mTagFont = Font( loadResource(RES_CUSTOM_FONT_REGULAR), getWindowHeight()*0.03 );
-    mTagFont = Font( loadResource(RES_CUSTOM_FONT_REGULAR), getWindowHeight()*0.025 );
+    mHeaderFont = Font( loadResource(RES_CUSTOM_FONT_LIGHT), getCanvasHeight()*0.1 );
+    mParagraphFont = Font( loadResource(RES_CUSTOM_FONT_REGULAR), getCanvasHeight()*0.0475 );
+    mParagraphFontBold = Font( loadResource(RES_CUSTOM_FONT_SEMIBOLD), getCanvasHeight()*0.0475 );
+    mSubtitleFont = Font( loadResource(RES_CUSTOM_FONT_SEMIBOLD), getCanvasHeight()*0.065 );
+    mSmallFont = Font( loadResource(RES_CUSTOM_FONT_SEMIBOLD), getCanvasHeight()*0.025 );
+    // mTagFont = Font( loadResource(RES_CUSTOM_FONT_REGULAR), getCanvasHeight()*0.03 );
+    mTagFont = Font( loadResource(RES_CUSTOM_FONT_REGULAR), getCanvasHeight()*0.025 );
     mLastTime = getElapsedSeconds();
     
     //init vars
@@ -485,35 +5787,322 @@ void AtriumDisplayApp::setup()
     mScheduleFade = 0;
     mStripesSquareness = 1;
     mStripesPosition = vec2(0,0);
+    mCalendarChanged = false;
+    mIsDecember = false;
+    mNextTransitionTime = numeric_limits<double>::max();
+    mMediaDeadline = numeric_limits<double>::max();
+    mShowProfile = false;
+    mLoading = false;
+    mHeldForSlide = false;
+    mDecodeSeconds = 0;
     
     readConfig();
+    setupShow();
     
     configResourcePath = fs::path(expand_user(configYaml["resourcePath"].as<std::string>()));
     
     mTimeEditCalendar = new ICalendar(mTimeEditCalendarTmpFile.string().c_str());
+    mCalendarMemory.set( fileBytes( mTimeEditCalendarTmpFile ) );
+    
+    if( ! configYaml["panelCompositor"] || configYaml["panelCompositor"].as<bool>() ){
+        mUsePanelCompositor = mPanelCompositor.setup( getCanvasBounds() );
+    }
+    
+    mStripeLayers = configYaml["stripeLayers"] ? configYaml["stripeLayers"].as<int>() : 3;
+    mStripes.setup(mNoiseSeed);
+    
+    mSnow = make_shared<Snow>();
+    mSnow->reset(mNoiseSeed, configYaml["snowflakes"] ? configYaml["snowflakes"].as<int>() : 100, vec2(getCanvasSize()));
+    mSnow->setupDraw();
+    mSimulation.add(mSnow);
+    double simulationRate = configYaml["simulationRate"] ? configYaml["simulationRate"].as<double>() : 180.;
+    if( mVirtualClock ){
+        mSimulation.startManual(simulationRate);
+    } else {
+        mSimulation.start(simulationRate);
+    }
+    
+    setupLayers();
+    
+    // the scene is kept in an offscreen buffer so only changed regions are redrawn
+    mDirtyRegions = DirtyRegions( getCanvasBounds() );
+    if( mVirtualClock || ! configYaml["dirtyRegions"] || configYaml["dirtyRegions"].as<bool>() ){
+        try {
+            mSceneFbo = gMemory.track( MemoryLedger::TEXTURES, gl::Fbo::create( getCanvasWidth(), getCanvasHeight(), gl::Fbo::Format().colorTexture() ), (int64_t)getCanvasWidth() * getCanvasHeight() * 4 );
+        } catch( std::exception &e ) {
+            console() << "Redrawing full frames: " << e.what() << endl;
+        }
+    }
+    mDirtyRegions.addAll();
+    
+    // frame rate while animating, and the floor while nothing changes
+    mFrameRate = configYaml["frameRate"] ? configYaml["frameRate"].as<float>() : 60.f;
+    mIdleFrameRate = configYaml["idleFrameRate"] ? configYaml["idleFrameRate"].as<float>() : 2.f;
+    if( mTrace.getMode() == ShowTrace::REPLAY ){
+        try {
+            mFrameRate = stof( mTrace.getHeader( "frameRate", toString( mFrameRate ) ) );
+        } catch( std::exception &e ) {
+            console() << "Bad frameRate in the show trace header, using " << mFrameRate << endl;
+        }
+    }
+    if( mVirtualClock ){
+        disableFrameRate();
+    } else {
+        setFrameRate( mFrameRate );
+    }
+    
+    // section timings over the last ten seconds, written out every minute
+    gProfiler.setWindow( mFrameRate * 10 );
+    mProfileLogInterval = configYaml["profileLogInterval"] ? configYaml["profileLogInterval"].as<double>() : 60.;
+    mNextProfileLog = getElapsedSeconds() + mProfileLogInterval;
+    
+    // quality levels below the configured one, stepped through by frame time
+    mGovernQuality = ! mVirtualClock && ( ! configYaml["qualityGovernor"] || configYaml["qualityGovernor"].as<bool>() );
+    mQuality.setup( { mStripeLayers, mSnow->getMaxCount(), 1.f, 1.f }, 1000.f / mFrameRate );
+    mLastFrameTime = getElapsedSeconds();
+    mLastFrameBusy = false;
+    mTextureScale = 1.f;
+    
+    // what steered the show, to replay a slowdown from the field with --replay
+    if( ! mVirtualClock && configYaml["recordTrace"] && configYaml["recordTrace"].as<bool>() ){
+        time_t now = time( NULL );
+        char stamp[32];
+        strftime( stamp, sizeof(stamp), "trace %Y-%m-%d %H.%M.%S.tsv", localtime( &now ) );
+        mTrace.record( getLogsPath() / stamp, {
+            { "seed", toString( seed ) },
+            { "canvas", ( boost::format( "%dx%d" ) % getCanvasWidth() % getCanvasHeight() ).str() },
+            { "frameRate", toString( mFrameRate ) },
+            { "december", localtime( &now )->tm_mon == 11 ? "1" : "0" },
+            { "resourcePath", configResourcePath.string() }
+        } );
+    }
+    
+    // animated values whose pending tweens may end an idle period
+    for(FadingTexture *panel : { &mLeftTexture, &mMidTexture, &mRightTexture, &mFullTexture }){
+        mAnimTargets.push_back( panel->mFade.ptr() );
+        mAnimTargets.push_back( panel->mCrossFade.ptr() );
+    }
+    for(Anim<float> *anim : { &mTitleFade, &mStripesNoise, &mStripesFade, &mStripesSquareness, &mLogoFade, &mHeaderFade, &mScheduleFade, &mProjectTitleFade, &mProjectDetailsFade, &mMovieFade }){
+        mAnimTargets.push_back( anim->ptr() );
+    }
+    mAnimTargets.push_back( mStripesPosition.ptr() );
+    
+    // decoded slides shared between the instances on this machine
+    mSharedCacheHits = mSharedCacheMisses = 0;
+    if( ! mVirtualClock && configYaml["sharedCache"] && configYaml["sharedCache"].as<bool>() ){
+        size_t megabytes = configYaml["sharedCacheMB"] ? configYaml["sharedCacheMB"].as<size_t>() : 512;
+        mSharedCache.open( megabytes * 1048576 );
+    }
+    
+    // metrics for monitoring on a loopback port, 0 for none
+    mCalendarFetched = -1;
+    mNextMetrics = 0;
+    int metricsPort = configYaml["metricsPort"] ? configYaml["metricsPort"].as<int>() : 9464;
+    if( metricsPort > 0 && ! mVirtualClock ){
+        mMetrics.start( metricsPort );
+    }
+    
+    // lockstep with the show of another display over UDP, see ShowSync:
+    // --lead [PORT] --followers HOST,HOST or --follow HOST[:PORT], or syncLead,
+    // syncFollowers and syncLeader
+    if( ! mVirtualClock ){
+        int syncPort = configYaml["syncPort"] ? configYaml["syncPort"].as<int>() : ShowSync::PORT;
+        string leader = configYaml["syncLeader"] ? configYaml["syncLeader"].as<string>() : "";
+        vector<string> followers;
+        if( configYaml["syncFollowers"] ){
+            for(const YAML::Node &follower : configYaml["syncFollowers"]) followers.push_back( follower.as<string>() );
+        }
+        bool leads = configYaml["syncLead"] && configYaml["syncLead"].as<bool>();
+        auto lead = find( args.begin(), args.end(), "--lead" );
+        auto follow = find( args.begin(), args.end(), "--follow" );
+        auto allowed = find( args.begin(), args.end(), "--followers" );
+        if( allowed != args.end() && allowed + 1 != args.end() ){
+            followers.clear();
+            std::istringstream list( *( allowed + 1 ) );
+            for(string follower; getline( list, follower, ',' ); ) followers.push_back( follower );
+        }
+        if( lead != args.end() ){
+            leads = true;
+            if( lead + 1 != args.end() && isdigit( ( *( lead + 1 ) )[0] ) ) syncPort = stoi( *( lead + 1 ) );
+        }
+        if( follow != args.end() && follow + 1 != args.end() ){
+            leader = *( follow + 1 );
+        }
+        size_t colon = leader.find( ':' );
+        if( colon != string::npos ){
+            syncPort = atoi( leader.substr( colon + 1 ).c_str() );
+            leader = leader.substr( 0, colon );
+        }
+        if( leads ? mSync.lead( syncPort, mNoiseSeed, followers ) : ! leader.empty() && mSync.follow( leader, syncPort ) ){
+            mSync.setJoin( "transition", toString( mShow.getStart() ) );
+            mTrace.setSync( &mSync );
+        }
+    }
+    
+    // a report when no frame comes for this many seconds, 0 for none
+    double stallThreshold = configYaml["stallThreshold"] ? configYaml["stallThreshold"].as<double>() : 2.;
+    if( stallThreshold > 0 ){
+        mWatchdog.watch( "main thread" );
+        mWatchdog.start( stallThreshold, getLogsPath() );
+    }
+    
+    // edits to config.yaml and lab.yaml are picked up without a restart
+    if( ! mVirtualClock ){
+        mWatchedResourcePath = configResourcePath;
+        mConfigWatcher.start( { Platform::get()->getResourcePath(RES_CUSTOM_YAML_CONFIG), configResourcePath / "lab.yaml" }, 2., [this]{ reloadConfig(); } );
+    }
 
     triggerTransition();
     
 }
 
+void AtriumDisplayApp::setupLayers()
+{
+    // sections in drawing order, the static ones are cached offscreen
+    
+    float margin = getCanvasHeight()/8.f;
+    
+    Rectf leftThird( 0, 0, getCanvasWidth()/3.f, getCanvasHeight() );
+    Rectf leftTwoThirds( 0, 0, getCanvasWidth()*2.f/3.f, getCanvasHeight() );
+    Rectf rightTwoThirds( getCanvasWidth()/3.f, 0, getCanvasWidth(), getCanvasHeight() );
+    
+    mRootLayer = Layer::create( "root", Layer::DrawFn() );
+    
+    mProjectDetailsLayer = mRootLayer->addChild( Layer::create( "project details", [this](float a){ drawProjectDetails(a); }, [this]{ return mProjectDetailsFade.value(); } ) );
+    mProjectDetailsLayer->setCached( leftThird );
+    
+    LayerRef panels = mRootLayer->addChild( Layer::create( "panels", [this](float a){ drawPanels(a); } ) );
+    panels->mDirtyFn = [this](DirtyRegions &regions){
+        for(FadingTexture *panel : { &mLeftTexture, &mMidTexture, &mRightTexture, &mFullTexture }){
+            if( panel->hasChanged() ) regions.add( panel->mBounds );
+        }
+    };
+    
+    LayerRef stripes = mRootLayer->addChild( Layer::create( "stripes", [this](float a){ drawStripes(a); }, [this]{ return mStripesFade > 0.0001f ? mStripesFade.value() : 0.f; } ) );
+    Watched<float> stripesNoise( &mStripesNoise ), stripesSquareness( &mStripesSquareness );
+    Watched<vec2> stripesPosition( &mStripesPosition );
+    stripes->mChangedFn = [this, stripesNoise, stripesSquareness, stripesPosition]() mutable {
+        bool moved = stripesNoise.changed() | stripesSquareness.changed() | stripesPosition.changed();
+        // the noise drifts with time, and the snow keeps falling in december
+        return moved || mStripesNoise > 0.f || mIsDecember;
+    };
+    
+    mProjectTitleLayer = mRootLayer->addChild( Layer::create( "project title", [this](float a){ drawProjectTitle(a); }, [this]{ return mProjectTitleFade.value(); } ) );
+    Watched<float> fullFade( &mFullTexture.mFade ), leftFade( &mLeftTexture.mFade );
+    mProjectTitleLayer->mChangedFn = [fullFade, leftFade]() mutable {
+        // the background box follows the panels behind the title
+        return fullFade.changed() | leftFade.changed();
+    };
+    
+    LayerRef movie = mRootLayer->addChild( Layer::create( "movie", [this](float a){ drawMovie(a); }, [this]{ return mMovieFade.value(); } ) );
+    movie->mRegion = rightTwoThirds;
+    movie->mChangedFn = [this]{ return (bool)mMovieFrameTexture; };
+    
+    mTaglinesLayer = mRootLayer->addChild( Layer::create( "taglines", [this](float a){ drawTaglines(a); }, [this]{ return mHeaderFade.value(); } ) );
+    mTaglinesLayer->setCached( leftThird );
+    mScheduleLayer = mRootLayer->addChild( Layer::create( "schedule", [this](float a){ drawSchedule(a); }, [this]{ return mScheduleFade.value(); } ) );
+    mScheduleLayer->setCached( leftTwoThirds );
+    LayerRef logo = mRootLayer->addChild( Layer::create( "logo", [this](float a){ drawLogo(a); }, [this]{ return mLogoFade.value(); } ) );
+    logo->mRegion = Rectf( mLogoTexture->getBounds() ) + vec2( (getCanvasWidth()*2.f/3.f)+margin, (getCanvasHeight()-margin)-mLogoTexture->getHeight() );
+    mRootLayer->addChild( Layer::create( "lab title", [this](float a){ drawLabTitle(a); }, [this]{ return mTitleFade.value(); } ) );
+    mRootLayer->addChild( Layer::create( "borders", [this](float a){ drawBorders(a); } ) );
+    
+    // the recorded "at" times count from the recording's launch, so a replay
+    // starts its clock where the recording's show started, after its setup
+    if( mTrace.getMode() == ShowTrace::RECORD ){
+        mTrace.note( "start", ( boost::format( "%.6f" ) % showTime() ).str() );
+    } else if( mTrace.getMode() == ShowTrace::REPLAY ){
+        string start = mTrace.peek( "start", "" );
+        try {
+            if( ! start.empty() ) setVirtualTime( stod( start ) );
+        } catch( std::exception &e ) {
+            console() << "Bad start in the show trace: " << start << endl;
+        }
+    }
+}
+
 void AtriumDisplayApp::loadImagesThreadFn()
 {
     ci::ThreadSetup threadSetup; // instantiate this if you're talking to Cinder from a secondary thread
     
+    mWatchdog.watch( "loader thread" );
+    mLoading = true;
+    
+    // the start of the movie the project plays first
+    if( mCurrentProject && ! mCurrentProject->mMovies.empty() ){
+        mCurrentProject->prefetchResource( mCurrentProject->mMovies.back(), 32 << 20 );
+    }
+    
     while( ( ! mShouldQuit ) && (mCurrentProject) && ( ! mCurrentProject->mImages.empty() ) ) {
         
         if(mCurrentProject){
+            // decode in the background while the next slide is far off, and
+            // ask for more CPU when it is due before a decode would finish
+            double slack = mMediaDeadline - showTime();
+            bool urgent = ! mSurfaces->isNotEmpty() && slack < mDecodeSeconds * 2;
+            pthread_set_qos_class_self_np( urgent ? QOS_CLASS_USER_INITIATED : QOS_CLASS_UTILITY, 0 );
+            
             try {
                 // console() << "Loading: " << mCurrentProject->mImages.back() << std::endl;
-                mSurfaces->pushFront( Surface::create(loadImage( mCurrentProject->mImages.back() )) );
+                double start = getElapsedSeconds();
+                fs::path image = mCurrentProject->mImages.back();
+                image = image.parent_path() / mTrace.steer( "image", image.filename().string() );
+                float scale = mTextureScale;
+                
+                // an animated GIF plays as a clip, its first frame is the slide
+                GifClipRef clip;
+                if( boost::iequals( image.extension().string(), ".gif" ) ){
+                    clip = GifClip::create( mCurrentProject->openResource( image ) );
+                }
+                
+                // another display instance may have decoded it already
+                uint64_t key = mSharedCache.isOpen() && ! clip ? SharedSurfaceCache::makeKey( image, scale ) : 0;
+                SurfaceRef surface = key ? mSharedCache.find( key ) : SurfaceRef();
+                if( key ) ( surface ? mSharedCacheHits : mSharedCacheMisses )++;
+                
+                if( surface ){
+                    surface = trackSurface( surface );
+                } else {
+                    if( clip ){
+                        surface = clip->getFirstFrame();
+                    } else {
+                        surface = trackSurface(Surface::create(loadSlide( mCurrentProject->openResource( image ), image )));
+                    }
+                    // the clip's frames are cropped from full size ones
+                    if( scale < 1.f && ! clip ){
+                        ivec2 size( vec2( surface->getSize() ) * scale );
+                        surface = trackSurface( Surface::create( ip::resizeCopy( *surface, surface->getBounds(), size ) ) );
+                    }
+                    SurfaceRef shared = key ? mSharedCache.insert( key, surface ) : surface;
+                    if( shared != surface ) surface = trackSurface( shared );
+                    
+                    mDecodeSeconds = getElapsedSeconds() - start;
+                    mTrace.note( "decoded", ( boost::format( "%dx%d %.1fms" ) % surface->getWidth() % surface->getHeight() % ( mDecodeSeconds * 1000. ) ).str() );
+                    {
+                        std::lock_guard<std::mutex> lock( mDecodeTimesMutex );
+                        mDecodeTimes.push_back( mDecodeSeconds * 1000. );
+                        // the benchmark reports them all, the metrics the recent ones
+                        if( ! mBenchmark && mDecodeTimes.size() > 600 ) mDecodeTimes.erase( mDecodeTimes.begin() );
+                    }
+                }
+                mSurfaces->pushFront( { surface, clip } );
             }
             catch( ... ) {
                 // just ignore any exceptions
             }
             mCurrentProject->mImages.pop_back();
+            
+            // the OS reads the next slides while this one waits in the queue
+            const vector<fs::path> &images = mCurrentProject->mImages;
+            for(size_t i = 1; i <= 2 && i <= images.size(); i++){
+                mCurrentProject->prefetchResource( images[images.size() - i] );
+            }
         }
         
     }
+    
+    mLoading = false;
+    mWatchdog.unwatch();
 }
 
 void AtriumDisplayApp::mouseDown( MouseEvent event )
@@ -523,134 +6112,116 @@ void AtriumDisplayApp::mouseDown( MouseEvent event )
 
 void AtriumDisplayApp::update()
 {
+    if( mVirtualClock ){
+        // a fixed step per frame, however long the frame really took
+        mBenchmarkFrameStart = std::chrono::high_resolution_clock::now();
+        // a replay holding for the loader stays at the recorded show time
+        if( ! mHeldForSlide ) setVirtualTime( showTime() + 1. / mFrameRate );
+        mSimulation.stepTo( showTime() );
+    }
+    mHeldForSlide = false;
+    mSync.update();
+    showTimeline().stepTo( showTime() );
     
-    if( mMovie )
+    gProfiler.beginFrame();
+    ScopedProfile profile( gProfiler, "update" );
+    
+    for(FadingTexture *panel : { &mLeftTexture, &mMidTexture, &mRightTexture, &mFullTexture }){
+        panel->updateClip( showTime() );
+    }
+    
+    if( mMovie ){
+        ScopedProfile movieProfile( gProfiler, "movie frame" );
         mMovieFrameTexture = mMovie->getTexture();
+    }
+    
+    time_t timeSinceEpoch = time( NULL );
+    bool isDecember = localtime( &timeSinceEpoch )->tm_mon == 11;
+    // the benchmark always includes the snow, a replay snows if the recording did
+    if( mBenchmark ) isDecember = true;
+    if( mTrace.getMode() == ShowTrace::REPLAY ) isDecember = mTrace.getHeader( "december" ) == "1";
+    if( isDecember != mIsDecember ){
+        mIsDecember = isDecember;
+        mTaglinesLayer->markDirty();
+        mScheduleLayer->markDirty();
+    }
+    
+    if( mCalendarChanged.exchange( false ) ){
+        mScheduleLayer->markDirty();
+    }
+    
+    if( mSnow->isActive() != mIsDecember ){
+        mSnow->setActive( mIsDecember );
+        mSimulation.wake();
+    }
+    mSnow->setDrift( mStripesPosition.value().x );
     
     
     if(gTriggerTransition){
-        mTransitionState = mTransitionStateNext;
-        gTriggerTransition = false;
-        switch (mTransitionStateNext) {
-            case 0: // start and show lab name
-                
-                if(mThread.get()){
-                    mThread->join();
-                }
-                // create and launch the thread
-                mTaglineStringPos = (mTaglineStringPos+1)%mTaglineStrings.size();
-                loadNextProject();
-                mThread = shared_ptr<thread>( new thread( bind( &AtriumDisplayApp::loadImagesThreadFn, this ) ) );
-                
-            {
-                
-                // Update calendar
-                Date now;
-                dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-                    try {
-                        
-                        std::string iCalStr = loadString(loadUrl("http://intermedia.itu.dk/public/calendar/timeEditIcs.php"));
-                        std::string myPath = mTimeEditCalendarFile.string();
-                        
-                        // Get an ofstream which is what you'll use to write to your file.
-                        std::ofstream oStream( myPath );
-                        
-                        // write the string.
-                        oStream << iCalStr;
-                        oStream.close();
-                        
-                        ICalendar tmpCalendar(mTimeEditCalendarFile.string().c_str());
-                        
-                        ::Event *CurrentEvent;
-                        ICalendar::Query SearchQuery(&tmpCalendar);
-                        
-                        SearchQuery.Criteria.From.SetToNow();
-                        SearchQuery.Criteria.From[HOUR] = 0;
-                        SearchQuery.Criteria.From[MINUTE] = 0;
-                        SearchQuery.Criteria.From[SECOND] = 0;
-                        SearchQuery.Criteria.To.SetToNow();
-                        SearchQuery.Criteria.To[MONTH] += 6;
-                        SearchQuery.Criteria.To[HOUR] = 0;
-                        SearchQuery.Criteria.To[MINUTE] = 0;
-                        SearchQuery.Criteria.To[SECOND] = 0;
-                        
-                        SearchQuery.ResetPosition();
-                        
-                        delete mTimeEditCalendar;
-                        
-                        fs::remove(mTimeEditCalendarTmpFile);
-                        
-                        mTimeEditCalendar = new ICalendar(mTimeEditCalendarTmpFile.string().c_str());
-                        
-                        while ((CurrentEvent = SearchQuery.GetNextEvent(false)) != NULL) {
-                            //Correct for missing time zone
-                            CurrentEvent->DtStart[HOUR] +=1;
-                            CurrentEvent->DtEnd[HOUR] +=1;
-                            
-                            mTimeEditCalendar->AddEvent(new ::Event(*CurrentEvent));
-                        }
-                        
-                        mTimeEditCalendar->Sort();
-                        
-                    } catch (std::exception& e) {
-                        console() << e.what() << endl;
-                    }
-                    
-                });
-                
+        // a follower starts its show cycles with the leader's
+        if( mTransitionStateNext == mShow.getStart() && mSync.waitForLeader() ){
+            return;
+        }
+        if( mSync.isLocked() && mSync.getSeed() != mNoiseSeed ){
+            // the same stripes as the leader's
+            mNoiseSeed = mSync.getSeed();
+            mStripes.setSeed( mNoiseSeed );
+        }
+        if( mBenchmark && mTransitionStateNext == mShow.getStart() ){
+            // memory at the start of every cycle, for the leak check
+            vector<int64_t> live;
+            for(int tag = 0; tag < MemoryLedger::TAGS; tag++){
+                live.push_back( gMemory.getStats( MemoryLedger::Tag( tag ) ).mLive );
             }
-                
-                timeline().apply( &mStripesSquareness, 0.0f, 0.f,EaseOutQuad() );
-                timeline().apply( &mStripesPosition, vec2(1,0), 0.f,EaseInQuad() );
-                timeline().apply( &mStripesNoise, .0f, .5f,EaseOutQuad() );
-                timeline().apply( &mStripesFade, .9f, .5f,EaseInOutQuad() );
-                timeline().apply( &mHeaderFade, 0.f, .5f,EaseInQuad() );
-                timeline().apply( &mProjectTitleFade, 0.f, 1.0f,EaseInQuad() );
-                timeline().apply( &mProjectDetailsFade, 0.f, 1.0f,EaseInQuad() );
-                timeline().appendTo( &mStripesPosition, vec2(0,0), 8.f,EaseOutCubic() );
-                timeline().appendTo( &mStripesNoise, .5f, 5.f,EaseInOutSine() ).delay(7.5f);
-                timeline().apply( &mTitleFade, 1.0f, 4.f,EaseOutExpo() ).delay(6.f);
-                timeline().appendTo( &mStripesFade, .6f, 4.f, EaseInOutQuad() ).delay(5.5f);
-                timeline().appendTo( &mStripesNoise, 1.0f, 1.5f,EaseInQuad() ).finishFn(triggerTransition);
-                timeline().appendTo( &mStripesFade, 1.f, 2.f, EaseInOutQuad() ).delay(1.5f);
-                timeline().appendTo( &mTitleFade,  1.0f, 0.0f, 1.5f, EaseOutSine()).delay(3.f);
-                timeline().appendTo( &mStripesSquareness, 1.0f, 4.5f,EaseInOutQuad() ).delay(12.f);
-                mTransitionStateNext = 1;
-                break;
-            case 1: // show lab taglines and calendar
-                timeline().apply( &mHeaderFade, 1.f, .5f,EaseInQuad() );
-                timeline().apply( &mLogoFade, 1.f, .5f,EaseInQuad() );
-                timeline().apply( &mStripesFade, 1.0f, 1.5f,EaseInOutQuad() );
-                timeline().apply( &mStripesSquareness, 0.f, 5.0f,EaseInOutQuad() ).delay(4.f);
-                timeline().appendTo( &mStripesSquareness, 1.f, 5.0f,EaseInOutQuad() );
-                timeline().appendTo( &mStripesSquareness, 0.f, 3.5f,EaseInOutQuad() ).delay(10.f);
-                timeline().apply( &mStripesNoise, .25f, 5.0,EaseInOutSine() ).delay(3.5f);
-                timeline().appendTo( &mStripesNoise, .0f, 5.0f,EaseInOutSine() ).delay(15.f);
-                timeline().apply( &mStripesPosition, vec2(-2,0), 5.f,EaseInQuad() ).delay(26).finishFn( triggerTransition );
-                timeline().apply( &mScheduleFade, 1.f, 1.5f,EaseInOutSine() ).delay(10.5f);
-                timeline().appendTo( &mScheduleFade, .0f, 1.f,EaseInOutSine() ).delay(12.f);
-                timeline().appendTo( &mHeaderFade, 0.f, 1.5f,EaseInQuad() ).delay(5.f);
-                timeline().appendTo( &mLogoFade, 0.f, 1.f,EaseInQuad() ).delay(32.f);
-                mTransitionStateNext = 4;
-                break;
-                
+            mBenchmarkMemory.push_back( live );
+            if( mBenchmarkCyclesDone++ == mBenchmarkCycles ){
+                finishBenchmark();
+                return;
+            }
+        }
+        if( mTrace.isReplayed( "transition" ) ){
+            finishReplay();
+            return;
+        }
+        // the frame is kept, and the transition tried again the next one,
+        // until the leader's whole transition is here
+        if( ! mSync.isReady() ){
+            return;
+        }
+        // and where the leader or the recording found a slide, until the loader has one
+        if( mTrace.peek( "transition", toString( mTransitionStateNext ) ) == toString( (int)Show::STATE_SLIDES ) && ! isMovieDue()
+           && mTrace.peek( "slide", "" ) == "shown" && ! mSurfaces->isNotEmpty() && mLoading ){
+            mHeldForSlide = true;
+            return;
+        }
+        // edits to the configuration take effect as a show cycle begins
+        if( mTransitionStateNext == mShow.getStart() ) applyConfig();
+        mTransitionStateNext = mTrace.steer( "transition", mTransitionStateNext );
+        
+        ScopedProfile transitionProfile( gProfiler, "transition" );
+        mWatchdog.setStatus( "transition to " + mShow.getName( mTransitionStateNext ) + " in " + ( mCurrentProject ? mCurrentProject->mTitle : "no project" ) );
+        mTransitionState = mTransitionStateNext;
+        gTriggerTransition = false;
+        mNextTransitionTime = numeric_limits<double>::max();
+        switch (mTransitionStateNext) {
             case 3: // movie player
                 if( mCurrentProject && !mCurrentProject->mMovies.empty() ) {
                     if(!mMovie || mMovie->isDone() || !mMovie->isPlaying() ){
-                        loadMovieFile(mCurrentProject->mMovies.back());
+                        fs::path movie = mCurrentProject->mMovies.back();
+                        loadMovieFile( movie.parent_path() / mTrace.steer( "movie", movie.filename().string() ) );
                         mCurrentProject->mMovies.pop_back();
                         if(mFadedTexture != &mLeftTexture) mLeftTexture.fadeToSurface(2.f);
-                        timeline().apply( &mMovieFade, 1.f, 2.f,EaseInSine() ).delay(.5f);
-                        timeline().add(triggerTransition, getElapsedSeconds()+mMovie->getDuration()-1.5f );
+                        showTimeline().apply( &mMovieFade, 1.f, 2.f,EaseInSine() ).delay(.5f);
+                        scheduleTransition(mMovie->getDuration()-1.5f);
                     } else {
                         mMidTexture.fadeToSurface(0);
-                        timeline().apply( &mMovieFade, .0f, 1.5f,EaseInSine() );
-                        timeline().add(triggerTransition, getElapsedSeconds()+randFloat(3.5f,5.f));
+                        showTimeline().apply( &mMovieFade, .0f, 1.5f,EaseInSine() );
+                        scheduleTransition(mTrace.randFloat(3.5f,5.f));
                         mTransitionStateNext = 4;
                     }
                 } else {
-                    timeline().apply( &mMovieFade, .0f, 1.5f,EaseInSine() );
-                    timeline().add(triggerTransition, getElapsedSeconds()+randFloat(3.5f,5.f));
+                    showTimeline().apply( &mMovieFade, .0f, 1.5f,EaseInSine() );
+                    scheduleTransition(mTrace.randFloat(3.5f,5.f));
                     mTransitionStateNext = 4;
                 }
                 break;
@@ -658,7 +6229,7 @@ void AtriumDisplayApp::update()
             case 4: // show slideshow
                 
                 // movies at odd fades from fade count 3
-                if( (mFadedTextureFadeCount > 2 && mFadedTextureFadeCount % 2 == 1 )  && !mCurrentProject->mMovies.empty()){
+                if( isMovieDue() ){
                     mTransitionStateNext = 3;
                     mFadedTextureFadeCount++;
                     triggerTransition();
@@ -670,12 +6241,17 @@ void AtriumDisplayApp::update()
                 
                 // now it's slides
                 
-                if( mSurfaces->isNotEmpty() ) {
+                // whether a slide was ready, waited on or the project had none left;
+                // a replay or a follower held the transition for the loader above
+                string slide = mTrace.steer( "slide", mSurfaces->isNotEmpty() ? "shown" : mLoading ? "waited" : "done" );
+                
+                if( slide == "shown" && mSurfaces->isNotEmpty() ) {
                     
-                    SurfaceRef croppedSurface, newSurface;
-                    mSurfaces->popBack( &newSurface );
+                    Slide queued;
+                    mSurfaces->popBack( &queued );
+                    SurfaceRef newSurface = queued.mSurface;
                     FadingTexture * fadingTexture;
-                    int whichTexture = randInt(4);
+                    int whichTexture = mTrace.randInt(4);
                     
                     // overrides of random values for deterministic start
                     
@@ -690,7 +6266,8 @@ void AtriumDisplayApp::update()
                     if(whichTexture == 2) fadingTexture = &mRightTexture;
                     if(whichTexture == 3) fadingTexture = &mFullTexture;
                     
-                    croppedSurface = Surface::create(newSurface->clone(fadingTexture->mBounds.proportionalFit(fadingTexture->mBounds, newSurface->getBounds(), true, true)));
+                    // the texture upload copies the crop straight from the slide
+                    Area crop = getSlideCrop(fadingTexture->mBounds, newSurface->getBounds());
                     
                     if (mFadedTexture == &mFullTexture && fadingTexture != &mFullTexture) {
                         // when fading down from full texture, set the new texture to black before fading it up.
@@ -698,36 +6275,55 @@ void AtriumDisplayApp::update()
                         mFullTexture.fadeToSurface(2.f);
                     }
                     
-                    fadingTexture->fadeToSurface(croppedSurface);
+                    fadingTexture->fadeToSurface(newSurface, crop);
+                    if( queued.mClip ) fadingTexture->play( queued.mClip, crop );
                     if(mFadedTextureFadeCount < 2){
-                        timeline().add(triggerTransition, getElapsedSeconds()+5.f);
+                        scheduleTransition(5.f);
                     } else {
-                        timeline().add(triggerTransition, getElapsedSeconds()+randFloat(3.5f,5.f));
+                        scheduleTransition(mTrace.randFloat(3.5f,5.f));
                     }
                     mFadedTexture = fadingTexture;
                     
                     if(mFadedTextureFadeCount == 0){
-                        timeline().apply( &mProjectTitleFade, 1.f, 2.0f,EaseInOutSine() );
+                        showTimeline().apply( &mProjectTitleFade, 1.f, 2.0f,EaseInOutSine() );
                     }
                     if(mFadedTextureFadeCount == 1){
-                        timeline().apply( &mProjectDetailsFade, 1.f, 2.0f,EaseInOutSine() );
+                        showTimeline().apply( &mProjectDetailsFade, 1.f, 2.0f,EaseInOutSine() );
                     }
                     
                     mFadedTextureFadeCount++;
                     
+                } else if( slide != "done" ) {
+                    
+                    // the loader hasn't caught up, hold the current slide a little longer
+                    console() << "Next slide missed its deadline, waiting for the loader" << endl;
+                    scheduleTransition(.25f);
+                    
                 } else {
                     
                     if( !mCurrentProject->mMovies.empty()){
-                        timeline().apply( &mProjectTitleFade, 1.f, 2.0f,EaseInOutSine() );
-                        timeline().apply( &mProjectDetailsFade, 1.f, 2.0f,EaseInOutSine() );
+                        showTimeline().apply( &mProjectTitleFade, 1.f, 2.0f,EaseInOutSine() );
+                        showTimeline().apply( &mProjectDetailsFade, 1.f, 2.0f,EaseInOutSine() );
                         mTransitionStateNext = 3;
                         triggerTransition();
                     } else {
                         mTransitionStateNext = -1;
-                        timeline().add(triggerTransition, getElapsedSeconds()+.1f);
+                        scheduleTransition(.1f);
                     }
                 }
                 break;
+            default: // the scripted states, see Show
+                if( mShow.has( mTransitionStateNext ) ){
+                    const ShowState &state = mShow.play( mTransitionStateNext, showTimeline() );
+                    scheduleTransition( state.mLength );
+                    mTransitionStateNext = state.mNext;
+                } else {
+                    console() << "No show state " << mTransitionStateNext << ", starting over" << endl;
+                    mTransitionStateNext = Show::STATE_NEXT_PROJECT;
+                    triggerTransition();
+                }
+                break;
+                
             case -1: // next project
                 
                 mStripesSquareness = 0;
@@ -735,7 +6331,7 @@ void AtriumDisplayApp::update()
                 mStripesFade = 0;
                 mStripesPosition = vec2(1,0);
                 mFadedTextureFadeCount = 0;
-                mTransitionStateNext = 0;
+                mTransitionStateNext = mShow.getStart();
                 if (mFadedTexture == &mFullTexture) {
                     mProjectDetailsFade = 0;
                     mLeftTexture.fadeToSurface(0);
@@ -749,646 +6345,1129 @@ void AtriumDisplayApp::update()
                     mMidTexture.fadeToSurface(1.5f);
                     mRightTexture.fadeToSurface(2.f);
                 }
-                timeline().apply( &mProjectTitleFade, 0.f, 1.f,EaseInQuad() );
-                timeline().apply( &mProjectDetailsFade, 0.f, 1.f,EaseInQuad() );
-                timeline().add(triggerTransition, getElapsedSeconds()+2.5);
+                showTimeline().apply( &mProjectTitleFade, 0.f, 1.f,EaseInQuad() );
+                showTimeline().apply( &mProjectDetailsFade, 0.f, 1.f,EaseInQuad() );
+                scheduleTransition(2.5);
                 
                 break;
         }
+        updateMediaDeadline();
+        mSync.endTransition();
     }
 }
 
+// converts a window rect (origin upper left) to framebuffer pixels (origin lower left)
+static Area toFramebufferArea(const Rectf &rect, int height){
+    return Area( floor( rect.x1 ), height - ceil( rect.y2 ), ceil( rect.x2 ), height - floor( rect.y1 ) );
+}
+
 void AtriumDisplayApp::draw()
 {
-    time_t timeSinceEpoch = time( NULL );
-    struct tm *now = localtime( &timeSinceEpoch );
+    gProfiler.begin( "draw" );
     
-    gl::ScopedBlendAlpha  blendAlpha;
-    gl::clear();
-    gl::color(1.,1.,1.,1.);
+    if( mShowProfile ){
+        mDirtyRegions.add( Rectf( 0, 0, getCanvasWidth()/3.f, getCanvasHeight() ) );
+    }
     
-    float margin = getWindowHeight()/8.f;
+    mRootLayer->collectDirty( mDirtyRegions );
     
-    // PROJECT DETAILS
+    if( mSceneFbo ){
+        {
+            gl::ScopedFramebuffer scopedFbo( mSceneFbo );
+            gl::ScopedViewport scopedViewport( ivec2( 0 ), mSceneFbo->getSize() );
+            gl::ScopedMatrices scopedMatrices;
+            gl::setMatricesWindow( mSceneFbo->getSize() );
+            // a pass over the layers per dirty column, the layers outside it are culled
+            for(const Rectf &dirty : mDirtyRegions.getRects()){
+                if( dirty.getWidth() <= 0 ) continue;
+                Area area = toFramebufferArea( dirty, mSceneFbo->getHeight() );
+                gl::ScopedScissor scopedScissor( area.getUL(), area.getSize() );
+                drawScene( dirty );
+            }
+        }
+        ScopedProfile presentProfile( gProfiler, "present", true );
+        // the back buffer is undefined after a swap and the renderer can't
+        // tell its age, so the whole scene is presented; the benchmark only
+        // renders offscreen
+        if( ! mBenchmark ){
+            mSceneFbo->blitToScreen( mSceneFbo->getBounds(), mSceneFbo->getBounds() );
+        }
+    } else {
+        drawScene( Rectf() );
+    }
     
-    Surface8u renderedHeader;
-    vec2 headerMeasure;
+    governQuality( ! mDirtyRegions.isEmpty() );
+    throttleFrameRate( mDirtyRegions.isEmpty() );
+    mDirtyRegions.endFrame();
     
-    if(mProjectDetailsFade > 0 || mProjectTitleFade > 0){
-        
-        gl::pushMatrices();
-        
-        TextBox headerBox;
-        headerBox.setSize(ivec2((getWindowWidth()/3.)-(2.5*margin), getWindowHeight()-(4*margin) ));
-        headerBox.setColor(ColorA(1.,1.,1.,1.));
-        headerBox.setFont(mHeaderFont);
-        headerBox.setText(mCurrentProject->mTitle);
-        renderedHeader = headerBox.render();
-        headerMeasure = headerBox.measure();
-        
-        gl::translate(0,headerMeasure.y+(margin*.375));
-        
-        // tags
-        
-        vec2 tagOffset = vec2(0,0);
-        
-        for(int i = 0; i < mCurrentProject->mTags.size(); i++ ){
-            if(boost::to_upper_copy( mCurrentProject->mTags[i] ) != "FEATURED"){
-                TextBox tagsBox;
-                tagsBox.setColor(ColorA(0.,0.,0.,1.));
-                tagsBox.setFont(mTagFont);
-                tagsBox.setText(boost::to_upper_copy( mCurrentProject->mTags[i] ));
-                Surface8u renderedTag = tagsBox.render();
-                vec2 tagMeasure = tagsBox.measure();
-                
-                gl::pushMatrices();
-                gl::translate(margin*.25, 0.);
-                gl::translate(tagOffset);
-                gl::color(1,1,1,mProjectDetailsFade*.75);
-                gl::drawSolidRect(Rectf(margin,margin,tagMeasure.x+(margin*1.25),tagMeasure.y+(margin*1.0625)) );
-                gl::color(1.,1.,1.,mProjectDetailsFade);
-                gl::draw(  gl::Texture::create( renderedTag ), vec2(margin*1.125, margin*1.03125) );
-                gl::popMatrices();
-                
-                tagOffset.x += tagMeasure.x+(margin*.375f);
-                if(tagOffset.x > (getWindowWidth()/3.)-(3*margin)){
-                    tagOffset.y+=mTagFont.getAscent()+mTagFont.getDescent()+(margin*.2);
-                    tagOffset.x = 0;
-                }
+    gProfiler.end();
+    
+    if( mShowProfile ) drawProfile();
+    gProfiler.endFrame();
+    
+    if( mBenchmark ) endBenchmarkFrame();
+    mWatchdog.frame();
+    
+    if( getElapsedSeconds() >= mNextMetrics ){
+        publishMetrics();
+        mNextMetrics = getElapsedSeconds() + 1.;
+    }
+    
+    if( getElapsedSeconds() >= mNextProfileLog ){
+        logProfile();
+        mNextProfileLog = getElapsedSeconds() + mProfileLogInterval;
+    }
+}
+
+void AtriumDisplayApp::keyDown( KeyEvent event )
+{
+    // p shows the section timings
+    if( event.getChar() == 'p' ){
+        mShowProfile = ! mShowProfile;
+        mDirtyRegions.addAll();
+    }
+}
+
+void AtriumDisplayApp::drawProfile()
+{
+    static Font font( "Menlo", 14 );
+    
+    vector<string> lines = gProfiler.report();
+    vector<string> memory = gMemory.report();
+    vector<string> io = gMediaIO.report();
+    vector<string> textures = gTexturePool.report();
+    vector<string> sync = mSync.report();
+    lines.push_back( "" );
+    lines.insert( lines.end(), memory.begin(), memory.end() );
+    lines.push_back( "" );
+    lines.insert( lines.end(), io.begin(), io.end() );
+    lines.insert( lines.end(), textures.begin(), textures.end() );
+    lines.insert( lines.end(), sync.begin(), sync.end() );
+    float lineHeight = 18;
+    
+    gl::ScopedBlendAlpha blendAlpha;
+    gl::color( 0, 0, 0, .75f );
+    gl::drawSolidRect( Rectf( 10, 10, 10 + 720, 10 + 10 + lines.size() * lineHeight ) );
+    for(size_t i = 0; i < lines.size(); i++){
+        gl::drawString( lines[i], vec2( 20, 20 + i * lineHeight ), Color::white(), font );
+    }
+}
+
+void AtriumDisplayApp::logProfile()
+{
+    std::ostringstream log;
+    
+    time_t now = time( NULL );
+    char stamp[32];
+    strftime( stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime( &now ) );
+    
+    log << stamp << " " << ( mCurrentProject ? mCurrentProject->mTitle : "-" ) << " / " << mShow.getName( mTransitionState ) << endl;
+    for(const string &line : gProfiler.report()){
+        log << "  " << line << endl;
+    }
+    for(const string &line : gMemory.report()){
+        log << "  " << line << endl;
+    }
+    for(const string &line : gMediaIO.report()){
+        log << "  " << line << endl;
+    }
+    for(const string &line : gTexturePool.report()){
+        log << "  " << line << endl;
+    }
+    for(const string &line : mSync.report()){
+        log << "  " << line << endl;
+    }
+    appendLog( "profile.log", log.str() );
+}
+
+// What monitoring scrapes, refreshed once a second from the main thread.
+void AtriumDisplayApp::publishMetrics()
+{
+    if( mBenchmark ) return;
+    
+    MetricsText text;
+    auto quantiles = [&text]( const string &name, const Profiler::Stats &stats, const string &labels ){
+        string prefix = labels.empty() ? "" : labels + ",";
+        text.sample( name, stats.mP50, prefix + "quantile=\"0.5\"" );
+        text.sample( name, stats.mP95, prefix + "quantile=\"0.95\"" );
+        text.sample( name, stats.mP99, prefix + "quantile=\"0.99\"" );
+        text.sample( name + "_count", stats.mCount, labels );
+    };
+    
+    text.family( "atrium_section_milliseconds", "summary", "CPU time of the frame sections over the profiler window, frame is the interval between frames." );
+    for(const auto &entry : gProfiler.getStats()){
+        quantiles( "atrium_section_milliseconds", entry.second, "section=\"" + entry.first + "\"" );
+    }
+    text.family( "atrium_section_gpu_milliseconds", "summary", "GPU time of the frame sections over the profiler window." );
+    for(const auto &entry : gProfiler.getStats( true )){
+        if( entry.second.mCount ) quantiles( "atrium_section_gpu_milliseconds", entry.second, "section=\"" + entry.first + "\"" );
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock( mDecodeTimesMutex );
+        vector<double> sorted( mDecodeTimes );
+        sort( sorted.begin(), sorted.end() );
+        auto percentile = [&sorted]( double p ){ return sorted.empty() ? 0. : sorted[min<size_t>( p * sorted.size(), sorted.size() - 1 )]; };
+        Profiler::Stats decode = { sorted.size(), (float)percentile( .5 ), (float)percentile( .95 ), (float)percentile( .99 ), (float)percentile( 1 ) };
+        text.family( "atrium_decode_milliseconds", "summary", "Time to decode the recent slide images." );
+        quantiles( "atrium_decode_milliseconds", decode, "" );
+    }
+    
+    {
+        vector<double> sorted;
+        for(const MediaIO::Read &read : gMediaIO.getRecent()) sorted.push_back( read.mSeconds * 1000. );
+        sort( sorted.begin(), sorted.end() );
+        auto percentile = [&sorted]( double p ){ return sorted.empty() ? 0. : sorted[min<size_t>( p * sorted.size(), sorted.size() - 1 )]; };
+        Profiler::Stats reads = { sorted.size(), (float)percentile( .5 ), (float)percentile( .95 ), (float)percentile( .99 ), (float)percentile( 1 ) };
+        text.family( "atrium_read_milliseconds", "summary", "Time to read the recent media files from the resource path." );
+        quantiles( "atrium_read_milliseconds", reads, "" );
+    }
+    text.family( "atrium_read_bytes_total", "counter", "Bytes of media read from the resource path." );
+    text.sample( "atrium_read_bytes_total", gMediaIO.getBytes() );
+    text.family( "atrium_read_seconds_total", "counter", "Time spent reading media from the resource path." );
+    text.sample( "atrium_read_seconds_total", gMediaIO.getSeconds() );
+    text.family( "atrium_prefetches_total", "counter", "Files the OS was asked to read ahead." );
+    text.sample( "atrium_prefetches_total", gMediaIO.getPrefetches() );
+    
+    text.family( "atrium_textures_lent_total", "counter", "Slide textures handed out by the texture pool." );
+    text.sample( "atrium_textures_lent_total", gTexturePool.getLent() );
+    text.family( "atrium_textures_reused_total", "counter", "Slide textures the pool had free, without an allocation." );
+    text.sample( "atrium_textures_reused_total", gTexturePool.getHits() );
+    text.family( "atrium_texture_allocations_total", "counter", "Slide textures the pool allocated." );
+    text.sample( "atrium_texture_allocations_total", gTexturePool.getAllocations() );
+    text.family( "atrium_texture_upload_seconds_total", "counter", "Main thread time spent handing slide pixels to the GPU." );
+    text.sample( "atrium_texture_upload_seconds_total", gTexturePool.getUploadSeconds() );
+    
+    if( mSync.getRole() != ShowSync::OFF ){
+        text.family( "atrium_sync_locked", "gauge", "1 while a follower runs the leader's show, always 1 on the leader." );
+        text.sample( "atrium_sync_locked", mSync.getRole() == ShowSync::LEADER || mSync.isLocked() );
+        text.family( "atrium_sync_offset_seconds", "gauge", "How far a follower's show clock is set from its elapsed time." );
+        text.sample( "atrium_sync_offset_seconds", mSync.getOffset() );
+        text.family( "atrium_sync_round_trip_seconds", "gauge", "The fastest recent ping round trip to the leader." );
+        text.sample( "atrium_sync_round_trip_seconds", mSync.getRoundTrip() );
+        text.family( "atrium_sync_events_total", "counter", "Show events sent by the leader, or taken in by a follower." );
+        text.sample( "atrium_sync_events_total", mSync.getEvents() );
+    }
+    
+    text.family( "atrium_surface_queue_depth", "gauge", "Decoded slides waiting to be shown." );
+    text.sample( "atrium_surface_queue_depth", mSurfaces->getSize() );
+    text.family( "atrium_surface_queue_capacity", "gauge", "Decoded slides the queue holds at most." );
+    text.sample( "atrium_surface_queue_capacity", mSurfaces->getCapacity() );
+    
+    text.family( "atrium_memory_bytes", "gauge", "Live bytes per kind of memory, see MemoryLedger." );
+    for(int tag = 0; tag < MemoryLedger::TAGS; tag++){
+        text.sample( "atrium_memory_bytes", gMemory.getStats( MemoryLedger::Tag( tag ) ).mLive, string( "tag=\"" ) + MemoryLedger::getName( MemoryLedger::Tag( tag ) ) + "\"" );
+    }
+    
+    uint64_t lookups = Layer::sCacheHits + Layer::sCacheMisses;
+    text.family( "atrium_layer_cache_lookups_total", "counter", "Cached layers drawn, by whether their cache was still valid." );
+    text.sample( "atrium_layer_cache_lookups_total", Layer::sCacheHits, "result=\"hit\"" );
+    text.sample( "atrium_layer_cache_lookups_total", Layer::sCacheMisses, "result=\"miss\"" );
+    text.family( "atrium_layer_cache_hit_ratio", "gauge", "Share of cached layer draws that reused their cache." );
+    text.sample( "atrium_layer_cache_hit_ratio", lookups ? Layer::sCacheHits / double( lookups ) : 1. );
+    
+    if( mSharedCache.isOpen() ){
+        text.family( "atrium_shared_cache_lookups_total", "counter", "Slides looked up in the cache shared with other instances." );
+        text.sample( "atrium_shared_cache_lookups_total", mSharedCacheHits, "result=\"hit\"" );
+        text.sample( "atrium_shared_cache_lookups_total", mSharedCacheMisses, "result=\"miss\"" );
+    }
+    
+    if( mCalendarFetched >= 0 ){
+        text.family( "atrium_calendar_age_seconds", "gauge", "Time since the calendar was last fetched." );
+        text.sample( "atrium_calendar_age_seconds", getElapsedSeconds() - mCalendarFetched );
+    }
+    
+    text.family( "atrium_transition_state", "gauge", "The show state on screen, named in the label." );
+    text.sample( "atrium_transition_state", mTransitionState, "state=\"" + mShow.getName( mTransitionState ) + "\"" );
+    text.family( "atrium_quality_level", "gauge", "The quality governor's level, 0 for full quality." );
+    text.sample( "atrium_quality_level", mQuality.getLevelIndex() );
+    
+    mMetrics.publish( text.str() );
+}
+
+// Parses the --benchmark options, hides the window and writes the fixture
+// portfolio. The show then runs on a virtual clock advanced one frame per
+// update, rendering offscreen at the canvas size, and quits after the given
+// number of show cycles with a report for regression tracking:
+//   --seed N --cycles N --canvas 5760x1080 --fixtures DIR --report FILE
+// With --leak-check the exit status fails when memory of any kind kept
+// growing from cycle to cycle.
+int32_t AtriumDisplayApp::setupBenchmark(const vector<string> &args)
+{
+    mBenchmarkSeed = 0x214;
+    mBenchmarkCycles = 2;
+    mBenchmarkCyclesDone = 0;
+    mBenchmarkLeakCheck = find( args.begin(), args.end(), "--leak-check" ) != args.end();
+    mBenchmarkFixtures = fs::temp_directory_path() / "AtriumDisplayBenchmark";
+    mCanvasSize = ivec2( 5760, 1080 );
+    
+    for(size_t i = 0; i + 1 < args.size(); i++){
+        const string &value = args[i + 1];
+        try {
+            if( args[i] == "--seed" ) mBenchmarkSeed = stoi( value, nullptr, 0 );
+            else if( args[i] == "--cycles" ) mBenchmarkCycles = max( 1, stoi( value ) );
+            else if( args[i] == "--fixtures" ) mBenchmarkFixtures = value;
+            else if( args[i] == "--report" ) mBenchmarkReport = value;
+            else if( args[i] == "--canvas" ){
+                size_t x = value.find( 'x' );
+                mCanvasSize = ivec2( stoi( value.substr( 0, x ) ), stoi( value.substr( x + 1 ) ) );
             }
+        } catch( std::exception &e ) {
+            console() << "Ignoring benchmark option " << args[i] << " " << value << ": " << e.what() << endl;
         }
+    }
+    // the first cycle fills the caches, the leak check needs a few more after it
+    if( mBenchmarkLeakCheck ) mBenchmarkCycles = max( mBenchmarkCycles, 4 );
+    
+    getWindow()->hide();
+    gl::enableVerticalSync( false );
+    setVirtualTime( 0 );
+    
+    console() << "Benchmark seed " << mBenchmarkSeed << ", " << mBenchmarkCycles << " cycles at " << mCanvasSize.x << "x" << mCanvasSize.y << endl;
+    try {
+        writeFixturePortfolio( mBenchmarkFixtures, mBenchmarkSeed, 3, 4 );
+    } catch( std::exception &e ) {
+        console() << "Unable to write the benchmark fixtures: " << e.what() << endl;
+    }
+    
+    return mBenchmarkSeed;
+}
+
+// CPU and GPU time of the frame just drawn
+void AtriumDisplayApp::endBenchmarkFrame()
+{
+    glFinish();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - mBenchmarkFrameStart;
+    mBenchmarkFrameTimes.push_back( elapsed.count() );
+}
+
+void AtriumDisplayApp::finishBenchmark()
+{
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+    
+    JsonTree report;
+    report.addChild( JsonTree( "seed", mBenchmarkSeed ) );
+    report.addChild( JsonTree( "cycles", mBenchmarkCycles ) );
+    report.addChild( JsonTree( "canvas", ( boost::format( "%dx%d" ) % mCanvasSize.x % mCanvasSize.y ).str() ) );
+    report.addChild( JsonTree( "showSeconds", showTime() ) );
+    report.addChild( benchmarkSummary( "frameMs", mBenchmarkFrameTimes ) );
+    {
+        std::lock_guard<std::mutex> lock( mDecodeTimesMutex );
+        report.addChild( benchmarkSummary( "decodeMs", mDecodeTimes ) );
+    }
+    // ru_maxrss is in bytes on macOS
+    report.addChild( JsonTree( "peakMemoryMB", usage.ru_maxrss / ( 1024. * 1024. ) ) );
+    
+    // a tag leaks when it grew over every cycle after the first
+    JsonTree memory = JsonTree::makeObject( "memory" );
+    JsonTree leaks = JsonTree::makeArray( "leaks" );
+    for(int tag = 0; tag < MemoryLedger::TAGS; tag++){
+        MemoryLedger::Stats stats = gMemory.getStats( MemoryLedger::Tag( tag ) );
+        JsonTree entry = JsonTree::makeObject( MemoryLedger::getName( MemoryLedger::Tag( tag ) ) );
+        entry.addChild( JsonTree( "liveMB", stats.mLive / 1048576. ) );
+        entry.addChild( JsonTree( "peakMB", stats.mPeak / 1048576. ) );
+        entry.addChild( JsonTree( "objects", stats.mCount ) );
+        entry.addChild( JsonTree( "allocations", stats.mAllocations ) );
         
-        if(tagOffset.x > 0.)
-            tagOffset.y += mTagFont.getAscent()+mTagFont.getDescent()+(margin*.25);
-        
-        gl::translate(0, tagOffset.y);
-        
-        // summary
-        
-        TextBox summaryBox;
-        summaryBox.setSize(ivec2((getWindowWidth()/3.)-(2.5*margin), getWindowHeight()-(2.5*margin)-headerMeasure.y));
-        summaryBox.setColor(ColorA(1.,1.,1.,1.));
-        summaryBox.setFont(mParagraphFont);
-        summaryBox.setText(mCurrentProject->mSummary);
-        Surface8u renderedSummary = summaryBox.render();
-        vec2 summaryMeasure = summaryBox.measure();
-        // show background box when there's a full texture
-        /*
-         gl::color(0.1,0.1,0.1,mFullTexture.mFade*.75*mProjectTextFade);
-         gl::drawSolidRect(Rectf(margin,margin,summaryMeasure.x+(margin*1.5),summaryMeasure.y+(margin*1.25)) );
-         */
-        gl::color(1.,1.,1.,mProjectDetailsFade);
-        gl::draw(  gl::Texture::create( renderedSummary ), vec2(margin*1.25, margin*1.125 ));
-        
-        gl::translate(0, summaryMeasure.y + (margin*.375));
-        
-        gl::popMatrices();
-        
-        // small text
-        
-        TextBox smallBox;
-        smallBox.setSize(ivec2((getWindowWidth()/3.)-(2.5*margin), getWindowHeight()-(2.5*margin)-headerMeasure.y));
-        smallBox.setColor(ColorA(1.,1.,1.,1.));
-        smallBox.setFont(mSmallFont);
-        
-        if(!mCurrentProject->mDate.is_not_a_date()){
-            boost::gregorian::date_facet* facet(new boost::gregorian::date_facet("%B %Y"));
-            stringstream ss;
-            ss.imbue(std::locale(std::cout.getloc(), facet));
-            ss << mCurrentProject->mDate;
-            smallBox.setText(ss.str());
+        bool growing = mBenchmarkMemory.size() > 2;
+        for(size_t i = 2; i < mBenchmarkMemory.size(); i++){
+            growing = growing && mBenchmarkMemory[i][tag] > mBenchmarkMemory[i-1][tag];
         }
-        
-        if(mCurrentProject->mHomepageURL.str().size() > 7){
-            smallBox.appendText(" | " + mCurrentProject->mHomepageURL.str());
+        if( mBenchmarkMemory.size() > 1 ){
+            entry.addChild( JsonTree( "growthMB", ( mBenchmarkMemory.back()[tag] - mBenchmarkMemory[1][tag] ) / 1048576. ) );
+        }
+        if( growing ) leaks.pushBack( JsonTree( "", string( MemoryLedger::getName( MemoryLedger::Tag( tag ) ) ) ) );
+        memory.addChild( entry );
+    }
+    report.addChild( memory );
+    report.addChild( leaks );
+    
+    string json = report.serialize();
+    console() << json << endl;
+    if( ! mBenchmarkReport.empty() ){
+        std::ofstream( mBenchmarkReport.string() ) << json << endl;
+    }
+    
+    // a failing exit status, so CI notices
+    if( mBenchmarkLeakCheck && leaks.hasChildren() ){
+        console() << "Leak check failed" << endl;
+        shutdown();
+        std::_Exit( EXIT_FAILURE );
+    }
+    quit();
+}
+
+// Sets up replaying the trace given with --replay at the canvas size and
+// seed it was recorded with. The show runs on a virtual clock at the
+// recorded frame rate, as fast as frames render, and quits with the profile
+// once the recorded transitions are through. The portfolio comes from the
+// local config, projects and images are matched by name.
+int32_t AtriumDisplayApp::setupReplay()
+{
+    int32_t seed = 0;
+    try {
+        string canvas = mTrace.getHeader( "canvas" );
+        size_t x = canvas.find( 'x' );
+        if( x != string::npos ){
+            mCanvasSize = ivec2( stoi( canvas.substr( 0, x ) ), stoi( canvas.substr( x + 1 ) ) );
         }
-        for(int i = 0; i < mCurrentProject->mParticipants.size(); i++ ){
-            smallBox.appendText(" | ");
-            smallBox.appendText(mCurrentProject->mParticipants[i] );
+        seed = stoi( mTrace.getHeader( "seed", "0" ) );
+    } catch( std::exception &e ) {
+        console() << "Bad show trace header: " << e.what() << endl;
+    }
+    
+    gl::enableVerticalSync( false );
+    setVirtualTime( 0 );
+    
+    return seed;
+}
+
+void AtriumDisplayApp::finishReplay()
+{
+    console() << "Replay done after " << showTime() << " show seconds" << endl;
+    for(const string &line : gProfiler.report()){
+        console() << "  " << line << endl;
+    }
+    quit();
+}
+
+// The lab title's texture fonts, with glyphs rendered at a scale of their
+// size, or read from the atlas cache when they have been before.
+void AtriumDisplayApp::setupTitleFonts(float scale)
+{
+    gl::TextureFont::Format f;
+    f.enableMipmapping( true );
+    
+    mTitleFontPrimary = CachedTextureFont::create( loadResource(RES_CUSTOM_FONT_BOLD), getCanvasHeight()*0.4*scale, getCanvasHeight(), f );
+    mTitleFontSecondary = CachedTextureFont::create( loadResource(RES_CUSTOM_FONT_LIGHT), getCanvasHeight()*0.4*scale, getCanvasHeight(), f );
+    mTextScale = scale;
+}
+
+// Feeds the interval of frames that drew something to the governor, and
+// applies and logs the level it steps to.
+void AtriumDisplayApp::governQuality(bool busy)
+{
+    double now = getElapsedSeconds();
+    // after an idle frame the interval is the throttled one
+    bool judged = mGovernQuality && busy && mLastFrameBusy && mQuality.addFrame( ( now - mLastFrameTime ) * 1000. );
+    mLastFrameTime = now;
+    mLastFrameBusy = busy;
+    if( ! judged ) return;
+    
+    const QualityGovernor::Level &level = mQuality.getLevel();
+    mSnow->setLimit( level.mSnowflakes );
+    mTextureScale = level.mTextureScale;
+    if( level.mTextScale != mTextScale ){
+        setupTitleFonts( level.mTextScale );
+    }
+    mDirtyRegions.addAll();
+    
+    string decision = ( boost::format( "quality level %d (%s): %d stripe layers, %d snowflakes, text at %.2f, slides at %.2f" )
+                       % mQuality.getLevelIndex() % mQuality.getReason() % level.mStripeLayers % level.mSnowflakes % level.mTextScale % level.mTextureScale ).str();
+    console() << decision << endl;
+    
+    time_t stamp = time( NULL );
+    char date[32];
+    strftime( date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime( &stamp ) );
+    appendLog( "profile.log", string( date ) + " " + decision + "\n" );
+}
+
+// Drops to the idle frame rate while nothing on screen changes. The next
+// frame is timed to land just after the next scheduled transition, the
+// start of a delayed tween or a GIF's next frame, whichever comes first.
+void AtriumDisplayApp::throttleFrameRate(bool idle)
+{
+    if( mVirtualClock ) return;
+    
+    double now = showTime();
+    double wake = mNextTransitionTime;
+    // a follower holding for the leader joins on the next frame
+    if( gTriggerTransition && mSync.getRole() == ShowSync::FOLLOWER && ! mSync.isLocked() ) wake = now;
+    
+    for(FadingTexture *panel : { &mLeftTexture, &mMidTexture, &mRightTexture, &mFullTexture }){
+        if( panel->mClip ) wake = min( wake, panel->mClip->getDue() );
+    }
+    
+    if( idle && mIdleFrameRate > 0.f ){
+        wake = min( wake, showTimeline().getNextStart( mAnimTargets, now ) );
+    }
+    
+    float frameRate = mFrameRate;
+    if( idle && mIdleFrameRate > 0.f && wake > now ){
+        frameRate = math<float>::clamp( 1.0 / ( wake - now + 0.002 ), mIdleFrameRate, mFrameRate );
+    }
+    if( frameRate != getFrameRate() ) setFrameRate( frameRate );
+}
+
+void AtriumDisplayApp::drawScene(const Rectf &clip)
+{
+    gl::ScopedBlendAlpha  blendAlpha;
+    gl::clear();
+    gl::color(1.,1.,1.,1.);
+    
+    mRootLayer->draw( 1.f, clip );
+}
+
+void AtriumDisplayApp::drawProjectDetails(float alpha)
+{
+    if( ! mCurrentProject ) return;
+    
+    float margin = getCanvasHeight()/8.f;
+    
+    gl::pushMatrices();
+    
+    gl::translate(0,mHeaderMeasure.y+(margin*.375));
+    
+    // tags
+    
+    vec2 tagOffset = vec2(0,0);
+    
+    for(int i = 0; i < mCurrentProject->mTags.size(); i++ ){
+        if(boost::to_upper_copy( mCurrentProject->mTags[i] ) != "FEATURED"){
+            TextBox tagsBox;
+            tagsBox.setColor(ColorA(0.,0.,0.,1.));
+            tagsBox.setFont(mTagFont);
+            tagsBox.setText(boost::to_upper_copy( mCurrentProject->mTags[i] ));
+            Surface8u renderedTag = tagsBox.render();
+            vec2 tagMeasure = tagsBox.measure();
+            
+            gl::pushMatrices();
+            gl::translate(margin*.25, 0.);
+            gl::translate(tagOffset);
+            gl::color(1,1,1,alpha*.75);
+            gl::drawSolidRect(Rectf(margin,margin,tagMeasure.x+(margin*1.25),tagMeasure.y+(margin*1.0625)) );
+            gl::color(1.,1.,1.,alpha);
+            gl::draw(  createTexture( renderedTag, MemoryLedger::TEXT_CACHES ), vec2(margin*1.125, margin*1.03125) );
+            gl::popMatrices();
+            
+            tagOffset.x += tagMeasure.x+(margin*.375f);
+            if(tagOffset.x > (getCanvasWidth()/3.)-(3*margin)){
+                tagOffset.y+=mTagFont.getAscent()+mTagFont.getDescent()+(margin*.2);
+                tagOffset.x = 0;
+            }
         }
-        
-        Surface8u renderedSmall = smallBox.render();
-        vec2 smallMeasure = smallBox.measure();
-        
-        gl::color(1.,1.,1.,mProjectDetailsFade);
-        gl::draw(  gl::Texture::create( renderedSmall ), vec2(margin*1.25, getWindowHeight()-(smallMeasure.y+margin) ));
-        
     }
     
+    if(tagOffset.x > 0.)
+        tagOffset.y += mTagFont.getAscent()+mTagFont.getDescent()+(margin*.25);
+    
+    gl::translate(0, tagOffset.y);
+    
+    // summary
+    
+    TextBox summaryBox;
+    summaryBox.setSize(ivec2((getCanvasWidth()/3.)-(2.5*margin), getCanvasHeight()-(2.5*margin)-mHeaderMeasure.y));
+    summaryBox.setColor(ColorA(1.,1.,1.,1.));
+    summaryBox.setFont(mParagraphFont);
+    summaryBox.setText(mCurrentProject->mSummary);
+    Surface8u renderedSummary = summaryBox.render();
+    vec2 summaryMeasure = summaryBox.measure();
+    // show background box when there's a full texture
+    /*
+     gl::color(0.1,0.1,0.1,mFullTexture.mFade*.75*mProjectTextFade);
+     gl::drawSolidRect(Rectf(margin,margin,summaryMeasure.x+(margin*1.5),summaryMeasure.y+(margin*1.25)) );
+     */
+    gl::color(1.,1.,1.,alpha);
+    gl::draw(  createTexture( renderedSummary, MemoryLedger::TEXT_CACHES ), vec2(margin*1.25, margin*1.125 ));
+    
+    gl::translate(0, summaryMeasure.y + (margin*.375));
+    
+    gl::popMatrices();
+    
+    // small text
+    
+    TextBox smallBox;
+    smallBox.setSize(ivec2((getCanvasWidth()/3.)-(2.5*margin), getCanvasHeight()-(2.5*margin)-mHeaderMeasure.y));
+    smallBox.setColor(ColorA(1.,1.,1.,1.));
+    smallBox.setFont(mSmallFont);
+    
+    if(!mCurrentProject->mDate.is_not_a_date()){
+        boost::gregorian::date_facet* facet(new boost::gregorian::date_facet("%B %Y"));
+        stringstream ss;
+        ss.imbue(std::locale(std::cout.getloc(), facet));
+        ss << mCurrentProject->mDate;
+        smallBox.setText(ss.str());
+    }
+    
+    if(mCurrentProject->mHomepageURL.str().size() > 7){
+        smallBox.appendText(" | " + mCurrentProject->mHomepageURL.str());
+    }
+    for(int i = 0; i < mCurrentProject->mParticipants.size(); i++ ){
+        smallBox.appendText(" | ");
+        smallBox.appendText(mCurrentProject->mParticipants[i] );
+    }
+    
+    Surface8u renderedSmall = smallBox.render();
+    vec2 smallMeasure = smallBox.measure();
+    
+    gl::color(1.,1.,1.,alpha);
+    gl::draw(  createTexture( renderedSmall, MemoryLedger::TEXT_CACHES ), vec2(margin*1.25, getCanvasHeight()-(smallMeasure.y+margin) ));
+}
+
+void AtriumDisplayApp::drawPanels(float alpha)
+{
     gl::color(1.,1.,1.,1.);
     
-    mLeftTexture.draw();
-    mMidTexture.draw();
-    mRightTexture.draw();
-    mFullTexture.draw();
+    FadingTexture * const panels[] = { &mLeftTexture, &mMidTexture, &mRightTexture, &mFullTexture };
+    
+    if( ! mUsePanelCompositor || ! mPanelCompositor.draw( panels, 4 ) ){
+        for(FadingTexture *panel : panels) panel->draw();
+    }
+}
+
+void AtriumDisplayApp::drawStripes(float alpha)
+{
+    int numLayers = mQuality.getLevel().mStripeLayers;
+    float layerAlpha = alpha/max(numLayers-1.f, 1.f);
+    
+    Color yellow(1., .9, .0);
+    Color snowbackground(.05, .0, 0.666);
+    Color blue(0., .4, .75);
+    
+    ColorA layerColor(yellow, layerAlpha);
+    
+    if(mIsDecember){
+        // it's december
+        layerColor = ColorA(lerp(yellow, snowbackground, easeOutCubic(mStripesNoise)), layerAlpha);
+    }
+    
+    ColorA firstColor(lerp(yellow, blue, easeOutExpo(mStripesNoise)), alpha);
+    
+    mStripes.draw(numLayers, showTime(), mStripesNoise, mStripesSquareness, mStripesPosition, firstColor, layerColor, vec2(getCanvasSize()));
+    
+    if(mIsDecember){
+        // Snowflake stuff in december, drawn with the brightness the
+        // earlier once-per-stripe-layer draws added up to
+        mSnow->draw(mSimulation.getTime(), ColorA(1, 1, 0.6, min(easeInOutCubic(mStripesNoise)*0.65f*mStripeLayers, 1.f)));
+    }
+}
+
+void AtriumDisplayApp::drawProjectTitle(float alpha)
+{
+    if( ! mHeaderTexture ) return;
+    
+    float margin = getCanvasHeight()/8.f;
+    
+    gl::pushMatrices();
+    
+    // show background box when there's a full texture
+    gl::color(0.1,0.1,0.1,fmaxf(mFullTexture.mFade,mLeftTexture.mFade)*.75*alpha);
+    gl::drawSolidRect(Rectf(margin,margin,mHeaderMeasure.x+(margin*1.5),mHeaderMeasure.y+margin));
+    gl::color(1.,1.,1.,alpha);
+    gl::draw(  mHeaderTexture, vec2(margin*1.25, margin));
+    
+    gl::popMatrices();
+}
+
+void AtriumDisplayApp::drawMovie(float alpha)
+{
+    float margin = getCanvasHeight()/8.f;
     
-    if(mStripesFade > 0.0001){
+    if( mMovieFrameTexture ) {
         
-        int numLayers = 3;
+        gl::color( 0.05, 0.05, 0.05, alpha*.75 );
         
-        gl::color(1.,.9,0., mStripesFade/(numLayers-1.f));
+        gl::drawSolidRect(Rectf(getCanvasWidth()/3.f, 0, getCanvasWidth(), getCanvasHeight()));
         
-        float noiseX;
-        float segmentWidth = getWindowWidth() / 6.f;
+        // movie
         
-        for (int i = 0; i < numLayers; i++){
-            
-            vector<PolyLine2f> stripe;
-            
-            for (int j = 0; j < 3; j++){
-                
-                stripe.push_back( PolyLine2f() );
-                
-                noiseX = (perlin.noise(getElapsedSeconds()*.12*.25, 4*(i+1)*(j+1), 2));
-                noiseX = lerp(noiseX, noiseX-1.f, mStripesSquareness);
-                noiseX *= mStripesNoise*segmentWidth*(5+i);
-                stripe.back().push_back( vec2( lerp(segmentWidth,0.f,mStripesSquareness)+noiseX, 0 ) );
-                
-                noiseX = (perlin.noise(getElapsedSeconds()*.19*.25, 4*(i+1)*(j+1), 1.5));
-                noiseX = lerp(noiseX, noiseX+1.f, mStripesSquareness);
-                noiseX *= mStripesNoise*segmentWidth*(5+i);
-                stripe.back().push_back( vec2( (getWindowWidth()/3.)+noiseX, 0 ) );
-                
-                noiseX = (perlin.noise(getElapsedSeconds()*.13*.25, 4*(i+1)*(j+1), 37));
-                noiseX = lerp(noiseX, noiseX+1.f, mStripesSquareness);
-                noiseX *= mStripesNoise*segmentWidth*(5+i);
-                stripe.back().push_back( vec2( ((getWindowWidth()/3.)-lerp(segmentWidth,0.f,mStripesSquareness))+noiseX, getWindowHeight() ) );
-                
-                noiseX = (perlin.noise(getElapsedSeconds()*.15*.25, 4*(i+1)*(j+1), 3.33));
-                noiseX = lerp(noiseX, noiseX-1.f, mStripesSquareness);
-                noiseX *= mStripesNoise*segmentWidth*(5+i);
-                stripe.back().push_back( vec2( noiseX, getWindowHeight()) );
-                
-                
-            }
-            
-            gl::color(1., .9,.0, mStripesFade/(numLayers-1.f));
-            
-            Color yellow(1., .9, .0);
-            Color snowbackground(.05, .0, 0.666);
-            Color blue(0., .4, .75);
-            
-            if(now->tm_mon == 11){
-                // it's december
-                
-                gl::color(lerp(yellow.r, snowbackground.r, easeOutCubic(mStripesNoise)),
-                          lerp(yellow.g, snowbackground.g, easeOutCubic(mStripesNoise)),
-                          lerp(yellow.b, snowbackground.b, easeOutCubic(mStripesNoise)),
-                          mStripesFade/(numLayers-1.f));
-            } else {
-                gl::color(yellow.r, yellow.g, yellow.b, mStripesFade/(numLayers-1.f));
-            }
+        Rectf movieRect = Rectf(getCanvasWidth()/3.f, 0, getCanvasWidth()*2.f/3.f, (getCanvasWidth()/3.f)/mMovieFrameTexture->getAspectRatio());
+        
+        gl::color( mTintColor.r, mTintColor.g, mTintColor.b, alpha );
+        
+        gl::draw( mMovieFrameTexture, movieRect);
+        {
+            gl::ScopedBlendAdditive  blendAdditive;
+            gl::color( 1.0-mTintColor.r, 1.0-mTintColor.g, 1.0-mTintColor.b, alpha*.5 );
+            gl::drawSolidRect(movieRect);
+        }
+        
+        // subtitles
+        
+        if(mMovieSubtitles.getNumChildren() > 0){
             
-            if(i==0){
-                gl::color(lerp(yellow.r, blue.r, easeOutExpo(mStripesNoise)),
-                          lerp(yellow.g, blue.g, easeOutExpo(mStripesNoise)),
-                          lerp(yellow.b, blue.b, easeOutExpo(mStripesNoise)), mStripesFade);
-            }
-            gl::pushMatrices();
-            gl::translate(((vec2)mStripesPosition).x * getWindowWidth()*(1.f+(i/numLayers)), ((vec2)mStripesPosition).y * getWindowHeight());
-            gl::drawSolid(stripe.at(0));
-            gl::translate(getWindowWidth()/3., 0);
-            gl::drawSolid(stripe.at(1));
-            gl::translate(getWindowWidth()/3., 0);
-            gl::drawSolid(stripe.at(2));
-            gl::popMatrices();
+            float currentMovieTime = mMovie->getCurrentTime();
             
-            if(now->tm_mon == 11){
-                // Snowflake stuff in december
+            if(currentMovieTime > mMovieSubtitlesNextSubTime){
                 
-                float snowScale = getWindowHeight()*0.04;
+                mMovieSubtitlesSurface.create(10, 10, true);
                 
-                if(mSnowflakes.size() < 100) {
-                    if(randFloat() < 0.1){
-                        mSnowflakes.push_back(Snowflake());
-                        mSnowflakes.back().radius = (0.4*snowScale) + randFloat(snowScale);
-                        mSnowflakes.back().position.x = randFloat(getWindowWidth());
-                        mSnowflakes.back().position.y = - (mSnowflakes.back().radius);
-                        mSnowflakes.back().speed.x = randFloat(-1.0, 1.0);
-                        mSnowflakes.back().speed.y = randFloat(0.0, 1.0);
+                for(JsonTree subtitle : mMovieSubtitles){
+                    if(subtitle.getChild("timestamp_begin").getValue<float>() < currentMovieTime &&
+                       subtitle.getChild("timestamp_end").getValue<float>() > currentMovieTime ){
+                        // in a subtitle
+                        string subtitleString = "";
+                        for(JsonTree line : subtitle.getChild("text").getChildren()){
+                            subtitleString.append(line.getValue<std::string>());
+                            subtitleString.append("\n");
+                        }
+                        
+                        TextBox subtitleBox;
+                        subtitleBox.setColor(ColorA(1.,1.,1.,1.));
+                        subtitleBox.setFont(mParagraphFont);
+                        subtitleBox.setText(subtitleString);
+                        mMovieSubtitlesSurface = subtitleBox.render();
+                        mMovieSubtitlesNextSubTime = subtitle.getChild("timestamp_end").getValue<float>();
+                        break;
+                    }
+                    if(subtitle.getChild("timestamp_begin").getValue<float>() > currentMovieTime){
+                        // before a subtitle
+                        string subtitleString = "";
+                        TextBox subtitleBox;
+                        subtitleBox.setColor(ColorA(1.,1.,1.,1.));
+                        subtitleBox.setFont(mParagraphFont);
+                        subtitleBox.setText(subtitleString);
+                        mMovieSubtitlesSurface = subtitleBox.render();
+                        mMovieSubtitlesNextSubTime = subtitle.getChild("timestamp_begin").getValue<float>();
+                        break;
+                    }
+                    if(subtitle.getChild("timestamp_end").getValue<float>() < currentMovieTime &&
+                       subtitle.getChild("timestamp_end").getValue<float>() == mMovieSubtitles[mMovieSubtitles.getNumChildren()-1].getChild("timestamp_end").getValue<float>()){
+                        // after a subtitle (should only trigger after last title)
+                        string subtitleString = "";
+                        TextBox subtitleBox;
+                        subtitleBox.setColor(ColorA(1.,1.,1.,1.));
+                        subtitleBox.setFont(mParagraphFont);
+                        subtitleBox.setText(subtitleString);
+                        mMovieSubtitlesSurface = subtitleBox.render();
+                        mMovieSubtitlesNextSubTime = mMovie->getDuration();
+                        break;
                     }
                 }
                 
-                int iSnowflake = 0;
+            }
+            if(mMovieSubtitlesSurface.getWidth() > 11.0){
                 
-                float snowNoiseTime = getElapsedSeconds()*.1;
+                // draw subtitle background
                 
-                for (Snowflake & sf : mSnowflakes) {
-                    vec2 forces(perlin.noise(snowNoiseTime, iSnowflake++*.005),
-                                1.0);
-                    
-                    sf.speed *= 0.975;
-                    sf.speed.x = forces.x * snowScale * 0.5 / sf.radius;
-                    sf.speed.y = forces.y * snowScale * 0.5 / sf.radius;
-                    sf.speed.x += ((vec2)mStripesPosition).x * 1.75 * sf.radius;
-                    sf.position.x += sf.speed.x;
-                    sf.position.y = sf.position.y + sf.speed.y;
-                    
-                    
-                    if(sf.position.y > getWindowHeight() + sf.radius){
-                        sf.position.x = randFloat(getWindowWidth());
-                        sf.position.y = - sf.radius ;
-                        sf.speed.x = randFloat(-1, 1);
-                        sf.speed.y = randFloat(0, 1);
-                    }
-                    
-                    gl::color(1,1,0.6,easeInOutCubic(mStripesNoise)*0.65);
-                    
-                    gl::ScopedBlendAdditive  blendAdditive;
-                    gl::drawSolidCircle(sf.position, sf.radius);
-                }
+                gl::color(0.1,0.1,0.1,.5);
+                Rectf subtitleRect = Rectf(mLogoTexture->getBounds());
+                subtitleRect.offset(vec2((getCanvasWidth()/3.f)+margin, getCanvasHeight()-(margin+subtitleRect.getHeight())) );
+                gl::drawSolidRect(subtitleRect);
                 
+                // draw subtitle texture
+                
+                gl::color(1.,1.,1.,1.);
+                gl::draw(  createTexture( mMovieSubtitlesSurface, MemoryLedger::TEXT_CACHES ), vec2((getCanvasWidth()/3.f)+(margin*1.25), (getCanvasHeight()-(margin+(subtitleRect.getHeight()/2.)+(mMovieSubtitlesSurface.getHeight()/2.)))));
             }
-            
         }
-    }
-    
-    // PROJECT TITLE
-    
-    if(mProjectTitleFade > 0){
+        
+        // duration clock
+        
+        Rectf timeLineRect = Rectf(mLogoTexture->getBounds());
+        timeLineRect.offset(vec2((getCanvasWidth()*2.f/3.f)+margin, getCanvasHeight()-(margin+timeLineRect.getHeight())) );
+        
+        float timeOffset = (mMovie->getCurrentTime()/mMovie->getDuration());
+        
+        gl::color( .1f, .1f, .1f, .9f*alpha);
+        
+        gl::drawSolidRect(timeLineRect);
+        Area vp(timeLineRect.getOffset(vec2(0,-(timeLineRect.y1-margin)) ));
+        gl::pushViewport(vp.getUL(), vp.getSize());
         gl::pushMatrices();
+        gl::scale(getCanvasWidth()*1.0f/timeLineRect.getWidth(),getCanvasHeight()*1.0f/timeLineRect.getHeight() );
+        
+        vector<PolyLine2f> vedges;
+        float segmentWidth = timeLineRect.getHeight() * (16.f/9.f) * .5f;
+        
+        vedges.push_back( PolyLine2f() );
+        vedges.back().push_back( vec2( segmentWidth , 0 ) );
+        vedges.back().push_back( vec2( segmentWidth*2.f , 0 ) );
+        vedges.back().push_back( vec2( segmentWidth, timeLineRect.getHeight()) );
+        vedges.back().push_back( vec2( 0, timeLineRect.getHeight()) );
         
-        // show background box when there's a full texture
-        gl::color(0.1,0.1,0.1,fmaxf(mFullTexture.mFade,mLeftTexture.mFade)*.75*mProjectTitleFade);
-        gl::drawSolidRect(Rectf(margin,margin,headerMeasure.x+(margin*1.5),headerMeasure.y+margin));
-        gl::color(1.,1.,1.,mProjectTitleFade);
-        gl::draw(  gl::Texture::create( renderedHeader ), vec2(margin*1.25, margin));
+        gl::translate(lerp( -segmentWidth, timeLineRect.getWidth()-(segmentWidth*6.f),timeOffset),0.f);
+        for(float x = 0; x < timeLineRect.getWidth(); x+=segmentWidth*2.f){
+            gl::color( 1.f, .9f, .0f, alpha);
+            gl::drawSolid(vedges.at(0));
+            gl::translate(-segmentWidth,0);
+            gl::color( .0f, .0f, .0f, alpha);
+            gl::drawSolid(vedges.at(0));
+            gl::translate(-segmentWidth,0);
+        }
         
         gl::popMatrices();
         
+        gl::popViewport();
+        
+        gl::color( 1.f, 1.f, 1.f, alpha);
+        
+        float inverseDuration = mMovie->getDuration() - mMovie->getCurrentTime();
+        
+        TextBox movieBox;
+        movieBox.setSize(ivec2((getCanvasWidth()/3.)-(2*margin), getCanvasHeight()-(2*margin) ));
+        movieBox.setFont( mHeaderFont );
+        movieBox.setColor(ColorA(1.,1.,1.,1.));
+        movieBox.setText(str( (boost::format("%1$02d:%2$02d:%3$02d") % floor(inverseDuration/60.f) % floor(fmodf(inverseDuration,60.f)) % floor(fmodf(inverseDuration,1.f)*mMovie->getFramerate()) )));
+        vec2 movieMeasure = movieBox.measure();
+        Surface8u rendered = movieBox.render();
+        gl::draw(  createTexture( rendered, MemoryLedger::TEXT_CACHES ), vec2((getCanvasWidth()-margin)-movieMeasure.x, (timeLineRect.getY1()+((timeLineRect.getHeight()-movieMeasure.y)/2.f))));
+    }
+}
+
+void AtriumDisplayApp::drawTaglines(float alpha)
+{
+    float margin = getCanvasHeight()/8.f;
+    
+    if(mIsDecember) // it's december
+        gl::color(1.,1.,1.,alpha);
+    else
+        gl::color(0.,0.,0.,alpha);
+    gl::pushMatrices();
+    
+    TextBox headerBox;
+    headerBox.setSize(ivec2((getCanvasWidth()/3.)-(2*margin), getCanvasHeight()-(2*margin) ));
+    headerBox.setFont( mHeaderFont );
+    if(mIsDecember) // it's december
+        headerBox.setColor(ColorA(1.,1.,1.,1.));
+    else
+        headerBox.setColor(ColorA(0.,0.,0.,1.));
+    headerBox.setText(mTaglineStrings.at(mTaglineStringPos));
+    
+    vec2 headerMeasure = headerBox.measure();
+    
+    Surface8u rendered = headerBox.render();
+    gl::draw(  createTexture( rendered, MemoryLedger::TEXT_CACHES ), vec2(margin, getCanvasHeight()-(margin+headerMeasure.y)+mHeaderFont.getDescent()));
+    
+    gl::popMatrices();
+}
+
+void AtriumDisplayApp::drawSchedule(float alpha)
+{
+    float margin = getCanvasHeight()/8.f;
+    
+    // Schedule
+    
+    if(mIsDecember) // it's december
+        gl::color(1.,1.,1.,alpha);
+    else
+        gl::color(0.,0.,0.,alpha);
+    
+    TextLayout calendarLayout;
+    
+    if(mIsDecember){ // it's december
+        calendarLayout.clear( ColorA( 1.f, 1.f, 1.f, 0.f ) );
+        calendarLayout.setColor(ColorA(1.,1.,1.,1.));
+    } else {
+        calendarLayout.clear( ColorA( 0.f, 0.f, 0.f, 0.f ) );
+        calendarLayout.setColor(ColorA(0.,0.,0.,1.));
     }
     
-    // MOVIE PLAYER
+    ::Event *CurrentEvent;
+    ICalendar::Query SearchQuery(mTimeEditCalendar);
+    
+    SearchQuery.Criteria.From.SetToNow();
+    SearchQuery.Criteria.From[HOUR] = 0;
+    SearchQuery.Criteria.From[MINUTE] = 0;
+    SearchQuery.Criteria.From[SECOND] = 0;
+    SearchQuery.Criteria.To.SetToNow();
+    SearchQuery.Criteria.To[DAY] += 31;
+    SearchQuery.Criteria.To[HOUR] = 0;
+    SearchQuery.Criteria.To[MINUTE] = 0;
+    SearchQuery.Criteria.To[SECOND] = 0;
+    
+    SearchQuery.ResetPosition();
     
-    if(mMovieFade > 0){
+    Surface8u calendarRendered;
+    
+    int calendarItemCount = 0;
+    int calendarDaysCount = 0;
+    Date lastDate;
+    lastDate.SetToNow();
+    lastDate[DAY] -= 2;
+    
+    while ((CurrentEvent = SearchQuery.GetNextEvent(false)) != NULL) {
         
-        if( mMovieFrameTexture ) {
-            
-            gl::color( 0.05, 0.05, 0.05, mMovieFade*.75 );
-            
-            gl::drawSolidRect(Rectf(getWindowWidth()/3.f, 0, getWindowWidth(), getWindowHeight()));
-            
-            // movie
-            
-            Rectf movieRect = Rectf(getWindowWidth()/3.f, 0, getWindowWidth()*2.f/3.f, (getWindowWidth()/3.f)/mMovieFrameTexture->getAspectRatio());
-            
-            gl::color( mTintColor.r, mTintColor.g, mTintColor.b, mMovieFade );
-            
-            gl::draw( mMovieFrameTexture, movieRect);
-            {
-                gl::ScopedBlendAdditive  blendAdditive;
-                gl::color( 1.0-mTintColor.r, 1.0-mTintColor.g, 1.0-mTintColor.b, mMovieFade*.5 );
-                gl::drawSolidRect(movieRect);
-            }
-            
-            // subtitles
-            
-            if(mMovieSubtitles.getNumChildren() > 0){
-                
-                float currentMovieTime = mMovie->getCurrentTime();
-                
-                if(currentMovieTime > mMovieSubtitlesNextSubTime){
-                    
-                    mMovieSubtitlesSurface.create(10, 10, true);
-                    
-                    for(JsonTree subtitle : mMovieSubtitles){
-                        if(subtitle.getChild("timestamp_begin").getValue<float>() < currentMovieTime &&
-                           subtitle.getChild("timestamp_end").getValue<float>() > currentMovieTime ){
-                            // in a subtitle
-                            string subtitleString = "";
-                            for(JsonTree line : subtitle.getChild("text").getChildren()){
-                                subtitleString.append(line.getValue<std::string>());
-                                subtitleString.append("\n");
-                            }
-                            
-                            TextBox subtitleBox;
-                            subtitleBox.setColor(ColorA(1.,1.,1.,1.));
-                            subtitleBox.setFont(mParagraphFont);
-                            subtitleBox.setText(subtitleString);
-                            mMovieSubtitlesSurface = subtitleBox.render();
-                            mMovieSubtitlesNextSubTime = subtitle.getChild("timestamp_end").getValue<float>();
-                            break;
-                        }
-                        if(subtitle.getChild("timestamp_begin").getValue<float>() > currentMovieTime){
-                            // before a subtitle
-                            string subtitleString = "";
-                            TextBox subtitleBox;
-                            subtitleBox.setColor(ColorA(1.,1.,1.,1.));
-                            subtitleBox.setFont(mParagraphFont);
-                            subtitleBox.setText(subtitleString);
-                            mMovieSubtitlesSurface = subtitleBox.render();
-                            mMovieSubtitlesNextSubTime = subtitle.getChild("timestamp_begin").getValue<float>();
-                            break;
-                        }
-                        if(subtitle.getChild("timestamp_end").getValue<float>() < currentMovieTime &&
-                           subtitle.getChild("timestamp_end").getValue<float>() == mMovieSubtitles[mMovieSubtitles.getNumChildren()-1].getChild("timestamp_end").getValue<float>()){
-                            // after a subtitle (should only trigger after last title)
-                            string subtitleString = "";
-                            TextBox subtitleBox;
-                            subtitleBox.setColor(ColorA(1.,1.,1.,1.));
-                            subtitleBox.setFont(mParagraphFont);
-                            subtitleBox.setText(subtitleString);
-                            mMovieSubtitlesSurface = subtitleBox.render();
-                            mMovieSubtitlesNextSubTime = mMovie->getDuration();
-                            break;
-                        }
-                    }
-                    
-                }
-                if(mMovieSubtitlesSurface.getWidth() > 11.0){
-                    
-                    // draw subtitle background
-                    
-                    gl::color(0.1,0.1,0.1,.5);
-                    Rectf subtitleRect = Rectf(mLogoTexture->getBounds());
-                    subtitleRect.offset(vec2((getWindowWidth()/3.f)+margin, getWindowHeight()-(margin+subtitleRect.getHeight())) );
-                    gl::drawSolidRect(subtitleRect);
-                    
-                    // draw subtitle texture
-                    
-                    gl::color(1.,1.,1.,1.);
-                    gl::draw(  gl::Texture::create( mMovieSubtitlesSurface ), vec2((getWindowWidth()/3.f)+(margin*1.25), (getWindowHeight()-(margin+(subtitleRect.getHeight()/2.)+(mMovieSubtitlesSurface.getHeight()/2.)))));
+        if(lastDate[DAY] != CurrentEvent->DtStart[DAY] || lastDate[MONTH] != CurrentEvent->DtStart[MONTH]){
+            string dayString;
+            calendarDaysCount++;
+            Date now;
+            now.SetToNow();
+            if(now[DAY] == CurrentEvent->DtStart[DAY] && now[MONTH] == CurrentEvent->DtStart[MONTH]){
+                dayString.append("Today");
+            } else {
+                char TempDay[10];
+                sprintf(TempDay, "%.2d/%.2d/%4d", CurrentEvent->DtStart[DAY]+0, CurrentEvent->DtStart[MONTH]+0, CurrentEvent->DtStart[YEAR]+0);
+                boost::gregorian::date date(CurrentEvent->DtStart[YEAR]+0, CurrentEvent->DtStart[MONTH]+0, CurrentEvent->DtStart[DAY]+0);
+
+                switch (date.day_of_week()) {
+                    case 0:
+                        dayString.append("Sunday ");
+                        break;
+                    case 1:
+                        dayString.append("Monday ");
+                        break;
+                    case 2:
+                        dayString.append("Tuesday ");
+                        break;
+                    case 3:
+                        dayString.append("Wednesday ");
+                        break;
+                    case 4:
+                        dayString.append("Thursday ");
+                        break;
+                    case 5:
+                        dayString.append("Friday ");
+                        break;
+                    case 6:
+                        dayString.append("Saturday ");
+                        break;
                 }
+                dayString.append(TempDay,10);
             }
-            
-            // duration clock
-            
-            Rectf timeLineRect = Rectf(mLogoTexture->getBounds());
-            timeLineRect.offset(vec2((getWindowWidth()*2.f/3.f)+margin, getWindowHeight()-(margin+timeLineRect.getHeight())) );
-            
-            float timeOffset = (mMovie->getCurrentTime()/mMovie->getDuration());
-            
-            gl::color( .1f, .1f, .1f, .9f*mMovieFade);
-            
-            gl::drawSolidRect(timeLineRect);
-            Area vp(timeLineRect.getOffset(vec2(0,-(timeLineRect.y1-margin)) ));
-            gl::pushViewport(vp.getUL(), vp.getSize());
-            gl::pushMatrices();
-            gl::scale(getWindowWidth()*1.0f/timeLineRect.getWidth(),getWindowHeight()*1.0f/timeLineRect.getHeight() );
-            
-            vector<PolyLine2f> vedges;
-            float segmentWidth = timeLineRect.getHeight() * (16.f/9.f) * .5f;
-            
-            vedges.push_back( PolyLine2f() );
-            vedges.back().push_back( vec2( segmentWidth , 0 ) );
-            vedges.back().push_back( vec2( segmentWidth*2.f , 0 ) );
-            vedges.back().push_back( vec2( segmentWidth, timeLineRect.getHeight()) );
-            vedges.back().push_back( vec2( 0, timeLineRect.getHeight()) );
-            
-            gl::translate(lerp( -segmentWidth, timeLineRect.getWidth()-(segmentWidth*6.f),timeOffset),0.f);
-            for(float x = 0; x < timeLineRect.getWidth(); x+=segmentWidth*2.f){
-                gl::color( 1.f, .9f, .0f, mMovieFade);
-                gl::drawSolid(vedges.at(0));
-                gl::translate(-segmentWidth,0);
-                gl::color( .0f, .0f, .0f, mMovieFade);
-                gl::drawSolid(vedges.at(0));
-                gl::translate(-segmentWidth,0);
+            if(calendarItemCount > 0){
+                calendarLayout.setFont(mTagFont);
+                calendarLayout.addLine(" ");
             }
-            
-            gl::popMatrices();
-            
-            gl::popViewport();
-            
-            gl::color( 1.f, 1.f, 1.f, mMovieFade);
-            
-            float inverseDuration = mMovie->getDuration() - mMovie->getCurrentTime();
-            
-            TextBox movieBox;
-            movieBox.setSize(ivec2((getWindowWidth()/3.)-(2*margin), getWindowHeight()-(2*margin) ));
-            movieBox.setFont( mHeaderFont );
-            movieBox.setColor(ColorA(1.,1.,1.,1.));
-            movieBox.setText(str( (boost::format("%1$02d:%2$02d:%3$02d") % floor(inverseDuration/60.f) % floor(fmodf(inverseDuration,60.f)) % floor(fmodf(inverseDuration,1.f)*mMovie->getFramerate()) )));
-            vec2 movieMeasure = movieBox.measure();
-            Surface8u rendered = movieBox.render();
-            gl::draw(  gl::Texture::create( rendered ), vec2((getWindowWidth()-margin)-movieMeasure.x, (timeLineRect.getY1()+((timeLineRect.getHeight()-movieMeasure.y)/2.f))));
+            calendarLayout.setFont(mParagraphFontBold);
+            calendarLayout.addLine(dayString);
+            calendarLayout.setFont(mTagFont);
+            calendarLayout.setLeadingOffset(-mTagFont.getSize()*0.5);
+            calendarLayout.addLine("_____________________________________________________________________________________________________________________________________");
+            calendarLayout.setLeadingOffset(mTagFont.getSize()*0.5);
+            lastDate = CurrentEvent->DtStart;
         }
-    }
-    
-    // SECTION HEADERS (TAGLINES)
-    
-    if(mHeaderFade > 0){
-        if(now->tm_mon == 11) // it's december
-            gl::color(1.,1.,1.,mHeaderFade);
-        else
-            gl::color(0.,0.,0.,mHeaderFade);
-        gl::pushMatrices();
-        
-        TextBox headerBox;
-        headerBox.setSize(ivec2((getWindowWidth()/3.)-(2*margin), getWindowHeight()-(2*margin) ));
-        headerBox.setFont( mHeaderFont );
-        if(now->tm_mon == 11) // it's december
-            headerBox.setColor(ColorA(1.,1.,1.,1.));
-        else
-            headerBox.setColor(ColorA(0.,0.,0.,1.));
-        headerBox.setText(mTaglineStrings.at(mTaglineStringPos));
         
-        vec2 headerMeasure = headerBox.measure();
+        std::string calendarLine;
+        char Temp[13];
+        sprintf(Temp, "%.2d:%.2d - %.2d:%.2d", CurrentEvent->DtStart[HOUR]+0, CurrentEvent->DtStart[MINUTE]+0, CurrentEvent->DtEnd[HOUR]+0, CurrentEvent->DtEnd[MINUTE]+0 );
+        calendarLine.append(Temp, 13);
+        calendarLine.append("\t");
+        std::string summaryStr(CurrentEvent->Summary);
+        summaryStr = std::regex_replace (summaryStr, std::regex("\n"),"");
+        summaryStr = std::regex_replace (summaryStr, std::regex("\r"),"");
+        summaryStr = std::regex_replace (summaryStr, std::regex("\\\\)"),"");
+        summaryStr = std::regex_replace (summaryStr, std::regex("(.*)Activity:"),"");
+        summaryStr = std::regex_replace (summaryStr, std::regex("(.*), "),"");
+        summaryStr = std::regex_replace (summaryStr, std::regex(" - (.*)"),"");
         
-        Surface8u rendered = headerBox.render();
-        gl::draw(  gl::Texture::create( rendered ), vec2(margin, getWindowHeight()-(margin+headerMeasure.y)+mHeaderFont.getDescent()));
+        calendarLine.append(summaryStr);
         
-        gl::popMatrices();
+        calendarLayout.setFont(mParagraphFont);
+        calendarLayout.addLine(calendarLine);
+        calendarItemCount++;
+        if(calendarItemCount > 3 || calendarDaysCount > 2) break;
         
     }
     
-    if(mScheduleFade > 0){
-        
-        // Schedule
+    if(calendarItemCount > 0){
         
-        if(now->tm_mon == 11) // it's december
-            gl::color(1.,1.,1.,mScheduleFade);
-        else
-            gl::color(0.,0.,0.,mScheduleFade);
         
-        TextLayout calendarLayout;
+        TextLayout calendarHeaderLayout;
         
-        if(now->tm_mon == 11){ // it's december
-            calendarLayout.clear( ColorA( 1.f, 1.f, 1.f, 0.f ) );
-            calendarLayout.setColor(ColorA(1.,1.,1.,1.));
+        if(mIsDecember){ // it's december
+            calendarHeaderLayout.clear( ColorA( 1.f, 1.f, 1.f, 0.f ) );
+            calendarHeaderLayout.setColor(ColorA(1.,1.,1.,1.));
         } else {
-            calendarLayout.clear( ColorA( 0.f, 0.f, 0.f, 0.f ) );
-            calendarLayout.setColor(ColorA(0.,0.,0.,1.));
+            calendarHeaderLayout.clear( ColorA( 0.f, 0.f, 0.f, 0.f ) );
+            calendarHeaderLayout.setColor(ColorA(0.,0.,0.,1.));
         }
         
-        ::Event *CurrentEvent;
-        ICalendar::Query SearchQuery(mTimeEditCalendar);
-        
-        SearchQuery.Criteria.From.SetToNow();
-        SearchQuery.Criteria.From[HOUR] = 0;
-        SearchQuery.Criteria.From[MINUTE] = 0;
-        SearchQuery.Criteria.From[SECOND] = 0;
-        SearchQuery.Criteria.To.SetToNow();
-        SearchQuery.Criteria.To[DAY] += 31;
-        SearchQuery.Criteria.To[HOUR] = 0;
-        SearchQuery.Criteria.To[MINUTE] = 0;
-        SearchQuery.Criteria.To[SECOND] = 0;
+
+        calendarHeaderLayout.setFont( mHeaderFont );
+        calendarHeaderLayout.addLine("Upcoming Lab Bookings");
+        calendarHeaderLayout.setFont( mParagraphFont );
+        calendarHeaderLayout.addLine(" ");
+        calendarHeaderLayout.addLine("Intermedia Lab is not a classroom,");
+        calendarHeaderLayout.addLine("and outside these scheduled activities");
+        calendarHeaderLayout.addLine("the lab remains open for everyone");
+        calendarHeaderLayout.addLine("with a project in the space.");
+        calendarHeaderLayout.setFont( mParagraphFont );
+        calendarHeaderLayout.addLine(" ");
+        calendarHeaderLayout.addLine("To request access to the lab or to book a relevant activity");
+        calendarHeaderLayout.addLine("please send a mail to intermedia@itu.dk");
+
+                                     
+        Surface8u rendered = calendarHeaderLayout.render(true, PREMULT);
+        gl::draw(  createTexture( rendered, MemoryLedger::TEXT_CACHES ), vec2(margin, margin));
         
-        SearchQuery.ResetPosition();
+        TextBox commentBox;
+        commentBox.setSize(ivec2((getCanvasWidth()/3.)-(2*margin), getCanvasHeight()-(2*margin) ));
+        commentBox.setFont( mSmallFont );
+        if(mIsDecember) // it's december
+            commentBox.setColor(ColorA(1.,1.,1.,1.));
+        else
+            commentBox.setColor(ColorA(0.,0.,0.,1.));
+        commentBox.setText("Bookings are provided by a query for room 0A17 to the IT University TimeEdit system.");
         
-        Surface8u calendarRendered;
+        vec2 commentMeasure = commentBox.measure();
         
-        int calendarItemCount = 0;
-        int calendarDaysCount = 0;
-        Date lastDate;
-        lastDate.SetToNow();
-        lastDate[DAY] -= 2;
+        Surface8u renderedComments = commentBox.render();
+        gl::draw(  createTexture( renderedComments, MemoryLedger::TEXT_CACHES ), vec2((getCanvasWidth()/3.)+margin, getCanvasHeight()-(margin+commentMeasure.y)+mHeaderFont.getDescent()));
         
-        while ((CurrentEvent = SearchQuery.GetNextEvent(false)) != NULL) {
-            
-            if(lastDate[DAY] != CurrentEvent->DtStart[DAY] || lastDate[MONTH] != CurrentEvent->DtStart[MONTH]){
-                string dayString;
-                calendarDaysCount++;
-                Date now;
-                now.SetToNow();
-                if(now[DAY] == CurrentEvent->DtStart[DAY] && now[MONTH] == CurrentEvent->DtStart[MONTH]){
-                    dayString.append("Today");
-                } else {
-                    char TempDay[10];
-                    sprintf(TempDay, "%.2d/%.2d/%4d", CurrentEvent->DtStart[DAY]+0, CurrentEvent->DtStart[MONTH]+0, CurrentEvent->DtStart[YEAR]+0);
-                    boost::gregorian::date date(CurrentEvent->DtStart[YEAR]+0, CurrentEvent->DtStart[MONTH]+0, CurrentEvent->DtStart[DAY]+0);
-
-                    switch (date.day_of_week()) {
-                        case 0:
-                            dayString.append("Sunday ");
-                            break;
-                        case 1:
-                            dayString.append("Monday ");
-                            break;
-                        case 2:
-                            dayString.append("Tuesday ");
-                            break;
-                        case 3:
-                            dayString.append("Wednesday ");
-                            break;
-                        case 4:
-                            dayString.append("Thursday ");
-                            break;
-                        case 5:
-                            dayString.append("Friday ");
-                            break;
-                        case 6:
-                            dayString.append("Saturday ");
-                            break;
-                    }
-                    dayString.append(TempDay,10);
-                }
-                if(calendarItemCount > 0){
-                    calendarLayout.setFont(mTagFont);
-                    calendarLayout.addLine(" ");
-                }
-                calendarLayout.setFont(mParagraphFontBold);
-                calendarLayout.addLine(dayString);
-                calendarLayout.setFont(mTagFont);
-                calendarLayout.setLeadingOffset(-mTagFont.getSize()*0.5);
-                calendarLayout.addLine("_____________________________________________________________________________________________________________________________________");
-                calendarLayout.setLeadingOffset(mTagFont.getSize()*0.5);
-                lastDate = CurrentEvent->DtStart;
-            }
+        calendarRendered = calendarLayout.render( true, PREMULT );
+        gl::draw(  createTexture( calendarRendered, MemoryLedger::TEXT_CACHES ), vec2((getCanvasWidth()/3.)+margin, margin));
+    }
+}
+
+void AtriumDisplayApp::drawLogo(float alpha)
+{
+    float margin = getCanvasHeight()/8.f;
+    
+    gl::color(1.,1.,1.,alpha);
+    gl::draw( mLogoTexture, vec2( (getCanvasWidth()*2.f/3.f)+margin, (getCanvasHeight()-margin)-mLogoTexture->getHeight() ) );
+}
+
+void AtriumDisplayApp::drawLabTitle(float alpha)
+{
+    gl::color(1.,1.,1.,alpha);
+    // glyphs rendered at a lower resolution are scaled back up to size
+    gl::TextureFont::DrawOptions options = gl::TextureFont::DrawOptions().scale( 1.f / mTextScale );
+    vec2 stringDims = mTitleFontPrimary->measureString( "INTER", options );
+    mTitleFontPrimary->drawString( "INTER", vec2((getCanvasWidth()/3.)-(stringDims.x+20), getCanvasHeight()*0.65), options );
+    mTitleFontPrimary->drawString( "MEDIA", vec2((getCanvasWidth()/3.)+10, getCanvasHeight()*0.65), options );
+    mTitleFontSecondary->drawString( "LAB", vec2((getCanvasWidth()*2/3.)+10, getCanvasHeight()*0.65), options );
+}
+
+void AtriumDisplayApp::drawBorders(float alpha)
+{
+    gl::color(.3,.3,.3);
+    gl::drawLine(vec2(getCanvasWidth()/3., 0), vec2(getCanvasWidth()/3.,getCanvasHeight()));
+    gl::drawLine(vec2(getCanvasWidth()*2/3., 0), vec2(getCanvasWidth()*2/3.,getCanvasHeight()));
+}
+
+#pragma mark LOADING PROJECTS AND CONFIG
+
+void AtriumDisplayApp::scheduleTransition(float delay){
+    // on a follower, the time the leader scheduled
+    mNextTransitionTime = mTrace.steer( "at", showTime() + delay );
+    showTimeline().add( triggerTransition, mNextTransitionTime );
+}
+
+void AtriumDisplayApp::setupShow(){
+    
+    // what the show's cues can animate and which actions its states can run
+    mShow.addProperty( "titleFade", &mTitleFade );
+    mShow.addProperty( "stripesNoise", &mStripesNoise );
+    mShow.addProperty( "stripesPosition", &mStripesPosition );
+    mShow.addProperty( "stripesFade", &mStripesFade );
+    mShow.addProperty( "stripesSquareness", &mStripesSquareness );
+    mShow.addProperty( "logoFade", &mLogoFade );
+    mShow.addProperty( "headerFade", &mHeaderFade );
+    mShow.addProperty( "scheduleFade", &mScheduleFade );
+    mShow.addProperty( "projectTitleFade", &mProjectTitleFade );
+    mShow.addProperty( "projectDetailsFade", &mProjectDetailsFade );
+    mShow.addProperty( "movieFade", &mMovieFade );
+    
+    mShow.addAction( "nextTagline", [this]{
+        mTaglineStringPos = mTrace.steer( "tagline", int( (mTaglineStringPos+1)%mTaglineStrings.size() ) )%mTaglineStrings.size();
+        mTaglinesLayer->markDirty();
+    } );
+    mShow.addAction( "nextProject", [this]{
+        if(mThread.get()){
+            mThread->join();
+        }
+        loadNextProject();
+        // create and launch the thread
+        mThread = shared_ptr<thread>( new thread( bind( &AtriumDisplayApp::loadImagesThreadFn, this ) ) );
+    } );
+    mShow.addAction( "refreshCalendar", [this]{ refreshCalendar(); } );
+    mShow.addAction( "refreshSchedule", [this]{
+        mScheduleLayer->markDirty(); // "Today" moves with the date
+    } );
+    
+    if( ! mShowYaml || ! mShow.load( mShowYaml ) ){
+        mShow.load( YAML::Load( sDefaultShow ) );
+    }
+    mTransitionStateNext = mShow.getStart();
+}
+
+// whether the slideshow turns to the project's next movie instead of a slide
+bool AtriumDisplayApp::isMovieDue() const {
+    return mFadedTextureFadeCount > 2 && mFadedTextureFadeCount % 2 == 1 && mCurrentProject && ! mCurrentProject->mMovies.empty();
+}
+
+void AtriumDisplayApp::updateMediaDeadline(){
+    // the show knows how long the states before the next slide or movie run
+    double untilMedia = mShow.getTimeUntilMedia( mTransitionStateNext );
+    if( untilMedia >= 0 && mNextTransitionTime < numeric_limits<double>::max() ){
+        mMediaDeadline = mNextTransitionTime + untilMedia;
+    }
+}
+
+void AtriumDisplayApp::refreshCalendar(){
+    
+    // the benchmark and replays stay off the network
+    if( mVirtualClock ) return;
+    
+    // a config reload may move the files while the block runs
+    fs::path calendarFile = mTimeEditCalendarFile, calendarTmpFile = mTimeEditCalendarTmpFile;
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        try {
             
-            std::string calendarLine;
-            char Temp[13];
-            sprintf(Temp, "%.2d:%.2d - %.2d:%.2d", CurrentEvent->DtStart[HOUR]+0, CurrentEvent->DtStart[MINUTE]+0, CurrentEvent->DtEnd[HOUR]+0, CurrentEvent->DtEnd[MINUTE]+0 );
-            calendarLine.append(Temp, 13);
-            calendarLine.append("\t");
-            std::string summaryStr(CurrentEvent->Summary);
-            summaryStr = std::regex_replace (summaryStr, std::regex("\n"),"");
-            summaryStr = std::regex_replace (summaryStr, std::regex("\r"),"");
-            summaryStr = std::regex_replace (summaryStr, std::regex("\\\\)"),"");
-            summaryStr = std::regex_replace (summaryStr, std::regex("(.*)Activity:"),"");
-            summaryStr = std::regex_replace (summaryStr, std::regex("(.*), "),"");
-            summaryStr = std::regex_replace (summaryStr, std::regex(" - (.*)"),"");
+            std::string iCalStr = loadString(loadUrl("http://intermedia.itu.dk/public/calendar/timeEditIcs.php"));
+            std::string myPath = calendarFile.string();
             
-            calendarLine.append(summaryStr);
+            // Get an ofstream which is what you'll use to write to your file.
+            std::ofstream oStream( myPath );
             
-            calendarLayout.setFont(mParagraphFont);
-            calendarLayout.addLine(calendarLine);
-            calendarItemCount++;
-            if(calendarItemCount > 3 || calendarDaysCount > 2) break;
+            // write the string.
+            oStream << iCalStr;
+            oStream.close();
             
-        }
-        
-        if(calendarItemCount > 0){
+            ICalendar tmpCalendar(calendarFile.string().c_str());
             
+            ::Event *CurrentEvent;
+            ICalendar::Query SearchQuery(&tmpCalendar);
             
-            TextLayout calendarHeaderLayout;
+            SearchQuery.Criteria.From.SetToNow();
+            SearchQuery.Criteria.From[HOUR] = 0;
+            SearchQuery.Criteria.From[MINUTE] = 0;
+            SearchQuery.Criteria.From[SECOND] = 0;
+            SearchQuery.Criteria.To.SetToNow();
+            SearchQuery.Criteria.To[MONTH] += 6;
+            SearchQuery.Criteria.To[HOUR] = 0;
+            SearchQuery.Criteria.To[MINUTE] = 0;
+            SearchQuery.Criteria.To[SECOND] = 0;
             
-            if(now->tm_mon == 11){ // it's december
-                calendarHeaderLayout.clear( ColorA( 1.f, 1.f, 1.f, 0.f ) );
-                calendarHeaderLayout.setColor(ColorA(1.,1.,1.,1.));
-            } else {
-                calendarHeaderLayout.clear( ColorA( 0.f, 0.f, 0.f, 0.f ) );
-                calendarHeaderLayout.setColor(ColorA(0.,0.,0.,1.));
-            }
+            SearchQuery.ResetPosition();
             
-
-            calendarHeaderLayout.setFont( mHeaderFont );
-            calendarHeaderLayout.addLine("Upcoming Lab Bookings");
-            calendarHeaderLayout.setFont( mParagraphFont );
-            calendarHeaderLayout.addLine(" ");
-            calendarHeaderLayout.addLine("Intermedia Lab is not a classroom,");
-            calendarHeaderLayout.addLine("and outside these scheduled activities");
-            calendarHeaderLayout.addLine("the lab remains open for everyone");
-            calendarHeaderLayout.addLine("with a project in the space.");
-            calendarHeaderLayout.setFont( mParagraphFont );
-            calendarHeaderLayout.addLine(" ");
-            calendarHeaderLayout.addLine("To request access to the lab or to book a relevant activity");
-            calendarHeaderLayout.addLine("please send a mail to intermedia@itu.dk");
-
-                                         
-            Surface8u rendered = calendarHeaderLayout.render(true, PREMULT);
-            gl::draw(  gl::Texture::create( rendered ), vec2(margin, margin));
+            fs::remove(calendarTmpFile);
             
-            TextBox commentBox;
-            commentBox.setSize(ivec2((getWindowWidth()/3.)-(2*margin), getWindowHeight()-(2*margin) ));
-            commentBox.setFont( mSmallFont );
-            if(now->tm_mon == 11) // it's december
-                commentBox.setColor(ColorA(1.,1.,1.,1.));
-            else
-                commentBox.setColor(ColorA(0.,0.,0.,1.));
-            commentBox.setText("Bookings are provided by a query for room 0A17 to the IT University TimeEdit system.");
+            ICalendar *calendar = new ICalendar(calendarTmpFile.string().c_str());
             
-            vec2 commentMeasure = commentBox.measure();
+            while ((CurrentEvent = SearchQuery.GetNextEvent(false)) != NULL) {
+                //Correct for missing time zone
+                CurrentEvent->DtStart[HOUR] +=1;
+                CurrentEvent->DtEnd[HOUR] +=1;
+                
+                calendar->AddEvent(new ::Event(*CurrentEvent));
+            }
             
-            Surface8u renderedComments = commentBox.render();
-            gl::draw(  gl::Texture::create( renderedComments ), vec2((getWindowWidth()/3.)+margin, getWindowHeight()-(margin+commentMeasure.y)+mHeaderFont.getDescent()));
+            calendar->Sort();
+            // the events, about as large as the calendar they came from
+            int64_t bytes = fileBytes( calendarFile );
             
-            calendarRendered = calendarLayout.render( true, PREMULT );
-            gl::draw(  gl::Texture::create( calendarRendered ), vec2((getWindowWidth()/3.)+margin, margin));
-        }
-    }
-    
-    // ITU LOGO
-    
-    if(mLogoFade > 0){
-        
-        gl::color(1.,1.,1.,mLogoFade);
-        gl::draw( mLogoTexture, vec2( (getWindowWidth()*2.f/3.f)+margin, (getWindowHeight()-margin)-mLogoTexture->getHeight() ) );
+            // swapped in on the main thread, which draws the schedule from it
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if(calendarTmpFile != mTimeEditCalendarTmpFile){
+                    // the resource path moved on, its own refresh is under way
+                    delete calendar;
+                    return;
+                }
+                delete mTimeEditCalendar;
+                mTimeEditCalendar = calendar;
+                mCalendarMemory.set( bytes );
+                mCalendarFetched = getElapsedSeconds();
+                mCalendarChanged = true;
+            });
         
-    }
-    
-    // INTERMEDIA LAB TITLE
-    
-    gl::color(1.,1.,1.,mTitleFade);
-    vec2 stringDims = mTitleFontPrimary->measureString( "INTER" );
-    mTitleFontPrimary->drawString( "INTER", vec2((getWindowWidth()/3.)-(stringDims.x+20), getWindowHeight()*0.65) );
-    mTitleFontPrimary->drawString( "MEDIA", vec2((getWindowWidth()/3.)+10, getWindowHeight()*0.65) );
-    mTitleFontSecondary->drawString( "LAB", vec2((getWindowWidth()*2/3.)+10, getWindowHeight()*0.65) );
-    
-    
-    // SCREEN SEPERATOR BORDERS
-    
-    gl::color(.3,.3,.3);
-    gl::drawLine(vec2(getWindowWidth()/3., 0), vec2(getWindowWidth()/3.,getWindowHeight()));
-    gl::drawLine(vec2(getWindowWidth()*2/3., 0), vec2(getWindowWidth()*2/3.,getWindowHeight()));
+        } catch (std::exception& e) {
+            console() << e.what() << endl;
+        }
     
+    });
 }
 
-#pragma mark LOADING PROJECTS AND CONFIG
-
 bool AtriumDisplayApp::readConfig(){
     
     // load configuration file and find ressource path
     configYaml = YAML::LoadFile(Platform::get()->getResourcePath(RES_CUSTOM_YAML_CONFIG).c_str());
+    mConfigMemory.set( fileBytes( Platform::get()->getResourcePath(RES_CUSTOM_YAML_CONFIG) ) );
+    if( mBenchmark ){
+        configYaml["resourcePath"] = mBenchmarkFixtures.string();
+    }
     if(configYaml["resourcePath"]){
         configResourcePath = fs::path(expand_user(configYaml["resourcePath"].as<std::string>()));
         
@@ -1416,53 +7495,8 @@ bool AtriumDisplayApp::readConfig(){
                         
                     } else if (resIt->filename() == "projects" ){
                         
-                        // projects are loaded in reverse cronological order
-                        
-                        paths prjPaths;
-                        copy(fs::directory_iterator(*resIt), fs::directory_iterator(), back_inserter(prjPaths));
-                        sort(prjPaths.begin(), prjPaths.end());
-                        reverse(prjPaths.begin(), prjPaths.end());
-                        
-                        mProjects.clear();
+                        mProjects = scanProjects(*resIt);
                         mCurrentProject = NULL;
-                        
-                        int totalProjects = 0;
-                        
-                        console() << "Loading projects from " << resIt->relative_path() << endl << endl;
-                        
-                        for (paths::const_iterator prjIt (prjPaths.begin()); prjIt != prjPaths.end(); ++prjIt)
-                        {
-                            if (fs::is_directory(*prjIt)) {
-                                
-                                if(! boost::starts_with(prjIt->filename().string(), "_")) {
-                                    
-                                    Project *p = new Project(*prjIt);
-                                    
-                                    // Filter projects
-                                    
-                                    bool published = false;
-                                    
-                                    totalProjects++;
-                                    
-                                    for(int i = 0; i < p->mPublished.size(); i++ ){
-                                        if(boost::to_upper_copy( p->mPublished[i] ) == "DISPLAYS"){
-                                            published = true;
-                                            break;
-                                        }
-                                    }
-                                    
-                                    if(published){
-                                        console() << " + " << p->mTitle << endl;
-                                        mProjects.push_back(p);
-                                    } else {
-                                        console() << " - " << p->mTitle << endl;
-                                        delete p;
-                                    }
-                                }
-                                
-                            }
-                        }
-                        console() << endl <<  mProjects.size() << " projects loaded for displays of " << totalProjects << " total projects" << endl << endl;
                     }
                     
                 } else {
@@ -1470,18 +7504,22 @@ bool AtriumDisplayApp::readConfig(){
                         
                         // user-defined configuration
                         
-                        YAML::Node labYaml = YAML::LoadFile(resIt->c_str());
+                        MemoryEntry document( MemoryLedger::YAML_DOCUMENTS, fileBytes( *resIt ) );
+                        YAML::Node labYaml = YAML::Load(loadString(gMediaIO.open(*resIt)));
+                        mLabYaml = labYaml;
                         
                         if (labYaml["taglines"]) {
                             
                             // taglines
                             
-                            mTaglineStrings.clear();
-                            mTaglineStringPos = 0;
+                            setTaglines(labYaml["taglines"]);
+                        }
+                        
+                        if (labYaml["show"]) {
+                            
+                            // replaces the built-in show, see Show
                             
-                            for(YAML::iterator tagIt=labYaml["taglines"].begin();tagIt!=labYaml["taglines"].end();++tagIt) {
-                                mTaglineStrings.push_back(tagIt->as<std::string>());
-                            }
+                            mShowYaml = labYaml["show"];
                         }
                         
                     }
@@ -1503,6 +7541,190 @@ bool AtriumDisplayApp::readConfig(){
     
 }
 
+// Reads config.yaml and lab.yaml again after an edit, on the watcher's
+// queue. A new resource path has its projects scanned here as well, so the
+// main thread only swaps them in.
+void AtriumDisplayApp::reloadConfig(){
+    
+    fs::path configPath = Platform::get()->getResourcePath(RES_CUSTOM_YAML_CONFIG);
+    auto pending = make_shared<PendingConfig>();
+    try {
+        pending->mConfig = YAML::Load(loadString(loadFile(configPath)));
+        pending->mResourcePath = fs::path(expand_user(pending->mConfig["resourcePath"].as<std::string>()));
+        
+        // converted and checked here, so applying them can't fail
+        const YAML::Node &config = pending->mConfig;
+        pending->mFrameRate = config["frameRate"] ? config["frameRate"].as<float>() : 60.f;
+        pending->mIdleFrameRate = config["idleFrameRate"] ? config["idleFrameRate"].as<float>() : 2.f;
+        pending->mProfileLogInterval = config["profileLogInterval"] ? config["profileLogInterval"].as<double>() : 60.;
+        if(!(pending->mFrameRate >= 1 && pending->mFrameRate <= 240)) throw runtime_error("frameRate out of range");
+        if(!(pending->mIdleFrameRate > 0 && pending->mIdleFrameRate <= pending->mFrameRate)) throw runtime_error("idleFrameRate out of range");
+        if(!(pending->mProfileLogInterval >= 1)) throw runtime_error("profileLogInterval out of range");
+        
+        // a lab.yaml being replaced is read once it is back
+        fs::path lab = pending->mResourcePath / "lab.yaml";
+        pending->mHasLab = fs::exists(lab);
+        if(pending->mHasLab) pending->mLab = YAML::Load(loadString(gMediaIO.open(lab)));
+        pending->mScanned = pending->mResourcePath != mWatchedResourcePath && fs::is_directory(pending->mResourcePath / "projects");
+        if(pending->mScanned) pending->mProjects = scanProjects(pending->mResourcePath / "projects");
+        // mid-sync the folder can be empty for a moment, the next edit scans it again
+        if(pending->mScanned && pending->mProjects.empty()) throw runtime_error("no projects in " + pending->mResourcePath.string());
+    } catch (std::exception& e) {
+        console() << "Keeping the configuration in use: " << e.what() << endl;
+        return;
+    }
+    
+    if(pending->mScanned){
+        mWatchedResourcePath = pending->mResourcePath;
+        mConfigWatcher.setFiles({ configPath, mWatchedResourcePath / "lab.yaml" });
+    }
+    std::lock_guard<std::mutex> lock(mPendingConfigMutex);
+    mPendingConfig = pending;
+}
+
+// Applies what an edit to config.yaml or lab.yaml changed, as a show cycle
+// begins: the taglines, the show, the resource path with its projects and
+// calendar, and the frame timings. Other settings are read at launch only.
+void AtriumDisplayApp::applyConfig(){
+    
+    shared_ptr<PendingConfig> pending;
+    {
+        std::lock_guard<std::mutex> lock(mPendingConfigMutex);
+        pending.swap(mPendingConfig);
+    }
+    if(! pending) return;
+    
+    // const nodes, so looking up a missing key does not add it
+    const YAML::Node &config = pending->mConfig, &current = configYaml;
+    const YAML::Node &lab = pending->mLab, &currentLab = mLabYaml;
+    auto differs = [](const YAML::Node &a, const YAML::Node &b){
+        return (a ? YAML::Dump(a) : string()) != (b ? YAML::Dump(b) : string());
+    };
+    vector<string> applied;
+    
+    if(pending->mHasLab){
+        if(lab["taglines"] && differs(lab["taglines"], currentLab["taglines"])){
+            setTaglines(lab["taglines"]);
+            mTaglinesLayer->markDirty();
+            applied.push_back("taglines");
+        }
+        if(differs(lab["show"], currentLab["show"])){
+            mShowYaml.reset(lab["show"]);
+            if( ! mShowYaml || ! mShow.load( mShowYaml ) ){
+                mShow.load( YAML::Load( sDefaultShow ) );
+            }
+            mTransitionStateNext = mShow.getStart();
+            mSync.setJoin( "transition", toString( mShow.getStart() ) );
+            applied.push_back("show");
+        }
+        mLabYaml.reset(pending->mLab);
+    }
+    
+    if(pending->mScanned){
+        // between projects the loader is done, the old projects go with the pending config
+        if(mThread){
+            mThread->join();
+            mThread.reset();
+        }
+        mProjects.swap(pending->mProjects);
+        mCurrentProject = NULL;
+        configResourcePath = pending->mResourcePath;
+        mTimeEditCalendarFile = configResourcePath / "calendar" / "timeEdit.ics";
+        mTimeEditCalendarTmpFile = configResourcePath / "calendar" / "timeEditTmp.ics";
+        refreshCalendar();
+        applied.push_back("resource path " + configResourcePath.string());
+    }
+    
+    if(pending->mFrameRate != mFrameRate || pending->mIdleFrameRate != mIdleFrameRate){
+        mFrameRate = pending->mFrameRate;
+        mIdleFrameRate = pending->mIdleFrameRate;
+        setFrameRate( mFrameRate );
+        gProfiler.setWindow( mFrameRate * 10 );
+        mQuality.setBudget( 1000.f / mFrameRate );
+        applied.push_back("frame rates");
+    }
+    if(pending->mProfileLogInterval != mProfileLogInterval){
+        mProfileLogInterval = pending->mProfileLogInterval;
+        mNextProfileLog = getElapsedSeconds() + mProfileLogInterval;
+        applied.push_back("profile log interval");
+    }
+    
+    set<string> keys;
+    for(const YAML::Node &node : { config, current }){
+        for(YAML::const_iterator it = node.begin(); it != node.end(); ++it) keys.insert(it->first.Scalar());
+    }
+    for(const string &key : keys){
+        if(key == "resourcePath" || key == "frameRate" || key == "idleFrameRate" || key == "profileLogInterval") continue;
+        if(differs(config[key], current[key])) console() << "config.yaml: " << key << " changed, it applies at the next launch" << endl;
+    }
+    configYaml.reset(pending->mConfig);
+    mConfigMemory.set( fileBytes( Platform::get()->getResourcePath(RES_CUSTOM_YAML_CONFIG) ) );
+    
+    if(! applied.empty()) console() << "Reloaded the configuration: " << boost::algorithm::join(applied, ", ") << endl;
+}
+
+// The published projects of a portfolio's projects folder, newest first.
+deque<Project*> AtriumDisplayApp::scanProjects(const fs::path &dir){
+    
+    typedef vector<fs::path> paths;
+    
+    // projects are loaded in reverse cronological order
+    
+    deque<Project*> projects;
+    paths prjPaths;
+    copy(fs::directory_iterator(dir), fs::directory_iterator(), back_inserter(prjPaths));
+    sort(prjPaths.begin(), prjPaths.end());
+    reverse(prjPaths.begin(), prjPaths.end());
+    
+    int totalProjects = 0;
+    
+    console() << "Loading projects from " << dir.relative_path() << endl << endl;
+    
+    for (paths::const_iterator prjIt (prjPaths.begin()); prjIt != prjPaths.end(); ++prjIt)
+    {
+        if (fs::is_directory(*prjIt)) {
+            
+            if(! boost::starts_with(prjIt->filename().string(), "_")) {
+                
+                Project *p = new Project(*prjIt);
+                
+                // Filter projects
+                
+                bool published = false;
+                
+                totalProjects++;
+                
+                for(int i = 0; i < p->mPublished.size(); i++ ){
+                    if(boost::to_upper_copy( p->mPublished[i] ) == "DISPLAYS"){
+                        published = true;
+                        break;
+                    }
+                }
+                
+                if(published){
+                    console() << " + " << p->mTitle << endl;
+                    projects.push_back(p);
+                } else {
+                    console() << " - " << p->mTitle << endl;
+                    delete p;
+                }
+            }
+            
+        }
+    }
+    console() << endl <<  projects.size() << " projects loaded for displays of " << totalProjects << " total projects" << endl << endl;
+    return projects;
+}
+
+void AtriumDisplayApp::setTaglines(const YAML::Node &taglines){
+    mTaglineStrings.clear();
+    mTaglineStringPos = 0;
+    
+    for(YAML::const_iterator tagIt=taglines.begin();tagIt!=taglines.end();++tagIt) {
+        mTaglineStrings.push_back(tagIt->as<std::string>());
+    }
+}
+
 void AtriumDisplayApp::loadNextProject(){
     
     // console() << "loadNextProject" << endl;
@@ -1512,9 +7734,41 @@ void AtriumDisplayApp::loadNextProject(){
         mProjects.push_back(mCurrentProject);
         mProjects.pop_front();
     }
+    // a replay moves on to the project the recording showed
+    string name = mTrace.steer( "project", mProjects.front()->mPath.filename().string() );
+    for(size_t i = 0; i < mProjects.size() && mProjects.front()->mPath.filename().string() != name; i++){
+        mProjects.push_back(mProjects.front());
+        mProjects.pop_front();
+    }
     mCurrentProject = mProjects.front();
     // console() << "Next project is: " + mCurrentProject->mTitle << endl;
     mCurrentProject->reload();
+    
+    // what the next project reads first
+    if( mProjects.size() > 1 ){
+        const fs::path &next = mProjects[1]->mPath;
+        gMediaIO.prefetch( vector<fs::path>{ next / ProjectPack::FILENAME, next / "project.yaml" } );
+    }
+    
+    renderProjectHeader();
+    mProjectDetailsLayer->markDirty();
+}
+
+void AtriumDisplayApp::renderProjectHeader(){
+    
+    float margin = getCanvasHeight()/8.f;
+    
+    TextBox headerBox;
+    headerBox.setSize(ivec2((getCanvasWidth()/3.)-(2.5*margin), getCanvasHeight()-(4*margin) ));
+    headerBox.setColor(ColorA(1.,1.,1.,1.));
+    headerBox.setFont(mHeaderFont);
+    headerBox.setText(mCurrentProject->mTitle);
+    mHeaderTexture = createTexture( headerBox.render(), MemoryLedger::TEXT_CACHES );
+    mHeaderMeasure = headerBox.measure();
+    
+    Rectf titleRegion( margin, margin, mHeaderMeasure.x+(margin*1.5), mHeaderMeasure.y+margin );
+    titleRegion.include( Rectf( mHeaderTexture->getBounds() ) + vec2( margin*1.25, margin ) );
+    mProjectTitleLayer->mRegion = titleRegion;
 }
 
 void AtriumDisplayApp::loadMovieFile( const fs::path &moviePath )
@@ -1541,13 +7795,13 @@ void AtriumDisplayApp::loadMovieFile( const fs::path &moviePath )
         infoText.addLine( toString( mMovie->getNumFrames() ) + " frames" );
         infoText.addLine( toString( mMovie->getFramerate() ) + " fps" );
         infoText.setBorder( 4, 2 );
-        mMovieInfoTexture = gl::Texture::create( infoText.render( true ) );
+        mMovieInfoTexture = createTexture( infoText.render( true ), MemoryLedger::TEXT_CACHES );
         
         try {
             
             std::string movieSubtitleJsPath = moviePath.generic_string() + ".js";
-            if(fs::exists(movieSubtitleJsPath)){
-                std::string fileString = loadString(loadFile(movieSubtitleJsPath));
+            if(mCurrentProject && mCurrentProject->hasResource(movieSubtitleJsPath)){
+                std::string fileString = loadString(mCurrentProject->openResource(movieSubtitleJsPath));
                 
                 fileString = std::regex_replace (fileString, std::regex("\\\\\""),"\"");
                 
@@ -1584,11 +7838,58 @@ void AtriumDisplayApp::loadMovieFile( const fs::path &moviePath )
 void AtriumDisplayApp::shutdown()
 {
     mShouldQuit = true;
+    mConfigWatcher.stop();
+    mSync.stop();
+    mWatchdog.stop();
+    mMetrics.stop();
+    mSimulation.stop();
     mSurfaces->cancel();
-    mThread->join();
+    if(mThread){
+        mThread->join();
+    }
+    gTexturePool.clear();
 }
 
 CINDER_APP( AtriumDisplayApp, RendererGl(), [&]( App::Settings *settings ) {
+    // benchmark modes run without opening a window
+    const vector<string> &args = settings->getCommandLineArgs();
+    auto hasArg = [&args]( const string &arg ){ return find( args.begin(), args.end(), arg ) != args.end(); };
+    if( hasArg( "--bench-noise" ) || hasArg( "--bench-snow" ) ){
+        const int32_t seed = 0x214;
+        if( hasArg( "--bench-noise" ) ) benchmarkNoise( seed );
+        if( hasArg( "--bench-snow" ) ) benchmarkSnow( seed );
+        settings->setShouldQuit();
+        return;
+    }
+    
+    // packs a project folder, or all of a portfolio's, with --pack DIR [--canvas 5760x1080];
+    // a project with files changed since uses its loose files until packed again
+    auto pack = find( args.begin(), args.end(), "--pack" );
+    if( pack != args.end() && pack + 1 != args.end() ){
+        ivec2 canvas( 5760, 1080 );
+        auto size = find( args.begin(), args.end(), "--canvas" );
+        if( size != args.end() && size + 1 != args.end() ){
+            sscanf( ( size + 1 )->c_str(), "%dx%d", &canvas.x, &canvas.y );
+        }
+        ProjectPack::write( expand_user( *( pack + 1 ) ), canvas );
+        settings->setShouldQuit();
+        return;
+    }
+    
+    // measures the portfolio's assets against budgets, see AssetProfiler
+    if( hasArg( "--profile-assets" ) ){
+        AssetProfiler( args ).run();
+        settings->setShouldQuit();
+        return;
+    }
+    
+    if( hasArg( "--benchmark" ) ){
+        // renders offscreen at the canvas size, the window only holds the GL context
+        settings->setWindowSize( 320, 60 );
+        settings->setPowerManagementEnabled(false);
+        return;
+    }
+    
     settings->setWindowSize(Display::getDisplays()[0]->getWidth(), round(Display::getDisplays()[0]->getWidth()*(9./(16*3))));
     settings->setFullScreen( false );
     settings->setResizable( false );